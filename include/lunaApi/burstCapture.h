@@ -0,0 +1,151 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+#ifndef __BURSTCAPTURE_H__
+#define __BURSTCAPTURE_H__
+
+#include <glib.h>
+#include <pbnjson.hpp>
+#include <time.h>
+#include <atomic>
+#include <string>
+#include <vector>
+
+// Samples a single process at 10 - 200 Hz for a short time, for launches and
+// scrolling where the collection interval is far too coarse. The samples go
+// to a buffer sized for the whole capture before it starts and are published
+// to other threads one by one, so a reader never waits for the sampling
+// thread. Nothing is shared with the interval thread: the capture has its own
+// thread and keeps its own /proc files open.
+//
+//   BurstCapture capture(request);
+//   capture.open();             // false when the process does not exist
+//   capture.start();
+//   ... capture.publishedCount(), capture.appendSamples() ...
+//   capture.isDone()
+class BurstCapture
+{
+public:
+    enum Metric
+    {
+        METRIC_CPU = 1 << 0,                // cpu_percent, of one core
+        METRIC_MEMORY = 1 << 1,             // rss_kb
+        METRIC_CONTEXT_SWITCHES = 1 << 2,   // voluntary_ctxt_switches, nonvoluntary_ctxt_switches
+        METRIC_FAULTS = 1 << 3,             // minor_faults, major_faults
+    };
+
+    static const int MIN_RATE_HZ = 10;
+    static const int MAX_RATE_HZ = 200;
+    static const int DEFAULT_RATE_HZ = 50;
+    static const gint64 MIN_DURATION_MS = 100;
+    static const gint64 MAX_DURATION_MS = 30000;
+    static const gint64 DEFAULT_DURATION_MS = 1000;
+
+    // parameters of collector/captureBurst
+    struct Request
+    {
+        int pid;                    // 0 until appId is resolved
+        std::string appId;
+        guint metrics;
+        int rateHz;
+        gint64 durationMs;
+        bool subscribe;
+        bool once;
+    };
+
+    // false when a parameter is missing or out of range
+    static bool parseRequest(const pbnjson::JValue &params, Request &request);
+
+    explicit BurstCapture(const Request &request);
+    ~BurstCapture();
+
+    BurstCapture(const BurstCapture &) = delete;
+    void operator=(const BurstCapture &) = delete;
+
+    bool open();
+    bool start();
+
+    // ends the capture early, the samples taken so far stay
+    void stop();
+
+    // the absolute counters of the process right now, without a thread
+    bool sampleOnce(pbnjson::JValue &sample);
+
+    int pid() const { return request.pid; }
+    int rateHz() const { return request.rateHz; }
+    bool isDone() const { return done.load(std::memory_order_acquire); }
+    size_t publishedCount() const { return published.load(std::memory_order_acquire); }
+    guint64 missedSamples() const { return missed.load(std::memory_order_relaxed); }
+    bool processExited() const { return exited.load(std::memory_order_relaxed); }
+
+    // ["t_us", ...] and [t, ...],[t, ...] of the samples [from, to)
+    void appendColumns(std::string &json) const;
+    void appendSamples(std::string &json, size_t from, size_t to) const;
+
+private:
+    enum File
+    {
+        STAT,
+        STATM,
+        STATUS,
+        FILE_COUNT
+    };
+
+    struct Counters
+    {
+        gint64 timeUs;              // CLOCK_MONOTONIC
+        guint64 cpuTimeNs;
+        guint64 rssKb;
+        guint64 voluntarySwitches;
+        guint64 involuntarySwitches;
+        guint64 minorFaults;
+        guint64 majorFaults;
+    };
+
+    struct Sample
+    {
+        gint64 timeUs;              // since the start of the capture
+        double cpuPercent;
+        guint64 rssKb;
+        guint64 voluntarySwitches;  // counters: the increase since the previous sample
+        guint64 involuntarySwitches;
+        guint64 minorFaults;
+        guint64 majorFaults;
+    };
+
+    static gpointer process(gpointer data);
+
+    const char *readFile(File file, size_t *length);
+    bool readCounters(Counters &counters);
+
+    Request request;
+    int fds[FILE_COUNT];
+    clockid_t cpuClock;
+    bool hasCpuClock;
+    std::vector<char> buffer;
+
+    GThread *thread;
+    gint64 startUs;
+    std::vector<Sample> samples;    // sized by start()
+    std::atomic<size_t> published;
+    std::atomic<guint64> missed;
+    std::atomic<bool> exited;
+    std::atomic<bool> stopRequested;
+    std::atomic<bool> done;
+};
+
+#endif
@@ -0,0 +1,96 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __INFLUXHTTPSINK_H__
+#define __INFLUXHTTPSINK_H__
+
+#include <string>
+#include <vector>
+#include <zlib.h>
+
+#include "metricSink.h"
+
+// Writes batches straight to the InfluxDB 1.x HTTP API (POST /write), using
+// the "urls" and "database" of [[outputs.influxdb]], so the agent's own
+// measurements do not need telegraf. Only plain http:// is supported.
+//
+// One keep-alive connection is kept to the current url; on failure the next
+// url is tried. Batches may be gzip compressed.
+class InfluxHttpSink : public MetricSink
+{
+public:
+    struct Endpoint
+    {
+        std::string url;
+        std::string host;       // for getaddrinfo, without brackets
+        std::string port;
+        std::string hostHeader;
+        std::string writePath;  // <path prefix>/write?db=<database>&precision=ns
+    };
+
+    InfluxHttpSink(const std::string &name, const std::vector<std::string> &urls, const std::string &database);
+    ~InfluxHttpSink();
+
+    WriteResult write(const char *data, size_t length) override;
+    bool ready() override;
+
+    // reads "webOS.influxdb"
+    void configure(const pbnjson::JValue &socketConfig) override;
+
+    size_t batchSize(size_t configured) const override { return batchBytes; }
+    gint64 batchLingerUs(gint64 configured) const override { return flushIntervalUs; }
+
+    static bool parseUrl(const std::string &url, const std::string &database, Endpoint &endpoint);
+
+private:
+    enum class PostResult
+    {
+        OK,
+        REJECTED,           // 4xx, the batch will not be accepted
+        RETRY,              // 5xx / 429
+        CONNECTION_FAILED
+    };
+
+    bool connectEndpoint(const Endpoint &endpoint);
+    bool waitReady(int fd, short events);
+    void disconnect();
+    bool sendAll(const char *data, size_t length);
+    bool readResponse(int &status, bool &keepAlive);
+    PostResult post(const Endpoint &endpoint, const char *body, size_t length, bool gzipped);
+    bool compress(const char *data, size_t length);
+
+    std::vector<Endpoint> endpoints;
+    size_t currentEndpoint;
+    int sockFd;
+
+    // "webOS.influxdb"
+    bool useGzip;
+    size_t batchBytes;
+    gint64 flushIntervalUs;
+    int maxRetries;
+    gint64 retryBackoffUs;
+    int timeoutMs;
+
+    z_stream zStream;
+    bool zStreamReady;
+
+    // reused between writes
+    std::string compressed;
+    std::string request;
+    std::string response;
+};
+
+#endif
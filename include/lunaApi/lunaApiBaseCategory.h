@@ -42,6 +42,7 @@ protected:
     void LSMessageReplyErrorInvalidConfigurations(LSHandle *sh, LSMessage *msg);
     void LSMessageReplyErrorCollectorIsRunning(LSHandle *sh, LSMessage *msg);
     void LSMessageReplyErrorDevModeDisable(LSHandle *sh, LSMessage *msg);
+    void LSMessageReplyErrorCaptureInProgress(LSHandle *sh, LSMessage *msg);
     void LSMessageReplyPayload(LSHandle *sh, LSMessage *msg, const char *payload);
 
     static void postEvent(LSHandle *handle, void *subscribeKey, void *payload);
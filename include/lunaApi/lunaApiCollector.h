@@ -22,6 +22,7 @@
 #include "threadForInterval.h"
 #include "threadForSocket.h"
 #include "telegrafController.h"
+#include "burstCapture.h"
 
 // Singleton class
 // https://henriquesd.medium.com/singleton-vs-static-class-e6b2b32ec331
@@ -47,7 +48,11 @@ public:
     }
 
     void initialize();
-    void sendToTelegraf(std::string &msg);
+    // the record is copied, callers keep and reuse their buffer
+    bool sendToTelegraf(const char *data, size_t length);
+    bool sendToTelegraf(const std::string &record) { return sendToTelegraf(record.data(), record.length()); }
+    // records separated by '\n', queued in order in one call
+    bool sendBatchToTelegraf(const std::string &batch);
 
     void loadInitConfig();
 
@@ -62,6 +67,13 @@ private:
     ThreadForInterval *pThreadForInterval = nullptr;
     ThreadForSocket *pThreadForSocket = nullptr;
 
+    // the running collector/captureBurst, one at a time
+    BurstCapture *pBurstCapture = nullptr;
+    LSMessage *pBurstMessage = nullptr;         // replied at the end, without "subscribe"
+    std::string burstSubscriptionKey;           // with "subscribe"
+    size_t burstSentSamples = 0;
+    guint burstCaptureCount = 0;
+
     static bool start(LSHandle *sh, LSMessage *msg, void *data);
     static bool stop(LSHandle *sh, LSMessage *msg, void *data);
     static bool restart(LSHandle *sh, LSMessage *msg, void *data);
@@ -74,6 +86,13 @@ private:
 
     static bool getData(LSHandle *sh, LSMessage *msg, void *data);
 
+    static bool getPipelineStats(LSHandle *sh, LSMessage *msg, void *data);
+
+    static bool captureBurst(LSHandle *sh, LSMessage *msg, void *data);
+    static bool cb_resolveBurstApp(LSHandle *sh, LSMessage *reply, void *data);
+    static bool startBurstCapture(LSHandle *sh, LSMessage *msg, const BurstCapture::Request &request);
+    static gboolean cb_flushBurstCapture(gpointer data);
+
     static void postEvent(void *subscribeKey, void *payload);
 };
 
@@ -0,0 +1,122 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __METRICSINK_H__
+#define __METRICSINK_H__
+
+#include <glib.h>
+#include <stddef.h>
+#include <string>
+#include <pbnjson.hpp>
+
+#include "pipelineStats.h"
+#include "unixDatagramSocket.h"
+
+// Destination of line-protocol batches. Each sink is driven by its own
+// queue and flush thread in ThreadForSocket, so one slow or absent sink
+// does not hold up the others.
+class MetricSink
+{
+public:
+    enum class WriteResult
+    {
+        WRITTEN,
+        RETRY_LATER,    // temporarily congested
+        UNREACHABLE,    // destination is not there right now
+        FAILED          // the batch itself was rejected, retrying will not help
+    };
+
+    virtual ~MetricSink();
+
+    const std::string &name() const { return sinkName; }
+
+    // called by the thread stopping the sink: a write in progress stops
+    // retrying and waiting, and returns RETRY_LATER
+    void requestStop();
+
+    // 'data' holds complete, newline terminated records
+    virtual WriteResult write(const char *data, size_t length) = 0;
+
+    // true when a write is expected to succeed (used before replaying the spool)
+    virtual bool ready() = 0;
+
+    // batch size and linger time to use, given the "webOS.socket" settings
+    virtual size_t batchSize(size_t configured) const { return configured; }
+    virtual gint64 batchLingerUs(gint64 configured) const { return configured; }
+
+    // apply the "webOS.socket" section, called from the sink's own thread
+    virtual void configure(const pbnjson::JValue &socketConfig) {}
+
+    // every failed send/write attempt by errno, including ones that were retried
+    const ErrnoCounters &sendErrors() const { return errors; }
+
+protected:
+    explicit MetricSink(const std::string &name);
+
+    bool stopRequested() const { return g_atomic_int_get(&stopping) != 0; }
+
+    // sleeps up to 'timeoutUs', false when woken up by requestStop()
+    bool sleepUnlessStopped(gint64 timeoutUs);
+
+    ErrnoCounters errors;
+
+    // readable once stop is requested, for poll() next to a socket
+    int stopFd;
+
+private:
+    std::string sinkName;
+    gint stopping;
+};
+
+// AF_UNIX datagram socket, e.g. telegraf socket_listener or a local recorder
+class UnixSocketSink : public MetricSink
+{
+public:
+    UnixSocketSink(const std::string &name, const std::string &path);
+
+    WriteResult write(const char *data, size_t length) override;
+    bool ready() override { return socket.ensureConnected(); }
+    void configure(const pbnjson::JValue &socketConfig) override;
+
+    size_t batchSize(size_t configured) const override { return MIN(configured, (size_t)MAX_DATAGRAM_SIZE_LIMIT); }
+
+private:
+    UnixDatagramSocket socket;
+};
+
+// Local line-protocol file, rotated to <path>.1 ... <path>.<maxFiles> by size
+class FileSink : public MetricSink
+{
+public:
+    FileSink(const std::string &name, const std::string &path, size_t maxSizeBytes, int maxFiles);
+    ~FileSink();
+
+    WriteResult write(const char *data, size_t length) override;
+    bool ready() override { return openFile(); }
+
+private:
+    bool openFile();
+    void rotate();
+
+    std::string filePath;
+    size_t maxSize;
+    int maxFiles;
+
+    int fd;
+    size_t currentSize;
+};
+
+#endif
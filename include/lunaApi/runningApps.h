@@ -0,0 +1,109 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __RUNNINGAPPS_H__
+#define __RUNNINGAPPS_H__
+
+#include <glib.h>
+#include <luna-service2/lunaservice.h>
+#include <pbnjson.hpp>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Running applications, kept up to date by subscriptions instead of a call to
+// the application manager every collection cycle:
+//   luna://com.webos.applicationManager/running                  app id and pid
+//   luna://com.webos.service.webappmanager/listRunningApps       web process pid, where supported
+// A subscription that drops (service restart, hub error) is made again with a
+// growing delay. Replies and timers are dispatched by the context given to
+// start(); every change publishes a new immutable table which snapshot() hands
+// to any thread.
+class RunningApps
+{
+public:
+    struct App
+    {
+        std::string id;
+        int pid;                    // "processid" of the application manager
+        int webProcessPid;          // "webprocessid" of the web app manager, 0 when unknown
+    };
+
+    struct Table
+    {
+        guint64 generation;         // changes with every published table
+        std::vector<App> apps;      // in the order of the application manager
+        std::unordered_map<int, std::string> appIdByPid;    // pids and web process pids
+    };
+    typedef std::shared_ptr<const Table> Snapshot;
+
+    static RunningApps *getInstance();
+
+    RunningApps(const RunningApps &) = delete;
+    void operator=(const RunningApps &) = delete;
+
+    // subscribes through lsHandle, which is attached to context (NULL: the
+    // default one). Any thread may call it any number of times.
+    void start(LSHandle *lsHandle, GMainContext *context);
+
+    Snapshot snapshot() const { return std::atomic_load(&current); }
+
+private:
+    enum Source
+    {
+        APPLICATION_MANAGER,
+        WEBAPP_MANAGER,
+        SOURCE_COUNT
+    };
+
+    struct Subscription
+    {
+        const char *uri;
+        const char *payload;
+        LSMessageToken token;       // 0 while not subscribed
+        guint retryTimer;
+        guint retryDelaySec;
+        bool supported;
+    };
+
+    RunningApps();
+
+    static gboolean cb_start(gpointer data);
+    static gboolean cb_retry(gpointer data);
+    static bool cb_reply(LSHandle *sh, LSMessage *msg, void *data);
+
+    guint addTimeout(guint seconds, GSourceFunc function, gpointer data);
+    void subscribe(Source source);
+    void scheduleRetry(Source source);
+    bool updateApps(const pbnjson::JValue &running);
+    bool updateWebProcesses(const pbnjson::JValue &running);
+    void publish();
+
+    LSHandle *handle;
+    GMainContext *context;
+    std::atomic<bool> started;
+    Snapshot current;               // std::atomic_load / std::atomic_store only
+
+    // thread of the context only
+    Subscription subscriptions[SOURCE_COUNT];
+    std::vector<App> apps;
+    std::unordered_map<std::string, int> webProcessPids;    // app id -> web process pid
+    guint64 generation;
+};
+
+#endif
@@ -0,0 +1,56 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __SHMSINK_H__
+#define __SHMSINK_H__
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "metricSink.h"
+#include "shmSamples.h"
+
+// Publishes the latest value of each series to the shared memory segment
+// described in shmSamples.h. The sink thread is the single seqlock writer.
+class ShmSink : public MetricSink
+{
+public:
+    ShmSink(const std::string &name, const std::string &shmName, uint32_t entryCapacity);
+    ~ShmSink();
+
+    WriteResult write(const char *data, size_t length) override;
+    bool ready() override { return segment != nullptr; }
+
+private:
+    bool createSegment();
+    void updateEntry(const char *line, size_t length, int64_t nowNs);
+    uint32_t entryFor(const std::string &series, bool &appended);
+
+    std::string shmName;
+    uint32_t capacity;
+
+    void *segment;
+    size_t segmentSize;
+    ShmSegmentHeader *header;
+
+    // writer side index, series -> entry
+    std::unordered_map<std::string, uint32_t> entryIndex;
+    std::vector<std::string> entrySeries;
+    std::string seriesKey;
+};
+
+#endif
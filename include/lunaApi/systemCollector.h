@@ -0,0 +1,135 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+#ifndef __SYSTEMCOLLECTOR_H__
+#define __SYSTEMCOLLECTOR_H__
+
+#include <glib.h>
+#include <pbnjson.hpp>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// System-wide metrics read in-process, a replacement for the cpu, mem, system,
+// kernel_vmstat, diskio, net and temp inputs of telegraf. Every family is
+// switched on by its own key of the "webOS.system" section:
+//
+//   cpu      /proc/stat                          -> system_cpu, system_kernel
+//   memory   /proc/meminfo                       -> system_memory
+//   load     /proc/loadavg                       -> system_load
+//   vmstat   /proc/vmstat                        -> system_vmstat
+//   disk     /proc/diskstats                     -> system_disk
+//   network  /proc/net/dev                       -> system_net
+//   cpufreq  /sys/devices/system/cpu/cpu*/cpufreq -> system_cpufreq
+//   thermal  /sys/class/thermal/thermal_zone*    -> system_thermal
+//
+// The files stay open and are re-read with pread() into one buffer. Rates are
+// computed against the previous read of the same family, so the first cycle
+// after a family is enabled only reports the absolute values.
+// Not thread safe, it is driven by the interval thread.
+class SystemCollector
+{
+public:
+    SystemCollector();
+    ~SystemCollector();
+
+    void collect(const pbnjson::JValue &systemConfig, int64_t timestampNs);
+
+private:
+    enum Family
+    {
+        CPU,
+        MEMORY,
+        LOAD,
+        VMSTAT,
+        DISK,
+        NETWORK,
+        CPUFREQ,
+        THERMAL,
+        FAMILY_COUNT
+    };
+
+    struct CachedFile
+    {
+        std::string path;
+        int fd;                     // -1 until opened
+    };
+
+    // jiffies of a "cpu" line of /proc/stat
+    struct CpuTimes
+    {
+        guint64 user, nice, system, idle, iowait, irq, softirq, steal;
+        bool valid;
+    };
+
+    struct DiskCounters
+    {
+        guint64 reads, sectorsRead, writes, sectorsWritten, ioTimeMs;
+        guint64 cycle;
+    };
+
+    struct NetCounters
+    {
+        guint64 rxBytes, rxPackets, txBytes, txPackets;
+        guint64 cycle;
+    };
+
+    struct SysfsEntry
+    {
+        std::string name;           // "cpu0", "thermal_zone0"
+        std::string type;           // thermal zone type
+        CachedFile file;
+    };
+
+    const char *readFile(CachedFile &file, size_t *length);
+    void send();
+
+    void collectCpu(gint64 elapsedUs, int64_t timestampNs);
+    void collectMemory(int64_t timestampNs);
+    void collectLoad(int64_t timestampNs);
+    void collectVmstat(gint64 elapsedUs, int64_t timestampNs);
+    void collectDisk(gint64 elapsedUs, int64_t timestampNs);
+    void collectNetwork(gint64 elapsedUs, int64_t timestampNs);
+    void collectCpufreq(int64_t timestampNs);
+    void collectThermal(int64_t timestampNs);
+
+    void scanCpufreq();
+    void scanThermal();
+    void resetFamily(int family);
+
+    CachedFile files[FAMILY_COUNT];
+    std::vector<char> buffer;
+    std::string record;
+    std::string token;              // device and interface names
+
+    guint64 cycle;
+    bool enabled[FAMILY_COUNT];
+    gint64 lastReadUs[FAMILY_COUNT];
+
+    std::vector<CpuTimes> cpuTimes;         // [0] is the "cpu" total, [n + 1] is "cpu<n>"
+    guint64 contextSwitches;
+    guint64 forks;
+    std::vector<guint64> vmstatCounters;
+    std::unordered_map<std::string, DiskCounters> diskCounters;
+    std::unordered_map<std::string, NetCounters> netCounters;
+    std::vector<SysfsEntry> cpufreqEntries;
+    std::vector<SysfsEntry> thermalEntries;
+    bool cpufreqScanned;
+    bool thermalScanned;
+};
+
+#endif
@@ -18,12 +18,16 @@
 #define __TELEGRAFCONTROLLER_H__
 
 #include "tomlParser.h"
+#include <atomic>
 #include <mutex>
 #include <chrono>
+#include <memory>
 #include <string>
+#include <glib.h>
 #include <pbnjson.hpp>
 #include "tomlParser.h"
 #include "errorCode.h"
+#include "fileWatcher.h"
 
 class TelegrafController {
 
@@ -33,7 +37,13 @@ public:
     // static inline std::mutex webOSConfigMutex;
     static inline pid_t pid_ {-1};
     static inline std::chrono::time_point<std::chrono::system_clock> lastStartedTime;  
-    static inline tomlObject _allConfig {};
+
+    // merged telegraf + webOS configuration, rebuilt by reloadConfig() and never modified
+    typedef std::shared_ptr<const tomlObject> ConfigSnapshot;
+    static inline ConfigSnapshot configSnapshot = std::make_shared<const tomlObject>();    // std::atomic_load / std::atomic_store only
+    static inline std::atomic<guint64> configVersion {0};
+    static inline std::mutex configMutex;
+    static inline FileWatcher *configWatcher = nullptr;
 
 protected:
 
@@ -44,7 +54,7 @@ private:
     void initAvailableConfigurations();
     void splitMainConfig();
     bool updateSectionConfig(const std::string &section, tomlObject &inputConfig);
-    static void loadConfig();
+    static void mergeWebOSConfig(tomlObject &config);
 
 public:
     bool checkInputConfig(tomlObject &inputConfig);
@@ -84,7 +94,14 @@ public:
     static SDKError stop();
     static SDKError restart();
     static bool isRunning();
+    ConfigSnapshot getConfigSnapshot();
+    // incremented whenever the merged configuration changes
+    guint64 getConfigVersion();
     tomlObject getConfig();
+    // re-read the telegraf and webOS configuration, publish it if it changed
+    static void reloadConfig();
+    // "" when the section or the key is missing
+    static std::string configValue(const tomlObject &config, const std::string &section, const std::string &key);
 
     bool setConfig(tomlObject &inputConfig);
 };
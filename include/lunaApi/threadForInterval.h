@@ -22,38 +22,77 @@
 #include <pbnjson.hpp>
 #include <iomanip>
 
+#include "intervalScheduler.h"
+
 enum
 {
     INTERVAL_THREAD_MSG_STOP = -1,
 };
 
+// Replies of the collection calls and subscriptions are dispatched here, on a
+// thread of their own, and never wait behind the public API on the main loop.
+typedef struct _CollectorLoop CollectorLoop;
+struct _CollectorLoop
+{
+    GMainContext *context;
+    GMainLoop *loop;
+    GThread *thread;
+    LSHandle *lsHandle;             // private bus handle, NULL when it could not be registered
+};
+
 typedef struct _IntervalHandle IntervalHandle;
 struct _IntervalHandle
 {
     GThread *thread;
     GAsyncQueue *queue;
+    IntervalScheduler *scheduler;
+    CollectorLoop *collectorLoop;
 };
 
 class ThreadForInterval
 {
 public:
+    // wall time of the per-process sampling of "webOS.processMonitoring"
+    struct SamplingStats
+    {
+        guint workers;
+        guint processes;        // in the last cycle
+        guint64 cycles;
+        gint64 lastCycleUs;
+        gint64 maxCycleUs;
+        gint64 avgCycleUs;
+        // thread mode of the last cycle, CPU time summed over the workers
+        guint threadProcesses;
+        guint threads;
+        gint64 lastThreadCostUs;
+        gint64 maxThreadCostUs;
+    };
+
     ThreadForInterval();
     ~ThreadForInterval();
 
     void intervalHandle_destroy(IntervalHandle *intervalHandle);
 
+    IntervalScheduler::Stats getSchedulerStats();
+    SamplingStats getSamplingStats();
+
 private:
     IntervalHandle *pIntervalHandle;
 
     static gpointer intervalHandle_process(gpointer data);
 
+    static CollectorLoop *collectorLoop_create();
+    static void collectorLoop_destroy(CollectorLoop *collectorLoop);
+    static gpointer collectorLoop_process(gpointer data);
+
     static bool cb_getWebProcessSize(LSHandle *sh, LSMessage *msg, void *user_data);
-    static bool cb_getRunningProcess(LSHandle *sh, LSMessage *msg, void *user_data);
 
-    static int getTelegrafAgentInterval();
+    static gint64 getTelegrafAgentIntervalUs();
 
-    static void collectWebProcessSize(pbnjson::JValue & webOSConfig);
-    static void collectProcessesData(pbnjson::JValue & webOSConfig);
+    static void collectWebProcessSize(CollectorLoop *collectorLoop, const pbnjson::JValue & webOSConfig);
+    static void collectProcessesData(CollectorLoop *collectorLoop, const pbnjson::JValue & webOSConfig);
+    static void sampleProcessMonitoring(const pbnjson::JValue & processMonitoring);
+    static void collectSystemData(const pbnjson::JValue & webOSConfig);
 };
 
 #endif
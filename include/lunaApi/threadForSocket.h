@@ -25,34 +25,115 @@
 #include <string>
 #include <unistd.h>
 
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <shared_mutex>
+#include <vector>
+
+#include "diskSpool.h"
+#include "metricSink.h"
+#include "mpscRing.h"
+#include "pipelineStats.h"
+
+// One per configured sink: its own queue, flush thread and counters
 typedef struct _SocketHandle SocketHandle;
 struct _SocketHandle
 {
     GThread *thread;
-    GAsyncQueue *queue;
-};
+    MpscRing *ring;
+    gint stopRequested;
+    gint reloadRequested;
+    MetricSink *sink;
+    std::string sinkKey;        // identifies the configuration the sink was created from
 
-typedef struct _SocketMsg SocketMsg;
-struct _SocketMsg
-{
-    gpointer send_string;
-    gpointer data_int;
+    // "webOS.socket" configuration
+    size_t maxDatagramSize;
+    gint64 lingerUs;
+    gint64 statsIntervalUs;     // 0: no internal measurement
+
+    // owned by the flush thread
+    guint64 droppedSinceDelivery;
+    std::vector<gint64> batchEnqueueTimes;
+    gint64 nextStatsTime;
+
+    // read by other threads
+    std::atomic<guint64> writtenRecords;
+    std::atomic<guint64> writtenBytes;
+    std::atomic<guint64> droppedRecords;    // failed deliveries, queue overflow is counted by the ring
+    std::atomic<guint64> latencySumUs;      // enqueue to delivery, per record
+    std::atomic<guint64> latencyMaxUs;
+    LatencyHistogram latency;
+
+    // "webOS.spool", only for the telegraf sink
+    DiskSpool *spool;
+    gint64 replayRate;          // records per second
+    gint64 nextReplayTime;
+
+    // copy of the spool stats and the rate sample, guarded by statsMutex
+    std::mutex statsMutex;
+    bool spoolOpen;
+    DiskSpool::Stats spoolStats;
+    gint64 rateSampleTime;
+    guint64 rateSampleRecords;
+    guint64 rateSampleBytes;
+    double recordsPerSec;
+    double bytesPerSec;
 };
 
 class ThreadForSocket
 {
 public:
+    struct SinkStats
+    {
+        std::string name;
+        MpscRing::Stats queue;
+        guint64 writtenRecords;
+        guint64 writtenBytes;
+        guint64 droppedRecords;     // queue overflow and failed deliveries
+        double recordsPerSec;
+        double bytesPerSec;
+        guint64 latencyAvgUs;
+        guint64 latencyMaxUs;
+        std::vector<guint64> latencyBuckets;    // LatencyHistogram::BUCKET_BOUNDS_US
+        std::map<int, guint64> sendErrors;      // errno -> count
+        bool spoolOpen;
+        DiskSpool::Stats spool;
+    };
+
     ThreadForSocket();
     ~ThreadForSocket();
 
-    void socketHandle_destroy(SocketHandle *socketHandle);
+    // every sink gets a copy of the record in a slot of its queue
+    bool sendToMSGQ(const char *data, size_t length);
+    // the same for each line of a '\n' separated batch, under one lock
+    bool sendBatchToMSGQ(const char *data, size_t length);
 
-    void sendToMSGQ(std::string &data);
+    // re-read "webOS.sinks" and "webOS.socket": new sinks are started, removed
+    // ones are flushed and stopped, unchanged ones keep their queue
+    void reloadSinks();
+
+    std::vector<SinkStats> getSinkStats();
 
 private:
-    SocketHandle *pSocketHandle;
+    std::shared_mutex sinksMutex;
+    std::vector<SocketHandle *> sinks;
 
+    static SocketHandle *socketHandle_create(const std::string &sinkKey, MetricSink *sink, bool withSpool);
+    static void socketHandle_destroy(SocketHandle *socketHandle);
     static gpointer socketHandle_process(gpointer data);
+
+    static void loadSocketConfig(SocketHandle *socketHandle);
+    static void loadSpoolConfig(SocketHandle *socketHandle);
+    static void appendToBatch(SocketHandle *socketHandle, std::string &batch, guint &batchRecords,
+                              const std::string &record, gint64 enqueueTime);
+    static void flushBatch(SocketHandle *socketHandle, std::string &batch, guint &batchRecords);
+    static void abandonQueued(SocketHandle *socketHandle, std::string &batch, guint &batchRecords, std::string &record);
+    static void replaySpool(SocketHandle *socketHandle, std::string &buffer);
+    static void publishSpoolStats(SocketHandle *socketHandle);
+
+    static SinkStats collectStats(SocketHandle *socketHandle);
+    static void encodeStats(const SinkStats &stats, std::string &out);
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -38,12 +38,19 @@ bool isDevMode();
 
 std::string removeAllSpaces(std::string str);
 
+// Go time.ParseDuration syntax as used by telegraf, e.g. "10s", "1m30s", "500ms", "1.5h"
+bool parseGoDuration(const std::string &str, int64_t &durationNs);
+
 std::string readTextFile(const char* filePath);
 
 void writeTextFile(const char* filePath, std::string & strBuffer);
 
 pbnjson::JValue stringToJValue(const char* rawData);
 
+int64_t jsonNumberOrDefault(const pbnjson::JValue &obj, const std::string &key, int64_t defaultValue);
+
+std::string jsonStringOrDefault(const pbnjson::JValue &obj, const std::string &key, const std::string &defaultValue);
+
 pbnjson::JValue readWebOSJsonConfig();
 
 void writeWebOSConfigJson(pbnjson::JValue);
@@ -0,0 +1,94 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __DISKSPOOL_H__
+#define __DISKSPOOL_H__
+
+#include <stdint.h>
+#include <string>
+
+// Fixed-size, memory-mapped ring file used to store datagrams while their
+// sink is unreachable. When full, the oldest entries are overwritten.
+// Only one thread may use an instance.
+//
+// File layout (little endian, as written by the host):
+//   SpoolHeader | data area of 'capacity' bytes
+// Each entry in the data area is a SpoolEntry followed by 'length' bytes;
+// entries wrap around the end of the data area.
+class DiskSpool
+{
+public:
+    struct Stats
+    {
+        uint64_t spooledRecords;
+        uint64_t replayedRecords;
+        uint64_t droppedRecords;
+        uint64_t pendingRecords;
+        uint64_t usedBytes;
+        uint64_t capacity;
+    };
+
+    DiskSpool();
+    ~DiskSpool();
+
+    DiskSpool(const DiskSpool &) = delete;
+    void operator=(const DiskSpool &) = delete;
+
+    // a file with a different capacity or a broken header is reset
+    bool open(const std::string &path, uint64_t capacity);
+    void close();
+    bool isOpen() const { return header != nullptr; }
+
+    bool append(const char *data, uint32_t length, uint32_t records);
+    bool empty() const;
+
+    // copy the oldest entry to 'out' without removing it
+    bool front(std::string &out, uint32_t &records);
+    void popFront(bool replayed);
+
+    Stats getStats() const;
+
+private:
+    struct SpoolHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t capacity;
+        uint64_t head;          // byte offsets, only ever increase
+        uint64_t tail;
+        uint64_t pendingRecords;
+    };
+
+    struct SpoolEntry
+    {
+        uint32_t length;
+        uint32_t records;
+    };
+
+    void readAt(uint64_t offset, void *dst, uint64_t length) const;
+    void writeAt(uint64_t offset, const void *src, uint64_t length);
+
+    int fd;
+    size_t mappedSize;
+    SpoolHeader *header;
+    char *dataArea;
+
+    uint64_t spooledRecords;
+    uint64_t replayedRecords;
+    uint64_t droppedRecords;
+};
+
+#endif
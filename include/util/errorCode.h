@@ -25,7 +25,8 @@ enum class SDKError
     MALFORMED_JSON,
     INVALID_CONFIGURATIONS,
     COLLECTOR_IS_RUNNING,
-    DEVMODE_DISABLE
+    DEVMODE_DISABLE,
+    CAPTURE_IN_PROGRESS
 };
 
 const char* getErrorMessage(SDKError);
@@ -0,0 +1,63 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __FILEWATCHER_H__
+#define __FILEWATCHER_H__
+
+#include <glib.h>
+#include <functional>
+#include <set>
+#include <string>
+#include <vector>
+
+// Watches directories with inotify on its own thread and reports the files
+// that were written, renamed into place or deleted. Events are collected until
+// the directories are quiet for DEBOUNCE_MS, so an editor or a setConfig that
+// rewrites several files results in a single callback.
+//
+// Directories that do not exist yet are retried every few seconds; when one
+// appears (or disappears) the callback gets the directory path itself.
+class FileWatcher
+{
+public:
+    typedef std::function<void(const std::set<std::string> &changedPaths)> Callback;
+
+    static const int DEBOUNCE_MS = 50;
+
+    FileWatcher(const char *name, const std::vector<std::string> &dirs, Callback callback);
+    ~FileWatcher();
+
+    FileWatcher(const FileWatcher &) = delete;
+    void operator=(const FileWatcher &) = delete;
+
+    bool isValid() const { return (thread != NULL); }
+
+private:
+    bool addWatches(std::set<std::string> &changedPaths);
+    void readEvents(std::set<std::string> &changedPaths);
+
+    static gpointer watch_process(gpointer data);
+
+    std::vector<std::string> dirs;
+    std::vector<int> watchFds;      // per directory, -1 while it is missing
+    Callback callback;
+
+    int inotifyFd;
+    int stopFd;
+    GThread *thread;
+};
+
+#endif
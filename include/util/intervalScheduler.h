@@ -0,0 +1,86 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __INTERVALSCHEDULER_H__
+#define __INTERVALSCHEDULER_H__
+
+#include <glib.h>
+#include <atomic>
+
+// Fires on wall-clock aligned boundaries (multiples of the interval since the
+// epoch, like telegraf's round_interval) using an absolute CLOCK_REALTIME
+// timerfd, so the time spent in a cycle never shifts the next one.
+// Clock changes re-align the timer. wakeUp() interrupts a wait from another thread.
+class IntervalScheduler
+{
+public:
+    enum class WaitResult
+    {
+        TICK,
+        WOKEN,      // wakeUp() was called
+        TIMEOUT,    // not armed and the idle timeout expired
+        ERROR
+    };
+
+    struct Stats
+    {
+        guint64 ticks;
+        guint64 missedDeadlines;    // boundaries that passed while the previous cycle was running
+        gint64 lastDriftUs;         // how late the last tick was handled
+        gint64 maxDriftUs;
+        gint64 avgDriftUs;
+        gint64 intervalUs;
+    };
+
+    // intervals are clamped to at least this
+    static const gint64 MIN_INTERVAL_US = 100 * 1000;
+
+    IntervalScheduler();
+    ~IntervalScheduler();
+
+    IntervalScheduler(const IntervalScheduler &) = delete;
+    void operator=(const IntervalScheduler &) = delete;
+
+    bool isValid() const { return (timerFd >= 0) && (eventFd >= 0); }
+
+    // arms the timer for the next aligned boundary; 0 disarms it
+    bool setInterval(gint64 intervalUs);
+    gint64 interval() const { return intervalUs; }
+
+    // waits for the next tick; while disarmed, for at most idleTimeoutMs.
+    // 'missed' receives the number of boundaries skipped before this tick.
+    WaitResult wait(int idleTimeoutMs, guint64 *missed = nullptr);
+
+    // thread safe
+    void wakeUp();
+    Stats getStats() const;
+
+private:
+    bool arm();
+
+    int timerFd;
+    int eventFd;
+    std::atomic<gint64> intervalUs;
+    gint64 nextDeadlineUs;      // CLOCK_REALTIME
+
+    std::atomic<guint64> ticks;
+    std::atomic<guint64> missedDeadlines;
+    std::atomic<gint64> lastDriftUs;
+    std::atomic<gint64> maxDriftUs;
+    std::atomic<gint64> driftSumUs;
+};
+
+#endif
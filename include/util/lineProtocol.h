@@ -0,0 +1,85 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __LINEPROTOCOL_H__
+#define __LINEPROTOCOL_H__
+
+#include <stdint.h>
+#include <string>
+
+// InfluxDB line protocol encoder which appends to a caller-owned buffer.
+// https://docs.influxdata.com/influxdb/v1.8/write_protocols/line_protocol_reference/
+//
+//   LineProtocolEncoder lp(buffer);
+//   lp.measurement("processMonitoring")
+//     .tag("processName", name)
+//     .field("interval_cpu_usage", 12.5, 2)
+//     .field("interval_gpu_usage", (int64_t)1024)
+//     .timestamp(cycleTimestampNs);
+//
+// Names and tag values are escaped, integers get the 'i' suffix and floats are
+// formatted with a fixed precision without going through iostreams. Once the
+// buffer has reserved enough capacity no allocation happens.
+class LineProtocolEncoder
+{
+public:
+    explicit LineProtocolEncoder(std::string &buffer) : out(buffer), state(State::IDLE) {}
+
+    // starts a new record; a previous record in the buffer is terminated with '\n'
+    LineProtocolEncoder &measurement(const char *name);
+    LineProtocolEncoder &measurement(const std::string &name) { return measurement(name.c_str()); }
+
+    // empty tag values are not allowed by the protocol and are skipped
+    LineProtocolEncoder &tag(const char *key, const char *value, size_t valueLength);
+    LineProtocolEncoder &tag(const char *key, const char *value);
+    LineProtocolEncoder &tag(const char *key, const std::string &value) { return tag(key, value.data(), value.length()); }
+    LineProtocolEncoder &tag(const char *key, int64_t value);
+
+    LineProtocolEncoder &field(const char *key, int64_t value);
+    LineProtocolEncoder &field(const char *key, uint64_t value) { return field(key, (int64_t)value); }
+    LineProtocolEncoder &field(const char *key, int value) { return field(key, (int64_t)value); }
+    LineProtocolEncoder &field(const char *key, double value, int precision);
+    LineProtocolEncoder &field(const char *key, bool value);
+    LineProtocolEncoder &fieldString(const char *key, const char *value, size_t valueLength);
+
+    // nanoseconds since the epoch; omitted when 0
+    void timestamp(int64_t ns);
+
+    // true once at least one field was written (a record without fields is invalid)
+    bool hasFields() const { return state == State::FIELDS; }
+
+    static int64_t nowNs();
+
+    static void appendInt(std::string &out, int64_t value);
+    static void appendUInt(std::string &out, uint64_t value);
+    static void appendFixed(std::string &out, double value, int precision);
+
+private:
+    enum class State
+    {
+        IDLE,
+        TAGS,
+        FIELDS
+    };
+
+    void beginField(const char *key);
+    void appendEscaped(const char *str, size_t length, const char *specials);
+
+    std::string &out;
+    State state;
+};
+
+#endif
@@ -0,0 +1,122 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __MPSCRING_H__
+#define __MPSCRING_H__
+
+#include <glib.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Bounded multi-producer / single-consumer ring of preallocated record slots.
+// Based on the sequence-numbered bounded queue by Dmitry Vyukov.
+//
+// Every slot keeps a buffer of slotSize: push() copies the record into it and
+// pop() swaps it with the consumer's buffer, which goes back into the slot.
+// Once the buffers have circulated neither side allocates.
+class MpscRing
+{
+public:
+    enum class OverflowPolicy
+    {
+        DROP_OLDEST,
+        DROP_NEWEST,
+        BLOCK           // wait up to blockTimeoutUs, then drop the new record
+    };
+
+    struct Stats
+    {
+        guint64 pushed;
+        guint64 popped;
+        guint64 dropped;        // overflow, including oversized records
+        guint64 oversized;
+        size_t depth;
+        size_t highWaterMark;
+        size_t capacity;
+    };
+
+    // capacity is rounded up to a power of two, slotSize is the maximum record size
+    MpscRing(size_t capacity, size_t slotSize);
+
+    MpscRing(const MpscRing &) = delete;
+    void operator=(const MpscRing &) = delete;
+
+    void setOverflowPolicy(OverflowPolicy policy, gint64 blockTimeoutUs);
+
+    // producer side, thread safe; the caller keeps its own buffer
+    bool push(const char *data, size_t length);
+
+    // push() of every '\n' separated line of a batch, the consumer is woken
+    // once at the end. Returns how many lines were queued.
+    size_t pushLines(const char *data, size_t length);
+
+    // consumer side, one thread only. 'out' is replaced with the oldest record,
+    // 'enqueueTime' receives the g_get_monotonic_time() of its push.
+    bool pop(std::string &out, gint64 *enqueueTime = nullptr);
+
+    // wait until a record is available, wakeUp() is called or the timeout expires.
+    // timeoutUs < 0 waits without limit.
+    void waitForData(gint64 timeoutUs);
+    void wakeUp();
+
+    bool empty() const;
+    size_t depth() const;
+    Stats getStats() const;
+
+    static bool parseOverflowPolicy(const std::string &name, OverflowPolicy &policy);
+
+private:
+    struct Slot
+    {
+        std::atomic<size_t> sequence;
+        gint64 enqueueTime;
+        std::string data;
+    };
+
+    template <typename Fill>
+    bool enqueue(size_t length, Fill fill, bool notify = true);
+    bool discardOldest();
+    void notifyConsumer();
+    void updateHighWaterMark();
+
+    std::vector<Slot> slots;
+    size_t mask;
+    size_t slotSize;
+
+    alignas(64) std::atomic<size_t> enqueuePos;
+    alignas(64) std::atomic<size_t> dequeuePos;
+
+    std::atomic<int> overflowPolicy;
+    std::atomic<gint64> blockTimeoutUs;
+
+    std::mutex waitMutex;
+    std::condition_variable notEmpty;
+    std::condition_variable notFull;
+    std::atomic<bool> consumerWaiting;
+    std::atomic<int> producersWaiting;
+    bool wakeUpRequested;
+
+    std::atomic<guint64> pushedCount;
+    std::atomic<guint64> poppedCount;
+    std::atomic<guint64> droppedCount;
+    std::atomic<guint64> oversizedCount;
+    std::atomic<size_t> highWaterMark;
+};
+
+#endif
@@ -0,0 +1,67 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __PIPELINESTATS_H__
+#define __PIPELINESTATS_H__
+
+#include <glib.h>
+#include <atomic>
+#include <map>
+#include <vector>
+
+// Latency histogram with fixed bucket bounds. record() is lock-free and may
+// be called from any thread; snapshots are not atomic across buckets.
+class LatencyHistogram
+{
+public:
+    static const int BUCKET_COUNT = 16;
+
+    // upper bound (inclusive) of each bucket in usec, the last bucket is open-ended
+    static const guint64 BUCKET_BOUNDS_US[BUCKET_COUNT - 1];
+
+    LatencyHistogram();
+
+    void record(guint64 latencyUs);
+
+    // counts per bucket, BUCKET_COUNT entries
+    std::vector<guint64> snapshot() const;
+
+    // upper bound of the bucket containing the given percentile (0..100),
+    // G_MAXUINT64 when it falls into the open-ended bucket, 0 without samples
+    static guint64 percentile(const std::vector<guint64> &buckets, double percent);
+
+private:
+    std::atomic<guint64> buckets[BUCKET_COUNT];
+};
+
+// Count of failed operations by errno, lock-free
+class ErrnoCounters
+{
+public:
+    ErrnoCounters();
+
+    void count(int err);
+
+    // errno -> count for every errno seen at least once; 0 collects unknown values
+    std::map<int, guint64> snapshot() const;
+    guint64 total() const;
+
+private:
+    static const int MAX_ERRNO = 160;
+    std::atomic<guint64> counts[MAX_ERRNO];
+};
+
+#endif
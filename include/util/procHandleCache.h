@@ -0,0 +1,133 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __PROCHANDLECACHE_H__
+#define __PROCHANDLECACHE_H__
+
+#include <glib.h>
+#include <dirent.h>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Keeps /proc files of monitored processes open between collection cycles.
+// Each sample is a single pread() at offset 0 into a reused buffer instead of
+// open/read/close, and paths such as "<pid>/stat" are resolved with openat()
+// relative to a /proc directory fd instead of building "/proc/<pid>/..." strings.
+//
+// Files of threads (/proc/<pid>/task/<tid>) are read with open/pread/close:
+// a process can have hundreds of threads and their descriptors would push the
+// processes out of the budget below.
+//
+// A read failing with ESRCH means the process exited: its entry is closed and
+// one fresh open is tried, in case the pid was reused. Entries that are not
+// used for EVICT_AFTER_CYCLES cycles are closed by beginCycle().
+//
+// The open descriptors are capped by a budget taken from RLIMIT_NOFILE. Past
+// it the least recently used entries are closed, and when every entry is in use
+// by the current cycle or open() fails with EMFILE the file is read uncached.
+//
+// read() and readExe() may run on several threads at once as long as each pid
+// is sampled by one thread; beginCycle() and forEachPid() must not overlap them.
+class ProcHandleCache
+{
+public:
+    enum File
+    {
+        STAT,           // /proc/<pid>/stat
+        STATM,          // /proc/<pid>/statm
+        SMAPS_ROLLUP,   // /proc/<pid>/smaps_rollup, Linux 4.14 and later
+        SMAPS,          // /proc/<pid>/smaps, too large for read(), see readStream()
+        STATUS,         // /proc/<pid>/status
+        GPU,            // /proc/gpu/<pid>, not present on every target
+        FILE_COUNT
+    };
+
+    static const guint64 EVICT_AFTER_CYCLES = 3;
+
+    ProcHandleCache();
+    ~ProcHandleCache();
+
+    ProcHandleCache(const ProcHandleCache &) = delete;
+    void operator=(const ProcHandleCache &) = delete;
+
+    bool isValid() const { return (procFd >= 0); }
+
+    // call once per collection cycle, before the reads
+    void beginCycle();
+
+    // whole content of the file, NUL terminated. The buffer belongs to the
+    // calling thread and is reused by its next read. NULL when the process or
+    // the file does not exist.
+    const char *read(int pid, File file, size_t *length = nullptr);
+
+    // hands the file to consumer in chunks of a fixed size, for files that can
+    // be megabytes long. False when the process or the file does not exist or
+    // the process exited while being read.
+    typedef std::function<void(const char *data, size_t length)> Consumer;
+    bool readStream(int pid, File file, const Consumer &consumer);
+
+    // read() of /proc/<pid>/task/<tid>/<file>, the thread's own numbers, uncached
+    const char *readTask(int pid, int tid, File file, size_t *length = nullptr);
+
+    // tids of the threads of pid, through a directory stream kept open with
+    // the process entry. False when the process is gone.
+    bool readTasks(int pid, std::vector<int> &tids);
+
+    // target of /proc/<pid>/exe, false for kernel threads and exited processes
+    bool readExe(int pid, std::string &out);
+
+    // every numbered /proc entry, through one directory stream rewound each call
+    void forEachPid(const std::function<void(int pid)> &callback);
+
+    size_t size() const { return entries.size(); }
+    size_t openFileCount() const { return openFds; }
+
+private:
+    struct Entry
+    {
+        int fds[FILE_COUNT];        // -1 not opened yet
+        DIR *taskDir;               // /proc/<pid>/task, NULL until readTasks()
+        guint64 lastUsedCycle;
+        std::list<int>::iterator lruPosition;
+    };
+
+    typedef std::unordered_map<int, Entry> EntryMap;
+
+    Entry *lookup(int pid);
+    int openFile(int pid, Entry &entry, File file);
+    const char *readUncached(int pid, int tid, File file, std::vector<char> &buffer, size_t *length);
+    bool reserveFd();
+    void releaseFd();
+    void shrinkBudget();
+    void evict(int pid);
+    void dropEntry(EntryMap::iterator it);
+    void evictLeastRecentlyUsed();
+
+    int procFd;
+    DIR *procDir;
+    guint64 cycle;
+    size_t fdBudget;
+    size_t openFds;                 // descriptors held by the entries
+    std::mutex entriesMutex;        // the map, the LRU list and the fd count; an entry is used by one thread
+    EntryMap entries;
+    std::list<int> lruList;         // pids, most recently used first
+};
+
+#endif
@@ -0,0 +1,68 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __PROCMEMORY_H__
+#define __PROCMEMORY_H__
+
+#include <glib.h>
+#include <stddef.h>
+#include <string>
+
+// /proc/<pid>/statm converted from pages to kB
+struct ProcStatm
+{
+    guint64 sizeKb;                 // VSZ
+    guint64 residentKb;             // VmRSS
+    guint64 sharedKb;
+};
+
+bool parseProcStatm(const char *buffer, size_t length, ProcStatm &statm);
+
+// Sums of the "Key: <n> kB" lines of /proc/<pid>/smaps_rollup or /proc/<pid>/smaps
+struct SmapsTotals
+{
+    guint64 rssKb;
+    guint64 pssKb;
+    guint64 privateCleanKb;
+    guint64 privateDirtyKb;
+    guint64 swapKb;
+    guint64 swapPssKb;
+
+    // USS: memory no other process maps
+    guint64 ussKb() const { return privateCleanKb + privateDirtyKb; }
+};
+
+// Line parser fed with arbitrary chunks, a line split between two chunks is
+// kept until the rest arrives. smaps_rollup is a single mapping, so the same
+// parser handles both files.
+class SmapsParser
+{
+public:
+    SmapsParser() { reset(); }
+
+    void reset();
+    void feed(const char *data, size_t length);
+    // parses a last line without '\n'
+    const SmapsTotals &finish();
+
+private:
+    void parseLine(const char *line, size_t length);
+
+    SmapsTotals totals;
+    std::string partial;
+};
+
+#endif
@@ -0,0 +1,95 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __PROCSTAT_H__
+#define __PROCSTAT_H__
+
+#include <glib.h>
+#include <stddef.h>
+
+// Fields of /proc/<pid>/stat, see proc(5). Times are in clock ticks
+// (sysconf(_SC_CLK_TCK)), rss in pages, vsize in bytes.
+// Fields the running kernel does not print are left 0, 'fieldCount' says
+// how many were present (52 on current kernels).
+struct ProcStat
+{
+    int pid;
+    char comm[64];                  // without the parentheses, truncated to fit
+    char state;
+    int ppid;
+    int pgrp;
+    int session;
+    int ttyNr;
+    int tpgid;
+    guint32 flags;
+    guint64 minflt;
+    guint64 cminflt;
+    guint64 majflt;
+    guint64 cmajflt;
+    guint64 utime;
+    guint64 stime;
+    gint64 cutime;
+    gint64 cstime;
+    gint64 priority;
+    gint64 nice;
+    gint64 numThreads;
+    gint64 itrealvalue;
+    guint64 starttime;              // since boot
+    guint64 vsize;
+    gint64 rss;
+    guint64 rsslim;
+    guint64 startcode;
+    guint64 endcode;
+    guint64 startstack;
+    guint64 kstkesp;
+    guint64 kstkeip;
+    guint64 signal;
+    guint64 blocked;
+    guint64 sigignore;
+    guint64 sigcatch;
+    guint64 wchan;
+    guint64 nswap;
+    guint64 cnswap;
+    int exitSignal;
+    int processor;
+    guint32 rtPriority;
+    guint32 policy;
+    guint64 delayacctBlkioTicks;
+    guint64 guestTime;
+    gint64 cguestTime;
+    guint64 startData;
+    guint64 endData;
+    guint64 startBrk;
+    guint64 argStart;
+    guint64 argEnd;
+    guint64 envStart;
+    guint64 envEnd;
+    int exitCode;
+
+    int fieldCount;
+};
+
+// Parses the content of /proc/<pid>/stat in place, without allocating.
+// comm may contain spaces and parentheses, so it is taken up to the last ')'.
+// A field counts only when a space or the newline follows it, so a line cut
+// inside a number loses that field instead of reporting a smaller value.
+// Returns false when the buffer is not a stat line (at least up to stime).
+bool parseProcStat(const char *buffer, size_t length, ProcStat &stat);
+
+// voluntary_ctxt_switches and nonvoluntary_ctxt_switches of /proc/<pid>/status
+bool parseContextSwitches(const char *buffer, size_t length, guint64 &voluntary, guint64 &involuntary);
+
+#endif
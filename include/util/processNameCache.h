@@ -0,0 +1,80 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __PROCESSNAMECACHE_H__
+#define __PROCESSNAMECACHE_H__
+
+#include <glib.h>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// Names of the sampled processes, resolved once per (pid, starttime) instead
+// of a readlink() of /proc/<pid>/exe every cycle. A reused pid has another
+// starttime and is resolved again. execve() keeps pid and starttime but sets
+// comm to the new executable, so a comm that differs from the cached one is
+// resolved again too.
+//
+// The app id depends on the running list of the application manager: it is
+// resolved again when get() is called with another appGeneration.
+// Entries not seen for EVICT_AFTER_CYCLES cycles are dropped by beginCycle().
+// Thread safe, the resolvers run without the lock held.
+class ProcessNameCache
+{
+public:
+    struct Names
+    {
+        std::string exe;            // empty for kernel threads
+        std::string comm;
+        std::string appId;          // empty when not an app
+    };
+    typedef std::shared_ptr<const Names> NamesPtr;
+
+    typedef std::function<void(int pid, Names &names)> Resolver;
+
+    static const guint64 EVICT_AFTER_CYCLES = 3;
+
+    ProcessNameCache() : cycle(0) {}
+
+    ProcessNameCache(const ProcessNameCache &) = delete;
+    void operator=(const ProcessNameCache &) = delete;
+
+    void beginCycle();
+
+    // resolveNames fills exe and comm of a process seen for the first time or
+    // whose comm changed, resolveApp fills appId once exe and comm are set
+    NamesPtr get(int pid, guint64 starttime, const char *comm, guint64 appGeneration,
+                 const Resolver &resolveNames, const Resolver &resolveApp);
+
+    size_t size();
+
+private:
+    struct Entry
+    {
+        guint64 starttime;
+        guint64 appGeneration;
+        guint64 lastSeenCycle;
+        NamesPtr names;
+    };
+
+    std::mutex mutex;
+    guint64 cycle;
+    std::unordered_map<int, Entry> entries;
+};
+
+#endif
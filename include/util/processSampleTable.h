@@ -0,0 +1,81 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __PROCESSSAMPLETABLE_H__
+#define __PROCESSSAMPLETABLE_H__
+
+#include <glib.h>
+#include <mutex>
+#include <vector>
+
+// Previous CPU times of every sampled process or thread, for interval deltas.
+// Keyed by (pid, starttime) so a reused pid starts over instead of being
+// compared with an unrelated process. Flat open-addressing table with linear
+// probing and backward-shift deletion.
+//
+// Entries not updated during the previous cycle are evicted by beginCycle().
+// Thread safe.
+class ProcessSampleTable
+{
+public:
+    struct Sample
+    {
+        guint64 utime;              // clock ticks
+        guint64 stime;
+        gint64 timeUs;              // g_get_monotonic_time() when stat was read
+        guint64 voluntarySwitches;  // context switches, threads only
+        guint64 involuntarySwitches;
+    };
+
+    ProcessSampleTable();
+
+    ProcessSampleTable(const ProcessSampleTable &) = delete;
+    void operator=(const ProcessSampleTable &) = delete;
+
+    // starts a collection cycle, evicting processes not seen in the last one
+    void beginCycle();
+
+    // stores 'sample', returns false when the process was not known yet
+    bool update(int pid, guint64 starttime, const Sample &sample, Sample *previous);
+
+    // removes an exited process, returns false when it was not known
+    bool take(int pid, guint64 starttime, Sample *previous);
+
+    size_t size();
+
+private:
+    struct Slot
+    {
+        int pid;                    // 0: empty
+        guint32 generation;
+        guint64 starttime;
+        Sample sample;
+    };
+
+    size_t find(int pid, guint64 starttime) const;
+    void eraseAt(size_t index);
+    void grow();
+
+    static size_t hash(int pid, guint64 starttime);
+
+    std::mutex mutex;
+    std::vector<Slot> slots;
+    size_t mask;
+    size_t count;
+    guint32 generation;
+};
+
+#endif
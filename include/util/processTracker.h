@@ -0,0 +1,99 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __PROCESSTRACKER_H__
+#define __PROCESSTRACKER_H__
+
+#include <glib.h>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Live process table kept up to date by PROC_EVENT_FORK/EXEC/EXIT from the
+// netlink proc connector (needs CAP_NET_ADMIN), so a collection cycle does not
+// have to walk /proc. A full /proc scan reconciles the table every
+// RECONCILE_INTERVAL_SEC and after the kernel dropped events (ENOBUFS).
+//
+// Processes are recorded with their CPU time when they exit, so one that
+// lived for less than a collection interval is still reported.
+class ProcessTracker
+{
+public:
+    struct Process
+    {
+        int pid;
+        std::string exe;            // empty for kernel threads
+        std::string comm;
+    };
+
+    struct ExitedProcess
+    {
+        int pid;
+        std::string exe;            // comm when the process was gone before exec could be read
+        guint64 utime;              // clock ticks over the whole life
+        guint64 stime;
+        guint64 starttime;          // clock ticks since boot
+        gint64 exitTimeUs;          // g_get_monotonic_time() when the exit was seen
+        gint64 lifetimeUs;          // from starttime to the exit, valid with stat
+        bool statValid;             // false when the parent reaped it before we looked
+    };
+
+    static const int RECONCILE_INTERVAL_SEC = 60;
+    static const size_t MAX_EXITED = 4096;
+
+    ProcessTracker();
+    ~ProcessTracker();
+
+    ProcessTracker(const ProcessTracker &) = delete;
+    void operator=(const ProcessTracker &) = delete;
+
+    // subscribe and run the event thread; false when the connector is not available
+    bool start();
+    void stop();
+    bool isRunning();
+
+    // processes alive now, 'out' is reused
+    void getLiveProcesses(std::vector<Process> &out);
+    // processes that exited since the previous call
+    void takeExited(std::vector<ExitedProcess> &out);
+
+private:
+    bool subscribe(bool enable);
+    void reconcile();
+    void handleMessage(const char *data, size_t length);
+    void addProcess(int pid, const Process *parent);
+    void updateExe(int pid);
+    void removeProcess(int pid);
+
+    static bool readExe(int procFd, int pid, std::string &exe);
+    static bool readComm(int procFd, int pid, std::string &comm);
+
+    static gpointer tracker_process(gpointer data);
+
+    std::mutex lifecycleMutex;      // start() / stop()
+    GThread *thread;
+    int sock;
+    int stopFd;
+    int procFd;
+
+    std::mutex tableMutex;
+    std::unordered_map<int, Process> live;
+    std::vector<ExitedProcess> exited;
+    guint64 exitedDropped;
+};
+
+#endif
@@ -0,0 +1,85 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __SAMPLINGPOOL_H__
+#define __SAMPLINGPOOL_H__
+
+#include <glib.h>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Small fork-join pool for the per-process sampling of a collection cycle.
+// run() splits [0, count) into one contiguous range per worker; a worker that
+// finished its own range steals indexes from the others, so a few slow
+// processes do not hold up the cycle. The calling thread is worker 0, a pool
+// of one worker runs everything inline without any thread.
+class SamplingPool
+{
+public:
+    typedef std::function<void(size_t index, size_t worker)> Task;
+
+    static const size_t MAX_WORKERS = 16;
+
+    explicit SamplingPool(size_t workers);
+    ~SamplingPool();
+
+    SamplingPool(const SamplingPool &) = delete;
+    void operator=(const SamplingPool &) = delete;
+
+    size_t workers() const { return workerCount; }
+
+    // calls task(index, worker) once for every index, returns when all are done.
+    // Not reentrant, one run() at a time.
+    void run(size_t count, const Task &task);
+
+    // CPUs this process may run on
+    static size_t availableCpus();
+
+private:
+    struct alignas(64) Range
+    {
+        std::atomic<size_t> next;
+        size_t end;
+    };
+
+    struct WorkerArg
+    {
+        SamplingPool *pool;
+        size_t worker;
+    };
+
+    void work(size_t worker);
+    static gpointer worker_process(gpointer data);
+
+    size_t workerCount;
+    std::unique_ptr<Range[]> ranges;
+    std::vector<WorkerArg> args;
+    std::vector<GThread *> threads;
+
+    std::mutex mutex;
+    std::condition_variable startCondition;
+    std::condition_variable doneCondition;
+    guint64 round;
+    size_t running;
+    bool stopping;
+    const Task *task;
+};
+
+#endif
@@ -0,0 +1,153 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __SHMSAMPLES_H__
+#define __SHMSAMPLES_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+/**
+ * Latest value of every series collected by com.webos.service.sdkagent,
+ * published in a POSIX shared memory segment (/dev/shm/com.webos.service.sdkagent.samples).
+ *
+ * Layout, version 2 (native endianness, all offsets from the start of the segment):
+ *
+ *   ShmSegmentHeader                      headerSize bytes
+ *   ShmEntry[entryCapacity]               entrySize bytes each
+ *
+ * A series is one line-protocol series key, e.g.
+ *   processMonitoring,pid=123,processName=foo
+ * and keeps its entry for as long as the agent runs; entries [0, entryCount)
+ * are in use. When the segment is full the least recently updated series is
+ * replaced.
+ *
+ * There is a single writer. Each entry is protected by a seqlock: the writer
+ * makes 'sequence' odd, updates the data and makes it even again. A reader
+ * copies the data and retries when 'sequence' was odd or changed meanwhile,
+ * so readers never block the writer. 'generation' changes whenever the agent
+ * restarts and re-initializes the segment.
+ */
+
+#define SDKAGENT_SHM_NAME "/com.webos.service.sdkagent.samples"
+#define SDKAGENT_SHM_MAGIC 0x534d4453      // "SDMS"
+#define SDKAGENT_SHM_VERSION 2
+
+#define SHM_SERIES_SIZE 128
+#define SHM_FIELD_NAME_SIZE 32
+#define SHM_MAX_FIELDS 16
+
+enum ShmFieldType
+{
+    SHM_FIELD_NONE = 0,
+    SHM_FIELD_INT = 1,      // int64
+    SHM_FIELD_FLOAT = 2,    // double
+    SHM_FIELD_BOOL = 3      // int64, 0 or 1
+};
+
+struct ShmSegmentHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t headerSize;
+    uint32_t entrySize;
+    uint32_t entryCapacity;
+    std::atomic<uint32_t> entryCount;
+    int32_t writerPid;
+    uint32_t generation;
+    std::atomic<uint64_t> updateCount;      // total entry updates, for cheap change detection
+    int64_t createdNs;                      // CLOCK_REALTIME
+    std::atomic<uint64_t> truncatedCount;   // updates that had more than SHM_MAX_FIELDS numeric fields
+    uint8_t reserved[16];
+};
+
+struct ShmField
+{
+    char name[SHM_FIELD_NAME_SIZE];         // NUL terminated
+    uint32_t type;                          // ShmFieldType
+    uint32_t reserved;
+    union
+    {
+        int64_t intValue;
+        double floatValue;
+    };
+};
+
+// the part of an entry a reader gets a consistent copy of
+struct ShmEntryData
+{
+    char series[SHM_SERIES_SIZE];           // NUL terminated series key
+    int64_t timestampNs;                    // timestamp of the record, 0 when it had none
+    int64_t updatedNs;                      // CLOCK_REALTIME of the update
+    uint32_t fieldCount;
+    uint32_t reserved;
+    ShmField fields[SHM_MAX_FIELDS];
+};
+
+struct ShmEntry
+{
+    std::atomic<uint32_t> sequence;
+    uint32_t reserved;
+    ShmEntryData data;
+};
+
+static_assert(sizeof(ShmSegmentHeader) == 72, "ShmSegmentHeader layout changed");
+static_assert(sizeof(ShmEntry) == 928, "ShmEntry layout changed");
+static_assert(std::atomic<uint32_t>::is_always_lock_free && std::atomic<uint64_t>::is_always_lock_free,
+              "shared memory atomics must be lock-free");
+
+size_t shmSegmentSize(uint32_t entryCapacity);
+
+inline ShmEntry *shmEntryAt(void *segment, uint32_t index)
+{
+    ShmSegmentHeader *header = (ShmSegmentHeader *)segment;
+    return (ShmEntry *)((char *)segment + header->headerSize + (size_t)index * header->entrySize);
+}
+
+// Reader side, for tools linking libsdkagent-samples
+class ShmSampleReader
+{
+public:
+    ShmSampleReader();
+    ~ShmSampleReader();
+
+    ShmSampleReader(const ShmSampleReader &) = delete;
+    void operator=(const ShmSampleReader &) = delete;
+
+    // false when the agent has not created the segment or its layout is unknown
+    bool open(const char *name = SDKAGENT_SHM_NAME);
+    void close();
+    bool isOpen() const { return segment != nullptr; }
+
+    uint32_t count() const;
+    uint64_t updateCount() const;
+    uint64_t truncatedCount() const;
+    uint32_t generation() const;
+
+    // consistent copy of entry 'index'; false when out of range or the
+    // writer kept it busy for too long
+    bool read(uint32_t index, ShmEntryData &out) const;
+
+    // index of the series, -1 when not present
+    int find(const char *series) const;
+
+private:
+    void *segment;
+    size_t mappedSize;
+};
+
+#endif
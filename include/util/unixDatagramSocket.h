@@ -0,0 +1,76 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __UNIXDATAGRAMSOCKET_H__
+#define __UNIXDATAGRAMSOCKET_H__
+
+#include <glib.h>
+#include <string>
+
+// telegraf socket_listener reads datagrams into a 64KiB buffer
+#define MAX_DATAGRAM_SIZE_LIMIT (64 * 1024)
+
+// Long-lived, connected and non-blocking AF_UNIX datagram socket.
+// The peer (e.g. telegraf socket_listener) may disappear at any time, so the
+// connection is re-established lazily with exponential backoff.
+class UnixDatagramSocket
+{
+public:
+    enum class SendResult
+    {
+        SENT,
+        RETRY_LATER,    // peer is congested (EAGAIN/ENOBUFS), keep the data and try again
+        DISCONNECTED,   // peer is gone, the socket has been closed
+        FAILED          // the data itself cannot be sent (e.g. EMSGSIZE)
+    };
+
+    explicit UnixDatagramSocket(const std::string &path);
+    ~UnixDatagramSocket();
+
+    UnixDatagramSocket(const UnixDatagramSocket &) = delete;
+    void operator=(const UnixDatagramSocket &) = delete;
+
+    bool isConnected() const { return sockFd >= 0; }
+
+    // true when not connected and the reconnect backoff has elapsed
+    bool connectDue() const;
+
+    // connect if needed; returns false while the peer is unreachable
+    bool ensureConnected();
+
+    SendResult send(const char *data, size_t length);
+
+    void disconnect();
+
+    // SO_SNDBUF in bytes, applied on the next connect. 0 keeps the kernel default.
+    void setSendBufferSize(int bytes) { sendBufferSize = bytes; }
+
+    const std::string &path() const { return sockPath; }
+    int lastError() const { return lastErrno; }
+
+private:
+    bool tryConnect();
+
+    std::string sockPath;
+    int sockFd = -1;
+    int sendBufferSize = 0;
+    int lastErrno = 0;
+
+    gint64 nextConnectTime = 0;     // monotonic time in usec
+    gint64 backoffUs;
+};
+
+#endif
@@ -0,0 +1,80 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __WEBOSCONFIG_H__
+#define __WEBOSCONFIG_H__
+
+#include <glib.h>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <pbnjson.hpp>
+
+#include "fileWatcher.h"
+
+// Parsed /var/lib/com.webos.service.sdkagent/config.json, held in memory as an
+// immutable snapshot. An inotify watch on the directory reloads it when the
+// file is changed by someone else, write() publishes our own changes directly.
+//
+// snapshot() is lock free: every thread keeps the last snapshot it saw and only
+// goes to the shared pointer when the generation counter moved.
+class WebOSConfig
+{
+public:
+    typedef std::shared_ptr<const pbnjson::JValue> Snapshot;
+
+    static WebOSConfig *getInstance();
+
+    WebOSConfig(const WebOSConfig &) = delete;
+    void operator=(const WebOSConfig &) = delete;
+
+    // never modify the returned value, duplicate() it first
+    Snapshot snapshot();
+    // read-only "webOS.*" section of the current snapshot, null when missing
+    pbnjson::JValue section(const std::string &name) { return (*snapshot())[name]; }
+    guint64 generation() const { return currentGeneration.load(std::memory_order_acquire); }
+
+    // writes the file and publishes it as the new snapshot
+    bool write(const pbnjson::JValue &config);
+
+    // called on the publishing thread after every new snapshot
+    void addListener(std::function<void()> listener);
+
+private:
+    WebOSConfig();
+    ~WebOSConfig();
+
+    void reload();
+    void publish(const pbnjson::JValue &config);
+    void notifyListeners();
+
+    Snapshot current;                       // std::atomic_load / std::atomic_store only
+    std::atomic<guint64> currentGeneration;
+
+    std::mutex updateMutex;                 // serializes reload() and write()
+    bool loaded;
+    std::string loadedText;                 // file content behind 'current'
+
+    std::mutex listenersMutex;
+    std::vector<std::function<void()>> listeners;
+
+    FileWatcher *watcher;
+};
+
+#endif
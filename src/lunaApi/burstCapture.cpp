@@ -0,0 +1,379 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+#include "burstCapture.h"
+#include "common.h"
+#include "lineProtocol.h"
+#include "logging.h"
+#include "procMemory.h"
+#include "procStat.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#define INITIAL_BUFFER_SIZE 4096
+
+static const char *fileNames[] = {"stat", "statm", "status"};
+
+static const struct {
+    const char *name;
+    guint metric;
+} metricNames[] = {
+    {"cpu", BurstCapture::METRIC_CPU},
+    {"memory", BurstCapture::METRIC_MEMORY},
+    {"ctxsw", BurstCapture::METRIC_CONTEXT_SWITCHES},
+    {"faults", BurstCapture::METRIC_FAULTS},
+};
+
+static const double clockTicksPerSec = (double)sysconf(_SC_CLK_TCK);
+
+static guint64 increase(guint64 current, guint64 previous)
+{
+    return (current >= previous) ? (current - previous) : 0;
+}
+
+static gint64 monotonicNs()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (gint64)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+bool BurstCapture::parseRequest(const pbnjson::JValue &params, Request &request)
+{
+    if (!params.isObject()) return false;
+
+    request.pid = 0;
+    request.appId.clear();
+    if (params.hasKey("pid"))
+    {
+        if (!params["pid"].isNumber()) return false;
+        int64_t pid = params["pid"].asNumber<int64_t>();
+        if ((pid <= 0) || (pid > INT_MAX)) return false;
+        request.pid = (int)pid;
+    }
+    else if (params.hasKey("appId"))
+    {
+        if (!params["appId"].isString()) return false;
+        request.appId = params["appId"].asString();
+        if (request.appId.empty()) return false;
+    }
+    else
+    {
+        return false;
+    }
+
+    request.rateHz = (int)jsonNumberOrDefault(params, "rateHz", DEFAULT_RATE_HZ);
+    request.durationMs = jsonNumberOrDefault(params, "durationMs", DEFAULT_DURATION_MS);
+    if ((request.rateHz < MIN_RATE_HZ) || (request.rateHz > MAX_RATE_HZ) ||
+        (request.durationMs < MIN_DURATION_MS) || (request.durationMs > MAX_DURATION_MS))
+        return false;
+
+    request.metrics = METRIC_CPU | METRIC_MEMORY;
+    if (params.hasKey("metrics"))
+    {
+        pbnjson::JValue names = params["metrics"];
+        if (!names.isArray() || (names.arraySize() == 0)) return false;
+
+        request.metrics = 0;
+        for (int i = 0; i < names.arraySize(); i++)
+        {
+            guint metric = 0;
+            for (auto &known : metricNames)
+            {
+                if (names[i].isString() && (names[i].asString() == known.name))
+                    metric = known.metric;
+            }
+            if (metric == 0) return false;
+            request.metrics |= metric;
+        }
+    }
+
+    request.subscribe = params.hasKey("subscribe") && params["subscribe"].isBoolean() && params["subscribe"].asBool();
+    request.once = params.hasKey("once") && params["once"].isBoolean() && params["once"].asBool();
+    return true;
+}
+
+BurstCapture::BurstCapture(const Request &burstRequest) : request(burstRequest),
+                                                         cpuClock(0),
+                                                         hasCpuClock(false),
+                                                         buffer(INITIAL_BUFFER_SIZE),
+                                                         thread(NULL),
+                                                         startUs(0),
+                                                         published(0),
+                                                         missed(0),
+                                                         exited(false),
+                                                         stopRequested(false),
+                                                         done(false)
+{
+    for (int i = 0; i < FILE_COUNT; i++)
+        fds[i] = -1;
+}
+
+BurstCapture::~BurstCapture()
+{
+    stop();
+    if (thread) g_thread_join(thread);
+    for (int i = 0; i < FILE_COUNT; i++)
+    {
+        if (fds[i] >= 0) close(fds[i]);
+    }
+}
+
+// the files are opened once: a read after the process exited fails with
+// ESRCH instead of reaching a new process which got the same pid. stat is
+// always open for that, the CPU clock alone would follow the new process.
+bool BurstCapture::open()
+{
+    char path[32];
+    snprintf(path, sizeof(path), "/proc/%d", request.pid);
+    int dirFd = ::open(path, O_PATH | O_DIRECTORY | O_CLOEXEC);
+    if (dirFd < 0) return false;
+
+    // the CPU-time clock of the whole thread group, in ns instead of clock ticks
+    if (request.metrics & METRIC_CPU)
+        hasCpuClock = (clock_getcpuclockid(request.pid, &cpuClock) == 0);
+
+    bool wanted[FILE_COUNT] = {};
+    wanted[STAT] = true;
+    wanted[STATM] = (request.metrics & METRIC_MEMORY);
+    wanted[STATUS] = (request.metrics & METRIC_CONTEXT_SWITCHES);
+
+    bool opened = true;
+    for (int i = 0; opened && (i < FILE_COUNT); i++)
+    {
+        if (!wanted[i]) continue;
+        fds[i] = openat(dirFd, fileNames[i], O_RDONLY | O_CLOEXEC);
+        opened = (fds[i] >= 0);
+    }
+    close(dirFd);
+    return opened;
+}
+
+bool BurstCapture::start()
+{
+    samples.resize((size_t)(request.rateHz * request.durationMs / 1000));
+    thread = g_thread_try_new("BurstCapture", BurstCapture::process, this, NULL);
+    if (thread == NULL)
+    {
+        SDK_LOG_ERROR(MSGID_SDKAGENT, 0, "Cannot create the burst capture thread");
+        return false;
+    }
+    return true;
+}
+
+void BurstCapture::stop()
+{
+    stopRequested.store(true);
+}
+
+const char *BurstCapture::readFile(File file, size_t *length)
+{
+    if (fds[file] < 0) return NULL;
+
+    ssize_t n;
+    while (true)
+    {
+        n = pread(fds[file], buffer.data(), buffer.size() - 1, 0);
+        if ((n < 0) || ((size_t)n < buffer.size() - 1)) break;
+        buffer.resize(buffer.size() * 2);
+    }
+    if (n <= 0) return NULL;
+
+    buffer[n] = '\0';
+    *length = (size_t)n;
+    return buffer.data();
+}
+
+// false once the process is gone
+bool BurstCapture::readCounters(Counters &counters)
+{
+    counters = Counters();
+    counters.timeUs = g_get_monotonic_time();
+
+    size_t length = 0;
+    const char *data = NULL;
+    if ((request.metrics & METRIC_CPU) && hasCpuClock)
+    {
+        struct timespec cpuTime;
+        if (clock_gettime(cpuClock, &cpuTime) != 0) return false;
+        counters.cpuTimeNs = (guint64)cpuTime.tv_sec * 1000000000 + cpuTime.tv_nsec;
+    }
+
+    // read after the clock, every sample: while it succeeds the pid was not reused
+    ProcStat stat;
+    if (((data = readFile(STAT, &length)) == NULL) || !parseProcStat(data, length, stat)) return false;
+    counters.minorFaults = stat.minflt;
+    counters.majorFaults = stat.majflt;
+    if ((request.metrics & METRIC_CPU) && !hasCpuClock)
+        counters.cpuTimeNs = (guint64)((stat.utime + stat.stime) * 1e9 / clockTicksPerSec);
+
+    if (fds[STATM] >= 0)
+    {
+        ProcStatm statm;
+        if (((data = readFile(STATM, &length)) == NULL) || !parseProcStatm(data, length, statm)) return false;
+        counters.rssKb = statm.residentKb;
+    }
+
+    if (fds[STATUS] >= 0)
+    {
+        if (((data = readFile(STATUS, &length)) == NULL) ||
+            !parseContextSwitches(data, length, counters.voluntarySwitches, counters.involuntarySwitches))
+            return false;
+    }
+    return true;
+}
+
+gpointer BurstCapture::process(gpointer data)
+{
+    BurstCapture *self = (BurstCapture *)data;
+
+    Counters previous;
+    if (!self->readCounters(previous))
+    {
+        self->exited.store(true);
+        self->done.store(true, std::memory_order_release);
+        return NULL;
+    }
+    self->startUs = previous.timeUs;
+
+    // absolute deadlines, the time spent reading never shifts the next sample
+    gint64 periodNs = 1000000000 / self->request.rateHz;
+    gint64 endNs = self->startUs * 1000 + self->request.durationMs * 1000000;
+    gint64 nextNs = self->startUs * 1000;
+    size_t count = 0;
+
+    while (!self->stopRequested.load() && (count < self->samples.size()))
+    {
+        nextNs += periodNs;
+        if (nextNs > endNs) break;
+
+        struct timespec deadline = {(time_t)(nextNs / 1000000000), (long)(nextNs % 1000000000)};
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) == EINTR)
+            ;
+        if (self->stopRequested.load()) break;
+
+        Counters current;
+        if (!self->readCounters(current))
+        {
+            self->exited.store(true);
+            break;
+        }
+
+        Sample &sample = self->samples[count];
+        sample.timeUs = current.timeUs - self->startUs;
+        gint64 elapsedUs = current.timeUs - previous.timeUs;
+        sample.cpuPercent = (elapsedUs > 0) ? increase(current.cpuTimeNs, previous.cpuTimeNs) / 10.0 / elapsedUs : 0;
+        sample.rssKb = current.rssKb;
+        sample.voluntarySwitches = increase(current.voluntarySwitches, previous.voluntarySwitches);
+        sample.involuntarySwitches = increase(current.involuntarySwitches, previous.involuntarySwitches);
+        sample.minorFaults = increase(current.minorFaults, previous.minorFaults);
+        sample.majorFaults = increase(current.majorFaults, previous.majorFaults);
+        self->published.store(++count, std::memory_order_release);
+        previous = current;
+
+        // a late read skips the periods that already passed instead of sampling back to back
+        gint64 lateNs = monotonicNs() - nextNs;
+        if (lateNs > periodNs)
+        {
+            gint64 skipped = lateNs / periodNs;
+            nextNs += skipped * periodNs;
+            self->missed.fetch_add((guint64)skipped, std::memory_order_relaxed);
+        }
+    }
+
+    self->done.store(true, std::memory_order_release);
+    return NULL;
+}
+
+bool BurstCapture::sampleOnce(pbnjson::JValue &sample)
+{
+    Counters counters;
+    if (!readCounters(counters)) return false;
+
+    sample = pbnjson::Object();
+    if (request.metrics & METRIC_CPU)
+        sample.put("cpu_time_us", (int64_t)(counters.cpuTimeNs / 1000));
+    if (request.metrics & METRIC_MEMORY)
+        sample.put("rss_kb", (int64_t)counters.rssKb);
+    if (request.metrics & METRIC_CONTEXT_SWITCHES)
+    {
+        sample.put("voluntary_ctxt_switches", (int64_t)counters.voluntarySwitches);
+        sample.put("nonvoluntary_ctxt_switches", (int64_t)counters.involuntarySwitches);
+    }
+    if (request.metrics & METRIC_FAULTS)
+    {
+        sample.put("minor_faults", (int64_t)counters.minorFaults);
+        sample.put("major_faults", (int64_t)counters.majorFaults);
+    }
+    return true;
+}
+
+void BurstCapture::appendColumns(std::string &json) const
+{
+    json += "[\"t_us\"";
+    if (request.metrics & METRIC_CPU)
+        json += ",\"cpu_percent\"";
+    if (request.metrics & METRIC_MEMORY)
+        json += ",\"rss_kb\"";
+    if (request.metrics & METRIC_CONTEXT_SWITCHES)
+        json += ",\"voluntary_ctxt_switches\",\"nonvoluntary_ctxt_switches\"";
+    if (request.metrics & METRIC_FAULTS)
+        json += ",\"minor_faults\",\"major_faults\"";
+    json += ']';
+}
+
+// only samples below publishedCount() may be read while the capture runs
+void BurstCapture::appendSamples(std::string &json, size_t from, size_t to) const
+{
+    for (size_t i = from; i < to; i++)
+    {
+        const Sample &sample = samples[i];
+        if (i > from) json += ',';
+        json += '[';
+        LineProtocolEncoder::appendInt(json, sample.timeUs);
+        if (request.metrics & METRIC_CPU)
+        {
+            json += ',';
+            LineProtocolEncoder::appendFixed(json, sample.cpuPercent, 1);
+        }
+        if (request.metrics & METRIC_MEMORY)
+        {
+            json += ',';
+            LineProtocolEncoder::appendUInt(json, sample.rssKb);
+        }
+        if (request.metrics & METRIC_CONTEXT_SWITCHES)
+        {
+            json += ',';
+            LineProtocolEncoder::appendUInt(json, sample.voluntarySwitches);
+            json += ',';
+            LineProtocolEncoder::appendUInt(json, sample.involuntarySwitches);
+        }
+        if (request.metrics & METRIC_FAULTS)
+        {
+            json += ',';
+            LineProtocolEncoder::appendUInt(json, sample.minorFaults);
+            json += ',';
+            LineProtocolEncoder::appendUInt(json, sample.majorFaults);
+        }
+        json += ']';
+    }
+}
@@ -0,0 +1,480 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "influxHttpSink.h"
+#include "common.h"
+#include "logging.h"
+#include "webOSConfig.h"
+
+#include <ctype.h>
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define DEFAULT_BATCH_SIZE_KB 512
+#define DEFAULT_FLUSH_INTERVAL_MS 1000
+#define DEFAULT_MAX_RETRIES 3
+#define DEFAULT_RETRY_BACKOFF_MS 200
+#define DEFAULT_TIMEOUT_MS 5000
+#define MAX_RETRY_BACKOFF_US (10 * G_USEC_PER_SEC)
+
+// smaller bodies are sent as is, the gzip header alone is 18 bytes
+#define GZIP_MIN_SIZE 1024
+// cheap on the CPU, line protocol still shrinks to roughly a fifth
+#define GZIP_LEVEL 1
+
+#define MAX_RESPONSE_HEADER_SIZE (16 * 1024)
+#define MAX_RESPONSE_BODY_SIZE (256 * 1024)
+
+InfluxHttpSink::InfluxHttpSink(const std::string &name, const std::vector<std::string> &urls, const std::string &database) : MetricSink(name),
+                                                                                                                             currentEndpoint(0),
+                                                                                                                             sockFd(-1),
+                                                                                                                             useGzip(true),
+                                                                                                                             batchBytes(DEFAULT_BATCH_SIZE_KB * 1024),
+                                                                                                                             flushIntervalUs(DEFAULT_FLUSH_INTERVAL_MS * 1000),
+                                                                                                                             maxRetries(DEFAULT_MAX_RETRIES),
+                                                                                                                             retryBackoffUs(DEFAULT_RETRY_BACKOFF_MS * 1000),
+                                                                                                                             timeoutMs(DEFAULT_TIMEOUT_MS),
+                                                                                                                             zStreamReady(false)
+{
+    for (auto &url : urls)
+    {
+        Endpoint endpoint;
+        if (parseUrl(url, database, endpoint)) {
+            endpoints.push_back(endpoint);
+        }
+        else {
+            SDK_LOG_WARNING(MSGID_SDKAGENT, 0, "Ignoring unsupported influxdb url '%s', only http:// is supported", url.c_str());
+        }
+    }
+
+    memset(&zStream, 0, sizeof(zStream));
+    // windowBits 15 + 16 selects the gzip wrapper
+    zStreamReady = (deflateInit2(&zStream, GZIP_LEVEL, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) == Z_OK);
+}
+
+InfluxHttpSink::~InfluxHttpSink()
+{
+    disconnect();
+    if (zStreamReady) deflateEnd(&zStream);
+}
+
+static std::string urlEncode(const std::string &value)
+{
+    static const char hex[] = "0123456789ABCDEF";
+    std::string ret;
+    for (unsigned char c : value)
+    {
+        if (isalnum(c) || (c == '-') || (c == '_') || (c == '.') || (c == '~')) {
+            ret.push_back(c);
+        }
+        else {
+            ret.push_back('%');
+            ret.push_back(hex[c >> 4]);
+            ret.push_back(hex[c & 0x0f]);
+        }
+    }
+    return ret;
+}
+
+// http://host[:port][/path]
+bool InfluxHttpSink::parseUrl(const std::string &url, const std::string &database, Endpoint &endpoint)
+{
+    const std::string scheme = "http://";
+    if (url.compare(0, scheme.length(), scheme) != 0)
+        return false;
+
+    size_t hostStart = scheme.length();
+    size_t pathStart = url.find('/', hostStart);
+    std::string authority = url.substr(hostStart, (pathStart == std::string::npos) ? std::string::npos : pathStart - hostStart);
+    std::string path = (pathStart == std::string::npos) ? "" : url.substr(pathStart);
+    if (authority.empty() || (authority.find('@') != std::string::npos))
+        return false;
+
+    endpoint.url = url;
+    endpoint.hostHeader = authority;
+    endpoint.port = "8086";
+    if (authority[0] == '[')
+    {
+        // [IPv6]:port
+        size_t close = authority.find(']');
+        if (close == std::string::npos) return false;
+        endpoint.host = authority.substr(1, close - 1);
+        if ((close + 1 < authority.length()) && (authority[close + 1] == ':'))
+            endpoint.port = authority.substr(close + 2);
+    }
+    else
+    {
+        size_t colon = authority.rfind(':');
+        endpoint.host = authority.substr(0, colon);
+        if (colon != std::string::npos)
+            endpoint.port = authority.substr(colon + 1);
+    }
+    if (endpoint.host.empty() || endpoint.port.empty())
+        return false;
+
+    while (!path.empty() && (path.back() == '/'))
+        path.pop_back();
+    endpoint.writePath = path + "/write?db=" + urlEncode(database) + "&precision=ns";
+    return true;
+}
+
+// "webOS.influxdb": {
+//     "enabled": <write the agent's measurements to outputs.influxdb directly>,
+//     "batch_size_kb": <uncompressed bytes per request>,
+//     "flush_interval_ms": <how long a partially filled batch may wait>,
+//     "gzip": <compress request bodies>,
+//     "max_retries": <retries per batch on 5xx / connection errors>,
+//     "retry_backoff_ms": <first retry delay, doubled on each retry>,
+//     "timeout_ms": <connect / send / response timeout>
+// }
+void InfluxHttpSink::configure(const pbnjson::JValue &socketConfig)
+{
+    pbnjson::JValue config = WebOSConfig::getInstance()->section("webOS.influxdb");
+    useGzip = !(config.isObject() && config.hasKey("gzip") && config["gzip"].isBoolean() && !config["gzip"].asBool());
+    batchBytes = (size_t)CLAMP(jsonNumberOrDefault(config, "batch_size_kb", DEFAULT_BATCH_SIZE_KB), 1, 16 * 1024) * 1024;
+    flushIntervalUs = CLAMP(jsonNumberOrDefault(config, "flush_interval_ms", DEFAULT_FLUSH_INTERVAL_MS), 10, 60000) * 1000;
+    maxRetries = (int)CLAMP(jsonNumberOrDefault(config, "max_retries", DEFAULT_MAX_RETRIES), 0, 10);
+    retryBackoffUs = CLAMP(jsonNumberOrDefault(config, "retry_backoff_ms", DEFAULT_RETRY_BACKOFF_MS), 10, 10000) * 1000;
+    timeoutMs = (int)CLAMP(jsonNumberOrDefault(config, "timeout_ms", DEFAULT_TIMEOUT_MS), 100, 60000);
+}
+
+bool InfluxHttpSink::ready()
+{
+    if (sockFd >= 0) return true;
+    return !endpoints.empty() && connectEndpoint(endpoints[currentEndpoint]);
+}
+
+bool InfluxHttpSink::connectEndpoint(const Endpoint &endpoint)
+{
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    struct addrinfo *addrs = NULL;
+    int ret = getaddrinfo(endpoint.host.c_str(), endpoint.port.c_str(), &hints, &addrs);
+    if (ret != 0)
+    {
+        SDK_LOG_WARNING(MSGID_SDKAGENT, 0, "Cannot resolve %s [%s]", endpoint.host.c_str(), gai_strerror(ret));
+        errors.count(0);
+        return false;
+    }
+
+    for (struct addrinfo *addr = addrs; addr != NULL; addr = addr->ai_next)
+    {
+        int fd = socket(addr->ai_family, addr->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, addr->ai_protocol);
+        if (fd < 0) continue;
+
+        int err = 0;
+        if (connect(fd, addr->ai_addr, addr->ai_addrlen) < 0)
+        {
+            err = errno;
+            if (err == EINPROGRESS)
+            {
+                socklen_t len = sizeof(err);
+                if (!waitReady(fd, POLLOUT))
+                    err = errno;
+                else if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) < 0)
+                    err = errno;
+            }
+        }
+
+        if (err == 0)
+        {
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            sockFd = fd;
+            break;
+        }
+
+        close(fd);
+        if (err == ECANCELED)
+            break;
+        errors.count(err);
+        SDK_LOG_WARNING(MSGID_SDKAGENT, 0, "Cannot connect to %s [%d:%s]", endpoint.url.c_str(), err, strerror(err));
+    }
+
+    freeaddrinfo(addrs);
+    return sockFd >= 0;
+}
+
+// waits up to timeoutMs for 'fd', errno is ETIMEDOUT or ECANCELED (stop requested) on false
+bool InfluxHttpSink::waitReady(int fd, short events)
+{
+    struct pollfd pfds[2] = {{fd, events, 0}, {stopFd, POLLIN, 0}};
+    while (true)
+    {
+        if (stopRequested()) {
+            errno = ECANCELED;
+            return false;
+        }
+
+        int ready = poll(pfds, (stopFd >= 0) ? 2 : 1, timeoutMs);
+        if (ready > 0)
+        {
+            if (pfds[1].revents != 0) {
+                errno = ECANCELED;
+                return false;
+            }
+            return true;
+        }
+        if (ready == 0) {
+            errno = ETIMEDOUT;
+            return false;
+        }
+        if (errno != EINTR)
+            return false;
+    }
+}
+
+void InfluxHttpSink::disconnect()
+{
+    if (sockFd >= 0) {
+        close(sockFd);
+        sockFd = -1;
+    }
+}
+
+bool InfluxHttpSink::sendAll(const char *data, size_t length)
+{
+    size_t sent = 0;
+    while (sent < length)
+    {
+        ssize_t ret = ::send(sockFd, data + sent, length - sent, MSG_NOSIGNAL);
+        if (ret >= 0) {
+            sent += ret;
+            continue;
+        }
+        if (errno == EINTR) continue;
+        if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+        {
+            if (waitReady(sockFd, POLLOUT)) continue;
+        }
+        errors.count(errno);
+        return false;
+    }
+    return true;
+}
+
+static bool headerHasValue(const std::string &headers, const char *name, const char *value)
+{
+    size_t pos = headers.find(name);
+    if (pos == std::string::npos) return false;
+    size_t end = headers.find("\r\n", pos);
+    return headers.substr(pos, end - pos).find(value) != std::string::npos;
+}
+
+// reads one response; the body is only kept for error messages
+bool InfluxHttpSink::readResponse(int &status, bool &keepAlive)
+{
+    response.clear();
+    size_t headerEnd = std::string::npos;
+    size_t bodyLength = 0;
+    bool chunked = false;
+    bool lengthKnown = false;
+    char buffer[4096];
+
+    while (true)
+    {
+        if (headerEnd != std::string::npos)
+        {
+            size_t have = response.length() - (headerEnd + 4);
+            if (lengthKnown && (have >= bodyLength))
+                break;
+            if (chunked && (response.compare(response.length() - MIN(response.length(), 5), 5, "0\r\n\r\n") == 0))
+                break;
+            if (have > MAX_RESPONSE_BODY_SIZE) {
+                keepAlive = false;
+                break;
+            }
+        }
+        else if (response.length() > MAX_RESPONSE_HEADER_SIZE)
+        {
+            return false;
+        }
+
+        if (!waitReady(sockFd, POLLIN))
+        {
+            errors.count(errno);
+            return false;
+        }
+
+        ssize_t ret = recv(sockFd, buffer, sizeof(buffer), 0);
+        if (ret < 0)
+        {
+            if ((errno == EINTR) || (errno == EAGAIN) || (errno == EWOULDBLOCK)) continue;
+            errors.count(errno);
+            return false;
+        }
+        if (ret == 0)
+        {
+            // closed by the server: fine once the headers are complete and there is no length
+            if ((headerEnd == std::string::npos) || lengthKnown || chunked) return false;
+            keepAlive = false;
+            break;
+        }
+        response.append(buffer, ret);
+
+        if (headerEnd == std::string::npos)
+        {
+            headerEnd = response.find("\r\n\r\n");
+            if (headerEnd == std::string::npos) continue;
+
+            // HTTP/1.x NNN ...
+            if ((response.compare(0, 7, "HTTP/1.") != 0) || (response.length() < 12))
+                return false;
+            status = atoi(response.c_str() + 9);
+
+            std::string headers = response.substr(0, headerEnd + 2);
+            for (auto &c : headers) c = tolower(c);
+
+            keepAlive = (headers.compare(0, 8, "http/1.1") == 0) ? !headerHasValue(headers, "\r\nconnection:", "close")
+                                                                 : headerHasValue(headers, "\r\nconnection:", "keep-alive");
+            chunked = headerHasValue(headers, "\r\ntransfer-encoding:", "chunked");
+            size_t pos = headers.find("\r\ncontent-length:");
+            if (pos != std::string::npos) {
+                bodyLength = strtoul(headers.c_str() + pos + 17, NULL, 10);
+                lengthKnown = true;
+            }
+            else if ((status == 204) || (status == 304) || (status < 200)) {
+                bodyLength = 0;
+                lengthKnown = true;
+            }
+            else if (!chunked) {
+                // body ends when the server closes the connection
+                keepAlive = false;
+            }
+        }
+    }
+    return status > 0;
+}
+
+InfluxHttpSink::PostResult InfluxHttpSink::post(const Endpoint &endpoint, const char *body, size_t length, bool gzipped)
+{
+    request.clear();
+    request.append("POST ").append(endpoint.writePath).append(" HTTP/1.1\r\n");
+    request.append("Host: ").append(endpoint.hostHeader).append("\r\n");
+    request.append("User-Agent: sdkagent\r\n");
+    request.append("Content-Type: text/plain; charset=utf-8\r\n");
+    if (gzipped)
+        request.append("Content-Encoding: gzip\r\n");
+    request.append("Content-Length: ").append(std::to_string(length)).append("\r\n");
+    request.append("Connection: keep-alive\r\n\r\n");
+
+    for (int pass = 0; pass < 2; pass++)
+    {
+        bool reused = (sockFd >= 0);
+        if (!reused && !connectEndpoint(endpoint))
+            return PostResult::CONNECTION_FAILED;
+
+        int status = 0;
+        bool keepAlive = true;
+        if (sendAll(request.data(), request.length()) && sendAll(body, length) && readResponse(status, keepAlive))
+        {
+            if (!keepAlive)
+                disconnect();
+
+            if ((status >= 200) && (status < 300))
+                return PostResult::OK;
+
+            size_t bodyStart = response.find("\r\n\r\n");
+            std::string message = (bodyStart == std::string::npos) ? "" : response.substr(bodyStart + 4, 256);
+            SDK_LOG_WARNING(MSGID_SDKAGENT, 0, "%s returned %d: %s", endpoint.url.c_str(), status, message.c_str());
+            if ((status == 429) || (status >= 500))
+                return PostResult::RETRY;
+            return PostResult::REJECTED;
+        }
+
+        disconnect();
+        // an idle keep-alive connection may have been closed by the server, retry once on a new one.
+        // influxdb overwrites identical points, so a batch that did arrive is not duplicated
+        if (!reused || stopRequested())
+            break;
+    }
+    return PostResult::CONNECTION_FAILED;
+}
+
+bool InfluxHttpSink::compress(const char *data, size_t length)
+{
+    if (!zStreamReady || (deflateReset(&zStream) != Z_OK))
+        return false;
+
+    compressed.resize(deflateBound(&zStream, length));
+    zStream.next_in = (Bytef *)data;
+    zStream.avail_in = length;
+    zStream.next_out = (Bytef *)&compressed[0];
+    zStream.avail_out = compressed.size();
+
+    if (deflate(&zStream, Z_FINISH) != Z_STREAM_END)
+        return false;
+
+    compressed.resize(zStream.total_out);
+    return true;
+}
+
+MetricSink::WriteResult InfluxHttpSink::write(const char *data, size_t length)
+{
+    if (endpoints.empty())
+        return WriteResult::FAILED;
+
+    const char *body = data;
+    size_t bodyLength = length;
+    bool gzipped = false;
+    if (useGzip && (length >= GZIP_MIN_SIZE) && compress(data, length))
+    {
+        body = compressed.data();
+        bodyLength = compressed.length();
+        gzipped = true;
+    }
+
+    gint64 backoffUs = retryBackoffUs;
+    for (int attempt = 0; ; attempt++)
+    {
+        // the stopping thread waits for this write, what is left goes to the spool
+        if (stopRequested())
+            return WriteResult::RETRY_LATER;
+
+        PostResult result = post(endpoints[currentEndpoint], body, bodyLength, gzipped);
+        if (result == PostResult::OK)
+            return WriteResult::WRITTEN;
+        if (result == PostResult::REJECTED)
+            return WriteResult::FAILED;
+        if (stopRequested())
+            return WriteResult::RETRY_LATER;
+
+        if (result == PostResult::CONNECTION_FAILED)
+        {
+            // fail over to the next url
+            disconnect();
+            currentEndpoint = (currentEndpoint + 1) % endpoints.size();
+        }
+
+        if (attempt >= maxRetries)
+            return (result == PostResult::RETRY) ? WriteResult::RETRY_LATER : WriteResult::UNREACHABLE;
+
+        if (!sleepUnlessStopped(backoffUs))
+            return WriteResult::RETRY_LATER;
+        backoffUs = MIN(backoffUs * 2, MAX_RETRY_BACKOFF_US);
+    }
+}
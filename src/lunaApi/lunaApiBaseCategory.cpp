@@ -137,6 +137,21 @@ void LunaApiBaseCategory::LSMessageReplyErrorDevModeDisable(LSHandle *sh, LSMess
     return;
 }
 
+void LunaApiBaseCategory::LSMessageReplyErrorCaptureInProgress(LSHandle *sh, LSMessage *msg)
+{
+    LSError lserror;
+    LSErrorInit(&lserror);
+
+    bool retVal = LSMessageReply(sh, msg, getErrorMessage(SDKError::CAPTURE_IN_PROGRESS), NULL);
+    if (!retVal)
+    {
+        LSErrorPrint(&lserror, stderr);
+        LSErrorFree(&lserror);
+    }
+
+    return;
+}
+
 void LunaApiBaseCategory::LSMessageReplyPayload(LSHandle *sh, LSMessage *msg, const char *payload)
 {
     LSError lserror;
@@ -21,9 +21,11 @@
 #include "tomlParser.h"
 #include "common.h"
 #include "telegrafController.h"
+#include "runningApps.h"
 #include <algorithm>
 #include <json-c/json.h>
 #include <pbnjson.hpp>
+#include <string.h>
 
 LunaApiCollector *LunaApiCollector::_instance = nullptr;
 
@@ -31,6 +33,9 @@ LunaApiCollector *LunaApiCollector::_instance = nullptr;
 #define TELEGRAF_MAIN_CONFIG "/var/lib/com.webos.service.sdkagent/telegraf/telegraf.conf"
 #define START_ON_BOOT_FLAG "/var/lib/com.webos.service.sdkagent/startOnBoot"
 
+// how often the samples of a burst capture are posted to its subscriber
+#define BURST_FLUSH_INTERVAL_MS 100
+
 // luna API lists
 const LSMethod LunaApiCollector::collectorMethods[] = {
     {"start", start, LUNA_METHOD_FLAGS_NONE},
@@ -43,6 +48,10 @@ const LSMethod LunaApiCollector::collectorMethods[] = {
     {"setConfig", setConfig, LUNA_METHOD_FLAGS_NONE},
 
     {"getData", getData, LUNA_METHOD_FLAGS_NONE},
+
+    {"getPipelineStats", getPipelineStats, LUNA_METHOD_FLAGS_NONE},
+
+    {"captureBurst", captureBurst, LUNA_METHOD_FLAGS_NONE},
     {NULL, NULL},
 };
 
@@ -65,6 +74,7 @@ LunaApiCollector::LunaApiCollector()
 
 LunaApiCollector::~LunaApiCollector()
 {
+    delete pBurstCapture;
     delete pThreadForInterval;
     delete pThreadForSocket;
 }
@@ -191,9 +201,9 @@ bool LunaApiCollector::getConfig(LSHandle *sh, LSMessage *msg, void *data)
         return false;
     }
 
-    tomlObject telegrafConfig = TelegrafController::getInstance()->getConfig();
+    TelegrafController::ConfigSnapshot telegrafConfig = TelegrafController::getInstance()->getConfigSnapshot();
 
-    std::string replyConfig = tomlObjectToJsonString(telegrafConfig, std::string("    "));
+    std::string replyConfig = tomlObjectToJsonString(*telegrafConfig, std::string("    "));
     replyConfig = "{\n    \"returnValue\": true,\n    \"config\": " + replyConfig + "\n}";
 
     Instance()->LSMessageReplyPayload(sh, msg, replyConfig.c_str());
@@ -244,6 +254,11 @@ bool LunaApiCollector::setConfig(LSHandle *sh, LSMessage *msg, void *data)
         return false;
     }
 
+    // "webOS.sinks" and "webOS.socket" apply without a restart
+    if (Instance()->pThreadForSocket) {
+        Instance()->pThreadForSocket->reloadSinks();
+    }
+
     Instance()->LSMessageReplyPayload(sh, msg, "{\"returnValue\": true}");
     return true;
 }
@@ -392,11 +407,416 @@ bool LunaApiCollector::getData(LSHandle *sh, LSMessage *msg, void *data)
     return true;
 }
 
-void LunaApiCollector::sendToTelegraf(std::string &msg)
+// luna-send -f -n 1 luna://com.webos.service.sdkagent/collector/getPipelineStats '{}'
+/**
+ * Transport counters of every sink, from sendToTelegraf() to the sink write.
+ * {
+ *     "returnValue": true,
+ *     "sinks": [{
+ *         "name": "telegraf",
+ *         "queue": {"depth", "highWaterMark", "capacity", "pushed", "dropped", "oversized"},
+ *         "writtenRecords", "writtenBytes", "droppedRecords",
+ *         "recordsPerSec", "bytesPerSec",     // since the previous call
+ *         "latency": {"avgUs", "maxUs", "p50Us", "p95Us", "p99Us",
+ *                     "buckets": [{"leUs": 100, "count": 12}, ..., {"leUs": -1, "count": 0}]},
+ *         "sendErrors": [{"errno": 11, "error": "Resource temporarily unavailable", "count": 3}],
+ *         "spool": {...}                      // telegraf sink with "webOS.spool" enabled
+ *     }],
+ *     "scheduler": {"intervalUs", "ticks", "missedDeadlines",
+ *                   "lastDriftUs", "maxDriftUs", "avgDriftUs"},  // wake-up past the aligned deadline
+ *     "sampling": {"workers", "processes", "cycles",
+ *                  "lastCycleUs", "maxCycleUs", "avgCycleUs",     // "webOS.processMonitoring" wall time
+ *                  "threads": {"processes", "threads", "lastCostUs", "maxCostUs"}}   // thread_processes
+ * }
+ * Percentiles are the upper bound of the bucket they fall into, -1 for the open-ended one.
+ */
+bool LunaApiCollector::getPipelineStats(LSHandle *sh, LSMessage *msg, void *data)
+{
+    if (!json_tokener_parse(LSMessageGetPayload(msg)))
+    {
+        Instance()->LSMessageReplyErrorBadJSON(sh, msg);
+        return false;
+    }
+
+    auto bucketBound = [](guint64 bound) -> int64_t {
+        return (bound == G_MAXUINT64) ? -1 : (int64_t)bound;
+    };
+
+    pbnjson::JValue sinks = pbnjson::Array();
+    std::vector<ThreadForSocket::SinkStats> sinkStats;
+    if (Instance()->pThreadForSocket) {
+        sinkStats = Instance()->pThreadForSocket->getSinkStats();
+    }
+
+    for (auto &stats : sinkStats)
+    {
+        pbnjson::JValue queue = pbnjson::Object();
+        queue.put("depth", (int64_t)stats.queue.depth);
+        queue.put("highWaterMark", (int64_t)stats.queue.highWaterMark);
+        queue.put("capacity", (int64_t)stats.queue.capacity);
+        queue.put("pushed", (int64_t)stats.queue.pushed);
+        queue.put("dropped", (int64_t)stats.queue.dropped);
+        queue.put("oversized", (int64_t)stats.queue.oversized);
+
+        pbnjson::JValue buckets = pbnjson::Array();
+        for (size_t i = 0; i < stats.latencyBuckets.size(); i++)
+        {
+            pbnjson::JValue bucket = pbnjson::Object();
+            guint64 bound = (i < LatencyHistogram::BUCKET_COUNT - 1) ? LatencyHistogram::BUCKET_BOUNDS_US[i] : G_MAXUINT64;
+            bucket.put("leUs", bucketBound(bound));
+            bucket.put("count", (int64_t)stats.latencyBuckets[i]);
+            buckets.append(bucket);
+        }
+
+        pbnjson::JValue latency = pbnjson::Object();
+        latency.put("avgUs", (int64_t)stats.latencyAvgUs);
+        latency.put("maxUs", (int64_t)stats.latencyMaxUs);
+        latency.put("p50Us", bucketBound(LatencyHistogram::percentile(stats.latencyBuckets, 50)));
+        latency.put("p95Us", bucketBound(LatencyHistogram::percentile(stats.latencyBuckets, 95)));
+        latency.put("p99Us", bucketBound(LatencyHistogram::percentile(stats.latencyBuckets, 99)));
+        latency.put("buckets", buckets);
+
+        pbnjson::JValue sendErrors = pbnjson::Array();
+        for (auto &error : stats.sendErrors)
+        {
+            pbnjson::JValue item = pbnjson::Object();
+            item.put("errno", error.first);
+            item.put("error", std::string(error.first ? strerror(error.first) : "unknown"));
+            item.put("count", (int64_t)error.second);
+            sendErrors.append(item);
+        }
+
+        pbnjson::JValue sink = pbnjson::Object();
+        sink.put("name", stats.name);
+        sink.put("queue", queue);
+        sink.put("writtenRecords", (int64_t)stats.writtenRecords);
+        sink.put("writtenBytes", (int64_t)stats.writtenBytes);
+        sink.put("droppedRecords", (int64_t)stats.droppedRecords);
+        sink.put("recordsPerSec", stats.recordsPerSec);
+        sink.put("bytesPerSec", stats.bytesPerSec);
+        sink.put("latency", latency);
+        sink.put("sendErrors", sendErrors);
+
+        if (stats.spoolOpen)
+        {
+            pbnjson::JValue spool = pbnjson::Object();
+            spool.put("spooledRecords", (int64_t)stats.spool.spooledRecords);
+            spool.put("replayedRecords", (int64_t)stats.spool.replayedRecords);
+            spool.put("droppedRecords", (int64_t)stats.spool.droppedRecords);
+            spool.put("pendingRecords", (int64_t)stats.spool.pendingRecords);
+            spool.put("usedBytes", (int64_t)stats.spool.usedBytes);
+            spool.put("capacity", (int64_t)stats.spool.capacity);
+            sink.put("spool", spool);
+        }
+        sinks.append(sink);
+    }
+
+    pbnjson::JValue reply = pbnjson::Object();
+    reply.put("returnValue", true);
+    reply.put("sinks", sinks);
+
+    if (Instance()->pThreadForInterval)
+    {
+        IntervalScheduler::Stats schedulerStats = Instance()->pThreadForInterval->getSchedulerStats();
+        pbnjson::JValue scheduler = pbnjson::Object();
+        scheduler.put("intervalUs", (int64_t)schedulerStats.intervalUs);
+        scheduler.put("ticks", (int64_t)schedulerStats.ticks);
+        scheduler.put("missedDeadlines", (int64_t)schedulerStats.missedDeadlines);
+        scheduler.put("lastDriftUs", (int64_t)schedulerStats.lastDriftUs);
+        scheduler.put("maxDriftUs", (int64_t)schedulerStats.maxDriftUs);
+        scheduler.put("avgDriftUs", (int64_t)schedulerStats.avgDriftUs);
+        reply.put("scheduler", scheduler);
+
+        ThreadForInterval::SamplingStats samplingStats = Instance()->pThreadForInterval->getSamplingStats();
+        pbnjson::JValue sampling = pbnjson::Object();
+        sampling.put("workers", (int64_t)samplingStats.workers);
+        sampling.put("processes", (int64_t)samplingStats.processes);
+        sampling.put("cycles", (int64_t)samplingStats.cycles);
+        sampling.put("lastCycleUs", (int64_t)samplingStats.lastCycleUs);
+        sampling.put("maxCycleUs", (int64_t)samplingStats.maxCycleUs);
+        sampling.put("avgCycleUs", (int64_t)samplingStats.avgCycleUs);
+        pbnjson::JValue threads = pbnjson::Object();
+        threads.put("processes", (int64_t)samplingStats.threadProcesses);
+        threads.put("threads", (int64_t)samplingStats.threads);
+        threads.put("lastCostUs", (int64_t)samplingStats.lastThreadCostUs);
+        threads.put("maxCostUs", (int64_t)samplingStats.maxThreadCostUs);
+        sampling.put("threads", threads);
+        reply.put("sampling", sampling);
+    }
+    Instance()->LSMessageReplyPayload(sh, msg, reply.stringify().c_str());
+    return true;
+}
+
+// a captureBurst waiting for the pid of its appId
+struct PendingBurstCapture
+{
+    LSMessage *message;
+    BurstCapture::Request request;
+};
+
+/*
+ * luna-send -f -i luna://com.webos.service.sdkagent/collector/captureBurst '{"appId":"com.webos.app.home", "rateHz":100, "durationMs":2000, "subscribe":true}'
+ * Samples one process at a high rate on a thread of its own, next to the regular collection.
+ *   "pid" or "appId"   the process; the web process of a web app when it is known
+ *   "rateHz"           10 - 200, 50 by default
+ *   "durationMs"       100 - 30000, 1000 by default
+ *   "metrics"          of "cpu", "memory", "ctxsw", "faults"; ["cpu", "memory"] by default
+ *   "subscribe"        the new samples are posted every 100 ms while the capture runs
+ *   "once"             replies right away with the absolute counters, no capture is started
+ * The last reply:
+ * {
+ *     "returnValue": true, "subscribed": false, "complete": true,
+ *     "pid": 1234, "rateHz": 100,
+ *     "columns": ["t_us", "cpu_percent", "rss_kb"],
+ *     "samples": [[10021, 12.5, 40960], ...],    // the ones not posted yet with "subscribe"
+ *     "missedSamples": 0,                         // periods that passed while a read was late
+ *     "processExited": false
+ * }
+ * cpu_percent is of one core; ctxsw and faults count since the previous sample.
+ */
+bool LunaApiCollector::captureBurst(LSHandle *sh, LSMessage *msg, void *data)
+{
+    pbnjson::JValue params = stringToJValue(LSMessageGetPayload(msg));
+    if (!params.isObject())
+    {
+        Instance()->LSMessageReplyErrorBadJSON(sh, msg);
+        return false;
+    }
+
+    if (!isDevMode()) {
+        Instance()->LSMessageReplyErrorDevModeDisable(sh, msg);
+        return false;
+    }
+
+    BurstCapture::Request request;
+    if (!BurstCapture::parseRequest(params, request))
+    {
+        Instance()->LSMessageReplyErrorInvalidParams(sh, msg);
+        return false;
+    }
+
+    if (request.pid == 0)
+    {
+        // followed while "webOS.processMonitoring" is enabled, with the web process pids
+        RunningApps::Snapshot runningApps = RunningApps::getInstance()->snapshot();
+        for (auto &app : runningApps->apps)
+        {
+            if (app.id == request.appId)
+            {
+                request.pid = (app.webProcessPid > 0) ? app.webProcessPid : app.pid;
+                break;
+            }
+        }
+    }
+
+    if (request.pid == 0)
+    {
+        // the app is not followed: one query of the application manager
+        PendingBurstCapture *pending = new PendingBurstCapture{msg, request};
+        LSMessageRef(msg);
+
+        LSError lserror;
+        LSErrorInit(&lserror);
+        if (!LSCallOneReply(sh,
+                            "luna://com.webos.applicationManager/running",
+                            "{}",
+                            LunaApiCollector::cb_resolveBurstApp,
+                            pending,
+                            NULL,
+                            &lserror))
+        {
+            LSErrorPrint(&lserror, stderr);
+            LSErrorFree(&lserror);
+            Instance()->LSMessageReplyErrorUnknown(sh, msg);
+            LSMessageUnref(msg);
+            delete pending;
+            return false;
+        }
+        return true;
+    }
+
+    return startBurstCapture(sh, msg, request);
+}
+
+bool LunaApiCollector::cb_resolveBurstApp(LSHandle *sh, LSMessage *reply, void *data)
+{
+    PendingBurstCapture *pending = (PendingBurstCapture *)data;
+    LSMessage *msg = pending->message;
+    BurstCapture::Request request = pending->request;
+    delete pending;
+
+    pbnjson::JValue response = stringToJValue(LSMessageGetPayload(reply));
+    pbnjson::JValue running = response["running"];
+    for (int i = 0; running.isArray() && (i < running.arraySize()); i++)
+    {
+        if (running[i]["id"].asString() != request.appId) continue;
+
+        // "processid" is a string
+        pbnjson::JValue processId = running[i]["processid"];
+        request.pid = processId.isNumber() ? processId.asNumber<int>() : string_to_positive_int(processId.asString());
+        break;
+    }
+
+    if (request.pid > 0)
+        startBurstCapture(sh, msg, request);
+    else
+        Instance()->LSMessageReplyErrorInvalidParams(sh, msg);
+    LSMessageUnref(msg);
+    return true;
+}
+
+bool LunaApiCollector::startBurstCapture(LSHandle *sh, LSMessage *msg, const BurstCapture::Request &request)
+{
+    LunaApiCollector *self = Instance();
+
+    if (request.once)
+    {
+        BurstCapture capture(request);
+        pbnjson::JValue sample;
+        if (!capture.open() || !capture.sampleOnce(sample))
+        {
+            self->LSMessageReplyErrorInvalidParams(sh, msg);
+            return false;
+        }
+        pbnjson::JValue reply = pbnjson::Object();
+        reply.put("returnValue", true);
+        reply.put("pid", request.pid);
+        reply.put("sample", sample);
+        self->LSMessageReplyPayload(sh, msg, reply.stringify().c_str());
+        return true;
+    }
+
+    if (self->pBurstCapture)
+    {
+        self->LSMessageReplyErrorCaptureInProgress(sh, msg);
+        return false;
+    }
+
+    // the process must exist
+    BurstCapture *capture = new BurstCapture(request);
+    if (!capture->open())
+    {
+        delete capture;
+        self->LSMessageReplyErrorInvalidParams(sh, msg);
+        return false;
+    }
+
+    // a key per capture, a client of an earlier one must not get these samples
+    std::string subscriptionKey;
+    if (request.subscribe && LSMessageIsSubscription(msg))
+    {
+        subscriptionKey = "captureBurst/" + std::to_string(++self->burstCaptureCount);
+        LSError lserror;
+        LSErrorInit(&lserror);
+        if (!LSSubscriptionAdd(sh, subscriptionKey.c_str(), msg, &lserror))
+        {
+            LSErrorPrint(&lserror, stderr);
+            LSErrorFree(&lserror);
+            subscriptionKey.clear();
+        }
+    }
+
+    if (!capture->start())
+    {
+        delete capture;
+        self->LSMessageReplyErrorUnknown(sh, msg);
+        return false;
+    }
+
+    self->pBurstCapture = capture;
+    self->burstSubscriptionKey = subscriptionKey;
+    self->burstSentSamples = 0;
+    if (subscriptionKey.empty())
+    {
+        self->pBurstMessage = msg;
+        LSMessageRef(msg);
+    }
+    else
+    {
+        std::string payload = "{\"returnValue\":true,\"subscribed\":true,\"pid\":" + std::to_string(request.pid) +
+                              ",\"rateHz\":" + std::to_string(request.rateHz) + ",\"columns\":";
+        capture->appendColumns(payload);
+        payload += '}';
+        self->LSMessageReplyPayload(sh, msg, payload.c_str());
+    }
+
+    g_timeout_add(BURST_FLUSH_INTERVAL_MS, LunaApiCollector::cb_flushBurstCapture, NULL);
+    return true;
+}
+
+gboolean LunaApiCollector::cb_flushBurstCapture(gpointer data)
+{
+    LunaApiCollector *self = Instance();
+    BurstCapture *capture = self->pBurstCapture;
+    if (capture == NULL)
+        return G_SOURCE_REMOVE;
+
+    bool subscribed = !self->burstSubscriptionKey.empty();
+    const char *subscriptionKey = self->burstSubscriptionKey.c_str();
+    if (subscribed && (LSSubscriptionGetHandleSubscribersCount(self->pLSHandle, subscriptionKey) == 0))
+    {
+        // the client went away
+        capture->stop();
+    }
+
+    // read before the samples, the count is final once the capture is done
+    bool done = capture->isDone();
+    size_t published = capture->publishedCount();
+
+    std::string payload;
+    if (!done)
+    {
+        if (subscribed && (published > self->burstSentSamples))
+        {
+            payload = "{\"returnValue\":true,\"subscribed\":true,\"samples\":[";
+            capture->appendSamples(payload, self->burstSentSamples, published);
+            payload += "]}";
+            postEvent((void *)subscriptionKey, (void *)payload.c_str());
+            self->burstSentSamples = published;
+        }
+        return G_SOURCE_CONTINUE;
+    }
+
+    payload = "{\"returnValue\":true,\"subscribed\":false,\"complete\":true,\"pid\":" + std::to_string(capture->pid()) +
+              ",\"rateHz\":" + std::to_string(capture->rateHz()) + ",\"columns\":";
+    capture->appendColumns(payload);
+    payload += ",\"samples\":[";
+    capture->appendSamples(payload, subscribed ? self->burstSentSamples : 0, published);
+    payload += "],\"missedSamples\":" + std::to_string(capture->missedSamples());
+    payload += capture->processExited() ? ",\"processExited\":true}" : ",\"processExited\":false}";
+
+    if (subscribed)
+    {
+        postEvent((void *)subscriptionKey, (void *)payload.c_str());
+    }
+    else if (self->pBurstMessage)
+    {
+        self->LSMessageReplyPayload(self->pLSHandle, self->pBurstMessage, payload.c_str());
+        LSMessageUnref(self->pBurstMessage);
+    }
+
+    delete capture;
+    self->pBurstCapture = nullptr;
+    self->pBurstMessage = nullptr;
+    self->burstSubscriptionKey.clear();
+    self->burstSentSamples = 0;
+    return G_SOURCE_REMOVE;
+}
+
+bool LunaApiCollector::sendToTelegraf(const char *data, size_t length)
+{
+    if (pThreadForSocket) {
+        return pThreadForSocket->sendToMSGQ(data, length);
+    }
+    return false;
+}
+
+bool LunaApiCollector::sendBatchToTelegraf(const std::string &batch)
 {
     if (pThreadForSocket) {
-        pThreadForSocket->sendToMSGQ(msg);
+        return pThreadForSocket->sendBatchToMSGQ(batch.data(), batch.length());
     }
+    return false;
 }
 
 // For LSSubscriptionReply
@@ -0,0 +1,232 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "metricSink.h"
+#include "common.h"
+#include "logging.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// give up on a datagram after this many congested send attempts (~2s)
+#define SEND_RETRY_LIMIT 20
+
+//===================================================================
+// MetricSink
+
+MetricSink::MetricSink(const std::string &name) : stopFd(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)),
+                                                  sinkName(name),
+                                                  stopping(0)
+{
+    if (stopFd < 0)
+        SDK_LOG_WARNING(MSGID_SDKAGENT, 0, "Error creating stop eventfd for sink %s [%d:%s]", name.c_str(), errno, strerror(errno));
+}
+
+MetricSink::~MetricSink()
+{
+    if (stopFd >= 0) close(stopFd);
+}
+
+void MetricSink::requestStop()
+{
+    g_atomic_int_set(&stopping, 1);
+    if (stopFd >= 0)
+    {
+        eventfd_t one = 1;
+        if (::write(stopFd, &one, sizeof(one)) < 0)
+            SDK_LOG_WARNING(MSGID_SDKAGENT, 0, "Error waking sink %s [%d:%s]", sinkName.c_str(), errno, strerror(errno));
+    }
+}
+
+bool MetricSink::sleepUnlessStopped(gint64 timeoutUs)
+{
+    if (stopRequested())
+        return false;
+    if (stopFd < 0)
+    {
+        g_usleep(timeoutUs);
+        return !stopRequested();
+    }
+
+    gint64 deadline = g_get_monotonic_time() + timeoutUs;
+    while (true)
+    {
+        gint64 remainingUs = deadline - g_get_monotonic_time();
+        if (remainingUs <= 0)
+            return true;
+
+        struct pollfd pfd = {stopFd, POLLIN, 0};
+        int ret = poll(&pfd, 1, (int)((remainingUs + 999) / 1000));
+        if (ret > 0)
+            return false;
+        if ((ret < 0) && (errno != EINTR))
+        {
+            g_usleep(remainingUs);
+            return !stopRequested();
+        }
+    }
+}
+
+//===================================================================
+// UnixSocketSink
+
+UnixSocketSink::UnixSocketSink(const std::string &name, const std::string &path) : MetricSink(name),
+                                                                                     socket(path)
+{
+}
+
+void UnixSocketSink::configure(const pbnjson::JValue &socketConfig)
+{
+    // takes effect with the next (re)connect
+    socket.setSendBufferSize((int)jsonNumberOrDefault(socketConfig, "send_buffer_size", 0));
+}
+
+MetricSink::WriteResult UnixSocketSink::write(const char *data, size_t length)
+{
+    int reconnects = 0;
+    int congested = 0;
+
+    while (true)
+    {
+        if (stopRequested())
+            return WriteResult::RETRY_LATER;
+        if (!socket.ensureConnected())
+            return WriteResult::UNREACHABLE;
+
+        UnixDatagramSocket::SendResult result = socket.send(data, length);
+        if (result != UnixDatagramSocket::SendResult::SENT)
+            errors.count(socket.lastError());
+
+        switch (result)
+        {
+            case UnixDatagramSocket::SendResult::SENT:
+                return WriteResult::WRITTEN;
+
+            case UnixDatagramSocket::SendResult::DISCONNECTED:
+                // the peer is usually back already after a restart, reconnect right away once
+                if (++reconnects <= 1)
+                    continue;
+                return WriteResult::UNREACHABLE;
+
+            case UnixDatagramSocket::SendResult::RETRY_LATER:
+                if (++congested < SEND_RETRY_LIMIT)
+                    continue;
+                return WriteResult::RETRY_LATER;
+
+            case UnixDatagramSocket::SendResult::FAILED:
+            default:
+                return WriteResult::FAILED;
+        }
+    }
+}
+
+//===================================================================
+// FileSink
+
+FileSink::FileSink(const std::string &name, const std::string &path, size_t maxSizeBytes, int maxFiles) : MetricSink(name),
+                                                                                                           filePath(path),
+                                                                                                           maxSize(maxSizeBytes),
+                                                                                                           maxFiles(maxFiles),
+                                                                                                           fd(-1),
+                                                                                                           currentSize(0)
+{
+}
+
+FileSink::~FileSink()
+{
+    if (fd >= 0) close(fd);
+}
+
+bool FileSink::openFile()
+{
+    if (fd >= 0) return true;
+
+    fd = open(filePath.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0)
+    {
+        errors.count(errno);
+        SDK_LOG_ERROR(MSGID_SDKAGENT, 0, "Error opening %s [%d:%s]", filePath.c_str(), errno, strerror(errno));
+        return false;
+    }
+
+    struct stat st;
+    currentSize = (fstat(fd, &st) == 0) ? (size_t)st.st_size : 0;
+    return true;
+}
+
+void FileSink::rotate()
+{
+    if (fd >= 0)
+    {
+        close(fd);
+        fd = -1;
+    }
+
+    if (maxFiles <= 0)
+    {
+        unlink(filePath.c_str());
+        return;
+    }
+
+    char from[PATH_MAX];
+    char to[PATH_MAX];
+    for (int i = maxFiles - 1; i >= 1; i--)
+    {
+        snprintf(from, sizeof(from), "%s.%d", filePath.c_str(), i);
+        snprintf(to, sizeof(to), "%s.%d", filePath.c_str(), i + 1);
+        rename(from, to);
+    }
+    snprintf(to, sizeof(to), "%s.1", filePath.c_str());
+    rename(filePath.c_str(), to);
+}
+
+MetricSink::WriteResult FileSink::write(const char *data, size_t length)
+{
+    if ((maxSize > 0) && (currentSize > 0) && (currentSize + length > maxSize))
+        rotate();
+
+    if (!openFile())
+        return WriteResult::UNREACHABLE;
+
+    size_t written = 0;
+    while (written < length)
+    {
+        ssize_t ret = ::write(fd, data + written, length - written);
+        if (ret < 0)
+        {
+            if (errno == EINTR) continue;
+
+            int err = errno;
+            errors.count(err);
+            SDK_LOG_ERROR(MSGID_SDKAGENT, 0, "Error writing %s [%d:%s]", filePath.c_str(), err, strerror(err));
+            close(fd);
+            fd = -1;
+            // a partially written batch is not retried, it would duplicate records
+            return ((err == ENOSPC) || (written > 0)) ? WriteResult::FAILED : WriteResult::UNREACHABLE;
+        }
+        written += ret;
+    }
+
+    currentSize += length;
+    return WriteResult::WRITTEN;
+}
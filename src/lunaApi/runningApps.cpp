@@ -0,0 +1,208 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "runningApps.h"
+#include "logging.h"
+#include "common.h"
+
+#define RETRY_MIN_DELAY_SEC 1
+#define RETRY_MAX_DELAY_SEC 30
+
+RunningApps *RunningApps::getInstance()
+{
+    static RunningApps instance;
+    return &instance;
+}
+
+RunningApps::RunningApps() : handle(NULL),
+                             context(NULL),
+                             started(false),
+                             current(std::make_shared<const Table>()),
+                             generation(0)
+{
+    subscriptions[APPLICATION_MANAGER] = {"luna://com.webos.applicationManager/running",
+                                          "{\"subscribe\":true}", 0, 0, RETRY_MIN_DELAY_SEC, true};
+    subscriptions[WEBAPP_MANAGER] = {"luna://com.webos.service.webappmanager/listRunningApps",
+                                     "{\"includeSysApps\":true,\"subscribe\":true}", 0, 0, RETRY_MIN_DELAY_SEC, true};
+}
+
+void RunningApps::start(LSHandle *lsHandle, GMainContext *mainContext)
+{
+    if (started.exchange(true)) return;
+    handle = lsHandle;
+    context = mainContext;
+    addTimeout(0, RunningApps::cb_start, this);
+}
+
+// an idle source for 0 seconds
+guint RunningApps::addTimeout(guint seconds, GSourceFunc function, gpointer data)
+{
+    GSource *source = (seconds == 0) ? g_idle_source_new() : g_timeout_source_new_seconds(seconds);
+    g_source_set_callback(source, function, data, NULL);
+    guint id = g_source_attach(source, context);
+    g_source_unref(source);
+    return id;
+}
+
+gboolean RunningApps::cb_start(gpointer data)
+{
+    RunningApps *self = (RunningApps *)data;
+    for (int source = 0; source < SOURCE_COUNT; source++)
+        self->subscribe((Source)source);
+    return G_SOURCE_REMOVE;
+}
+
+gboolean RunningApps::cb_retry(gpointer data)
+{
+    RunningApps *self = getInstance();
+    Source source = (Source)GPOINTER_TO_INT(data);
+    self->subscriptions[source].retryTimer = 0;
+    self->subscribe(source);
+    return G_SOURCE_REMOVE;
+}
+
+void RunningApps::subscribe(Source source)
+{
+    Subscription &subscription = subscriptions[source];
+    if (!subscription.supported || (subscription.token != 0)) return;
+
+    LSError lserror;
+    LSErrorInit(&lserror);
+    if (!LSCall(handle, subscription.uri, subscription.payload,
+                RunningApps::cb_reply, GINT_TO_POINTER(source), &subscription.token, &lserror))
+    {
+        LSErrorPrint(&lserror, stderr);
+        LSErrorFree(&lserror);
+        subscription.token = 0;
+        scheduleRetry(source);
+    }
+}
+
+void RunningApps::scheduleRetry(Source source)
+{
+    Subscription &subscription = subscriptions[source];
+    if (subscription.token != 0)
+    {
+        LSCallCancel(handle, subscription.token, NULL);
+        subscription.token = 0;
+    }
+    if (subscription.retryTimer != 0) return;
+
+    subscription.retryTimer = addTimeout(subscription.retryDelaySec, RunningApps::cb_retry, GINT_TO_POINTER(source));
+    subscription.retryDelaySec = MIN(subscription.retryDelaySec * 2, RETRY_MAX_DELAY_SEC);
+}
+
+bool RunningApps::cb_reply(LSHandle *sh, LSMessage *msg, void *data)
+{
+    RunningApps *self = getInstance();
+    Source source = (Source)GPOINTER_TO_INT(data);
+    Subscription &subscription = self->subscriptions[source];
+
+    // the service is down or went away: the subscription is over
+    if (LSMessageIsHubErrorMessage(msg))
+    {
+        SDK_LOG_WARNING(MSGID_SDKAGENT, 0, "Lost %s, subscribing again in %u s", subscription.uri, subscription.retryDelaySec);
+        self->scheduleRetry(source);
+        return true;
+    }
+
+    pbnjson::JValue response = stringToJValue(LSMessageGetPayload(msg));
+    if (!response["returnValue"].asBool())
+    {
+        if (source == WEBAPP_MANAGER)
+        {
+            // older web app managers: the application manager alone is enough
+            SDK_LOG_INFO(MSGID_SDKAGENT, 0, "%s is not available, web process pids are not tracked", subscription.uri);
+            subscription.supported = false;
+            LSCallCancel(self->handle, subscription.token, NULL);
+            subscription.token = 0;
+        }
+        else
+        {
+            SDK_LOG_WARNING(MSGID_SDKAGENT, 0, "%s failed, subscribing again in %u s", subscription.uri, subscription.retryDelaySec);
+            self->scheduleRetry(source);
+        }
+        return true;
+    }
+    subscription.retryDelaySec = RETRY_MIN_DELAY_SEC;
+
+    bool changed = (source == APPLICATION_MANAGER) ? self->updateApps(response["running"])
+                                                   : self->updateWebProcesses(response["running"]);
+    if (changed)
+        self->publish();
+    return true;
+}
+
+// pids come as strings from some services and as numbers from others
+static int pidValue(const pbnjson::JValue &value)
+{
+    if (value.isNumber()) return value.asNumber<int>();
+    if (value.isString()) return string_to_positive_int(value.asString());
+    return -1;
+}
+
+// every reply carries the whole list, only a difference publishes a new table
+bool RunningApps::updateApps(const pbnjson::JValue &running)
+{
+    std::vector<App> updated;
+    for (int i = 0; running.isArray() && (i < running.arraySize()); i++)
+    {
+        App app = {running[i]["id"].asString(), pidValue(running[i]["processid"]), 0};
+        if (!app.id.empty())
+            updated.push_back(std::move(app));
+    }
+
+    bool changed = (updated.size() != apps.size());
+    for (size_t i = 0; !changed && (i < updated.size()); i++)
+        changed = (updated[i].id != apps[i].id) || (updated[i].pid != apps[i].pid);
+    if (changed)
+        apps.swap(updated);
+    return changed;
+}
+
+bool RunningApps::updateWebProcesses(const pbnjson::JValue &running)
+{
+    std::unordered_map<std::string, int> updated;
+    for (int i = 0; running.isArray() && (i < running.arraySize()); i++)
+    {
+        int pid = pidValue(running[i]["webprocessid"]);
+        if (pid > 0)
+            updated[running[i]["id"].asString()] = pid;
+    }
+
+    if (updated == webProcessPids) return false;
+    webProcessPids.swap(updated);
+    return true;
+}
+
+void RunningApps::publish()
+{
+    std::shared_ptr<Table> table = std::make_shared<Table>();
+    table->generation = ++generation;
+    table->apps = apps;
+    for (auto &app : table->apps)
+    {
+        auto it = webProcessPids.find(app.id);
+        if (it != webProcessPids.end())
+        {
+            app.webProcessPid = it->second;
+            table->appIdByPid.emplace(app.webProcessPid, app.id);
+        }
+        if (app.pid > 0)
+            table->appIdByPid.emplace(app.pid, app.id);
+    }
+    std::atomic_store(&current, Snapshot(table));
+}
@@ -0,0 +1,271 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "shmSink.h"
+#include "lineProtocol.h"
+#include "logging.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+ShmSink::ShmSink(const std::string &name, const std::string &shmName, uint32_t entryCapacity) : MetricSink(name),
+                                                                                               shmName(shmName),
+                                                                                               capacity(entryCapacity),
+                                                                                               segment(nullptr),
+                                                                                               segmentSize(0),
+                                                                                               header(nullptr)
+{
+    createSegment();
+}
+
+ShmSink::~ShmSink()
+{
+    // the segment stays so that readers keep the last values, it is reused on the next start
+    if (segment) munmap(segment, segmentSize);
+}
+
+bool ShmSink::createSegment()
+{
+    int fd = shm_open(shmName.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0)
+    {
+        errors.count(errno);
+        SDK_LOG_ERROR(MSGID_SDKAGENT, 0, "Error creating shared memory %s [%d:%s]", shmName.c_str(), errno, strerror(errno));
+        return false;
+    }
+
+    // the segment is only ever grown, readers may still have the old size mapped
+    struct stat st;
+    size_t size = shmSegmentSize(capacity);
+    if ((fstat(fd, &st) == 0) && ((size_t)st.st_size > size))
+        size = st.st_size;
+
+    if (ftruncate(fd, size) < 0)
+    {
+        errors.count(errno);
+        SDK_LOG_ERROR(MSGID_SDKAGENT, 0, "Error resizing shared memory %s [%d:%s]", shmName.c_str(), errno, strerror(errno));
+        close(fd);
+        return false;
+    }
+
+    void *addr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED)
+    {
+        errors.count(errno);
+        SDK_LOG_ERROR(MSGID_SDKAGENT, 0, "Error mapping shared memory %s [%d:%s]", shmName.c_str(), errno, strerror(errno));
+        return false;
+    }
+
+    segment = addr;
+    segmentSize = size;
+    header = (ShmSegmentHeader *)addr;
+
+    // readers reject the segment while the magic is invalid
+    uint32_t generation = (header->magic == SDKAGENT_SHM_MAGIC) ? header->generation + 1 : 1;
+    header->magic = 0;
+    std::atomic_thread_fence(std::memory_order_release);
+
+    header->entryCount.store(0, std::memory_order_relaxed);
+    memset((char *)addr + sizeof(ShmSegmentHeader), 0, size - sizeof(ShmSegmentHeader));
+    header->version = SDKAGENT_SHM_VERSION;
+    header->headerSize = sizeof(ShmSegmentHeader);
+    header->entrySize = sizeof(ShmEntry);
+    header->entryCapacity = capacity;
+    header->writerPid = getpid();
+    header->generation = generation;
+    header->updateCount.store(0, std::memory_order_relaxed);
+    header->truncatedCount.store(0, std::memory_order_relaxed);
+    header->createdNs = LineProtocolEncoder::nowNs();
+    memset(header->reserved, 0, sizeof(header->reserved));
+
+    std::atomic_thread_fence(std::memory_order_release);
+    header->magic = SDKAGENT_SHM_MAGIC;
+
+    entrySeries.assign(capacity, std::string());
+    entryIndex.reserve(capacity);
+    SDK_LOG_INFO(MSGID_SDKAGENT, 0, "Publishing latest samples to %s (%u series)", shmName.c_str(), capacity);
+    return true;
+}
+
+// index of the entry for 'series', a new or the least recently updated one when unknown
+uint32_t ShmSink::entryFor(const std::string &series, bool &appended)
+{
+    appended = false;
+    auto it = entryIndex.find(series);
+    if (it != entryIndex.end())
+        return it->second;
+
+    uint32_t index = header->entryCount.load(std::memory_order_relaxed);
+    if (index >= capacity)
+    {
+        index = 0;
+        for (uint32_t i = 1; i < capacity; i++)
+        {
+            if (shmEntryAt(segment, i)->data.updatedNs < shmEntryAt(segment, index)->data.updatedNs)
+                index = i;
+        }
+        entryIndex.erase(entrySeries[index]);
+    }
+    else
+    {
+        // entryCount is raised once the entry is filled in
+        appended = true;
+    }
+
+    entrySeries[index] = series;
+    entryIndex[series] = index;
+    return index;
+}
+
+// scan to the next unescaped 'stop' character. A '"' in the measurement, a tag
+// or a field key is a plain character, only string field values are quoted.
+static const char *findUnescaped(const char *pos, const char *end, char stop)
+{
+    for (; pos < end; pos++)
+    {
+        if (*pos == '\\') {
+            pos++;
+            continue;
+        }
+        if (*pos == stop) return pos;
+    }
+    return end;
+}
+
+// end of the field starting at 'pos': the ',' or ' ' after its value, or 'end'
+static const char *findFieldEnd(const char *pos, const char *end)
+{
+    pos = findUnescaped(pos, end, '=');
+    if ((pos + 1 < end) && (pos[1] == '"'))
+    {
+        // string value, up to the closing quote
+        for (pos += 2; (pos < end) && (*pos != '"'); pos++)
+        {
+            if (*pos == '\\') pos++;
+        }
+    }
+    for (; pos < end; pos++)
+    {
+        if (*pos == '\\') {
+            pos++;
+            continue;
+        }
+        if ((*pos == ',') || (*pos == ' ')) return pos;
+    }
+    return end;
+}
+
+// series fields [timestamp]
+void ShmSink::updateEntry(const char *line, size_t length, int64_t nowNs)
+{
+    const char *end = line + length;
+    const char *seriesEnd = findUnescaped(line, end, ' ');
+    if ((seriesEnd == end) || (seriesEnd - line >= SHM_SERIES_SIZE))
+        return;
+
+    seriesKey.assign(line, seriesEnd - line);
+    bool appended = false;
+    uint32_t index = entryFor(seriesKey, appended);
+    ShmEntry *entry = shmEntryAt(segment, index);
+
+    uint32_t sequence = entry->sequence.load(std::memory_order_relaxed);
+    entry->sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    ShmEntryData &data = entry->data;
+    memcpy(data.series, seriesKey.c_str(), seriesKey.length() + 1);
+    data.updatedNs = nowNs;
+    data.fieldCount = 0;
+
+    bool truncated = false;
+    const char *pos = seriesEnd + 1;
+    while (pos < end)
+    {
+        const char *fieldEnd = findFieldEnd(pos, end);
+        const char *equal = findUnescaped(pos, fieldEnd, '=');
+        const char *value = equal + 1;
+        size_t nameLength = equal - pos;
+
+        // string fields are not published
+        if ((equal < fieldEnd) && (value < fieldEnd) && (nameLength < SHM_FIELD_NAME_SIZE) && (*value != '"'))
+        {
+            if (data.fieldCount < SHM_MAX_FIELDS)
+            {
+                ShmField &field = data.fields[data.fieldCount];
+                char last = *(fieldEnd - 1);
+                if ((last == 'i') || (last == 'u')) {
+                    field.type = SHM_FIELD_INT;
+                    field.intValue = strtoll(value, NULL, 10);
+                }
+                else if ((*value == 't') || (*value == 'T') || (*value == 'f') || (*value == 'F')) {
+                    field.type = SHM_FIELD_BOOL;
+                    field.intValue = ((*value == 't') || (*value == 'T')) ? 1 : 0;
+                }
+                else {
+                    field.type = SHM_FIELD_FLOAT;
+                    field.floatValue = strtod(value, NULL);
+                }
+                memcpy(field.name, pos, nameLength);
+                field.name[nameLength] = '\0';
+                data.fieldCount++;
+            }
+            else
+            {
+                truncated = true;
+            }
+        }
+
+        pos = fieldEnd + 1;
+        if ((fieldEnd == end) || (*fieldEnd == ' '))
+            break;
+    }
+    data.timestampNs = (pos < end) ? strtoll(pos, NULL, 10) : 0;
+
+    entry->sequence.store(sequence + 2, std::memory_order_release);
+    if (appended)
+        header->entryCount.store(index + 1, std::memory_order_release);
+    header->updateCount.fetch_add(1, std::memory_order_release);
+
+    if (truncated && (header->truncatedCount.fetch_add(1, std::memory_order_relaxed) == 0))
+    {
+        SDK_LOG_WARNING(MSGID_SDKAGENT, 0, "%s has more than %d numeric fields, only the first %d are published",
+                        seriesKey.c_str(), SHM_MAX_FIELDS, SHM_MAX_FIELDS);
+    }
+}
+
+MetricSink::WriteResult ShmSink::write(const char *data, size_t length)
+{
+    if (!segment && !createSegment())
+        return WriteResult::UNREACHABLE;
+
+    int64_t nowNs = LineProtocolEncoder::nowNs();
+    const char *end = data + length;
+    for (const char *line = data; line < end; )
+    {
+        const char *lineEnd = (const char *)memchr(line, '\n', end - line);
+        if (!lineEnd) lineEnd = end;
+        if (lineEnd > line)
+            updateEntry(line, lineEnd - line, nowNs);
+        line = lineEnd + 1;
+    }
+    return WriteResult::WRITTEN;
+}
@@ -0,0 +1,819 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+#include "systemCollector.h"
+#include "lunaApiCollector.h"
+#include "common.h"
+#include "lineProtocol.h"
+#include "logging.h"
+
+#include <algorithm>
+#include <ctype.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define INITIAL_BUFFER_SIZE 8192
+
+// files[] value of a file this kernel does not have, it is not looked up again
+#define FILE_MISSING -2
+
+// cpus and thermal zones come and go (hotplug, late drivers)
+#define SYSFS_RESCAN_CYCLES 60
+
+#define SECTOR_SIZE 512
+
+static const char *familyKeys[] = {"cpu", "memory", "load", "vmstat", "disk", "network", "cpufreq", "thermal"};
+static const char *familyFiles[] = {"/proc/stat", "/proc/meminfo", "/proc/loadavg", "/proc/vmstat",
+                                    "/proc/diskstats", "/proc/net/dev", "", ""};
+
+static const struct {
+    const char *key;
+    const char *field;
+} memInfoFields[] = {
+    {"MemTotal", "total_kb"},
+    {"MemFree", "free_kb"},
+    {"MemAvailable", "available_kb"},
+    {"Buffers", "buffers_kb"},
+    {"Cached", "cached_kb"},
+    {"Shmem", "shared_kb"},
+    {"Slab", "slab_kb"},
+    {"Dirty", "dirty_kb"},
+    {"SwapTotal", "swap_total_kb"},
+    {"SwapFree", "swap_free_kb"},
+};
+#define MEMINFO_FIELD_COUNT (sizeof(memInfoFields) / sizeof(memInfoFields[0]))
+
+enum
+{
+    VMSTAT_PGPGIN,
+    VMSTAT_PGPGOUT,
+    VMSTAT_PSWPIN,
+    VMSTAT_PSWPOUT,
+    VMSTAT_PGFAULT,
+    VMSTAT_PGMAJFAULT,
+    VMSTAT_PGSCAN,
+    VMSTAT_PGSTEAL,
+    VMSTAT_ALLOCSTALL,
+    VMSTAT_OOM_KILL,
+    VMSTAT_COUNT
+};
+
+// the reclaim counters are split by zone or reclaimer depending on the kernel
+static const struct {
+    const char *name;
+    bool prefix;
+    int slot;
+} vmstatNames[] = {
+    {"pgpgin", false, VMSTAT_PGPGIN},
+    {"pgpgout", false, VMSTAT_PGPGOUT},
+    {"pswpin", false, VMSTAT_PSWPIN},
+    {"pswpout", false, VMSTAT_PSWPOUT},
+    {"pgfault", false, VMSTAT_PGFAULT},
+    {"pgmajfault", false, VMSTAT_PGMAJFAULT},
+    {"pgscan_kswapd", true, VMSTAT_PGSCAN},
+    {"pgscan_direct", true, VMSTAT_PGSCAN},
+    {"pgsteal_kswapd", true, VMSTAT_PGSTEAL},
+    {"pgsteal_direct", true, VMSTAT_PGSTEAL},
+    {"allocstall", true, VMSTAT_ALLOCSTALL},
+    {"oom_kill", false, VMSTAT_OOM_KILL},
+};
+
+// oom_kill is reported as the total, the others per second
+static const char *vmstatFields[VMSTAT_COUNT] = {
+    "pgpgin_per_sec", "pgpgout_per_sec", "pswpin_per_sec", "pswpout_per_sec", "pgfault_per_sec",
+    "pgmajfault_per_sec", "pgscan_per_sec", "pgsteal_per_sec", "allocstall_per_sec", "oom_kill"
+};
+
+static const char *lineEnd(const char *p, const char *end)
+{
+    const char *newline = (const char *)memchr(p, '\n', end - p);
+    return newline ? newline : end;
+}
+
+static void skipBlanks(const char *&p, const char *end)
+{
+    while ((p < end) && ((*p == ' ') || (*p == '\t')))
+        p++;
+}
+
+// moves p past the number, false when there is none before the end of the line
+static bool parseU64(const char *&p, const char *end, guint64 &value)
+{
+    skipBlanks(p, end);
+    if ((p >= end) || (*p < '0') || (*p > '9'))
+        return false;
+    value = 0;
+    while ((p < end) && (*p >= '0') && (*p <= '9'))
+        value = value * 10 + (guint64)(*p++ - '0');
+    return true;
+}
+
+static void parseToken(const char *&p, const char *end, std::string &token)
+{
+    skipBlanks(p, end);
+    const char *start = p;
+    while ((p < end) && (*p != ' ') && (*p != '\t'))
+        p++;
+    token.assign(start, p - start);
+}
+
+static bool startsWith(const char *p, const char *end, const char *prefix)
+{
+    size_t length = strlen(prefix);
+    return ((size_t)(end - p) >= length) && (memcmp(p, prefix, length) == 0);
+}
+
+// a counter that went backwards was reset, there is no rate for this cycle
+static double perSecond(guint64 current, guint64 previous, gint64 elapsedUs)
+{
+    if ((current < previous) || (elapsedUs <= 0))
+        return 0;
+    return (double)(current - previous) * G_USEC_PER_SEC / elapsedUs;
+}
+
+static double percentOf(guint64 part, guint64 total)
+{
+    return (total > 0) ? (double)part * 100.0 / total : 0;
+}
+
+static void closeFile(int &fd)
+{
+    if (fd >= 0) close(fd);
+    fd = -1;
+}
+
+SystemCollector::SystemCollector() : buffer(INITIAL_BUFFER_SIZE),
+                                     cycle(0),
+                                     contextSwitches(0),
+                                     forks(0),
+                                     cpufreqScanned(false),
+                                     thermalScanned(false)
+{
+    for (int i = 0; i < FAMILY_COUNT; i++)
+    {
+        files[i].path = familyFiles[i];
+        files[i].fd = -1;
+        enabled[i] = false;
+        lastReadUs[i] = 0;
+    }
+}
+
+SystemCollector::~SystemCollector()
+{
+    for (int i = 0; i < FAMILY_COUNT; i++)
+        resetFamily(i);
+}
+
+void SystemCollector::resetFamily(int family)
+{
+    closeFile(files[family].fd);
+    lastReadUs[family] = 0;
+
+    switch (family)
+    {
+    case CPU:
+        cpuTimes.clear();
+        break;
+    case VMSTAT:
+        vmstatCounters.clear();
+        break;
+    case DISK:
+        diskCounters.clear();
+        break;
+    case NETWORK:
+        netCounters.clear();
+        break;
+    case CPUFREQ:
+        for (auto &entry : cpufreqEntries)
+            closeFile(entry.file.fd);
+        cpufreqEntries.clear();
+        cpufreqScanned = false;
+        break;
+    case THERMAL:
+        for (auto &entry : thermalEntries)
+            closeFile(entry.file.fd);
+        thermalEntries.clear();
+        thermalScanned = false;
+        break;
+    default:
+        break;
+    }
+}
+
+const char *SystemCollector::readFile(CachedFile &file, size_t *length)
+{
+    if (file.fd == FILE_MISSING)
+        return NULL;
+    if (file.fd < 0)
+    {
+        file.fd = open(file.path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (file.fd < 0)
+        {
+            if (errno == ENOENT)
+            {
+                SDK_LOG_INFO(MSGID_SDKAGENT, 0, "%s is not available", file.path.c_str());
+                file.fd = FILE_MISSING;
+            }
+            return NULL;
+        }
+    }
+
+    // procfs and sysfs generate the content again on a read at offset 0
+    ssize_t n;
+    while (true)
+    {
+        n = pread(file.fd, buffer.data(), buffer.size() - 1, 0);
+        if ((n < 0) || ((size_t)n < buffer.size() - 1)) break;
+        buffer.resize(buffer.size() * 2);
+    }
+    if (n < 0)
+        return NULL;
+
+    buffer[n] = '\0';
+    *length = (size_t)n;
+    return buffer.data();
+}
+
+void SystemCollector::send()
+{
+    LunaApiCollector::Instance()->sendToTelegraf(record);
+}
+
+void SystemCollector::collect(const pbnjson::JValue &systemConfig, int64_t timestampNs)
+{
+    cycle++;
+    gint64 nowUs = g_get_monotonic_time();
+
+    gint64 elapsedUs[FAMILY_COUNT];
+    for (int i = 0; i < FAMILY_COUNT; i++)
+    {
+        bool wanted = systemConfig.isObject() && systemConfig.hasKey(familyKeys[i]) &&
+                      systemConfig[familyKeys[i]].isBoolean() && systemConfig[familyKeys[i]].asBool();
+        // a family enabled again starts over, its old counters would give a rate over the pause
+        if (!wanted && enabled[i])
+            resetFamily(i);
+        enabled[i] = wanted;
+
+        elapsedUs[i] = (lastReadUs[i] > 0) ? (nowUs - lastReadUs[i]) : 0;
+        if (wanted)
+            lastReadUs[i] = nowUs;
+    }
+
+    if (enabled[CPU]) collectCpu(elapsedUs[CPU], timestampNs);
+    if (enabled[MEMORY]) collectMemory(timestampNs);
+    if (enabled[LOAD]) collectLoad(timestampNs);
+    if (enabled[VMSTAT]) collectVmstat(elapsedUs[VMSTAT], timestampNs);
+    if (enabled[DISK]) collectDisk(elapsedUs[DISK], timestampNs);
+    if (enabled[NETWORK]) collectNetwork(elapsedUs[NETWORK], timestampNs);
+    if (enabled[CPUFREQ]) collectCpufreq(timestampNs);
+    if (enabled[THERMAL]) collectThermal(timestampNs);
+}
+
+/*
+ * cpu  4705 356 584 3699 23 23 0 0 0 0
+ * cpu0 1393280 32966 572056 13343292 6130 0 17875 0 0 0
+ * ...
+ * ctxt 1990473
+ * processes 2915
+ * procs_running 1
+ * procs_blocked 0
+ */
+void SystemCollector::collectCpu(gint64 elapsedUs, int64_t timestampNs)
+{
+    size_t length = 0;
+    const char *data = readFile(files[CPU], &length);
+    if (data == NULL) return;
+    const char *end = data + length;
+
+    guint64 currentContextSwitches = 0;
+    guint64 currentForks = 0;
+    guint64 procsRunning = 0;
+    guint64 procsBlocked = 0;
+
+    for (const char *line = data; line < end;)
+    {
+        const char *next = lineEnd(line, end);
+        const char *p = line;
+
+        if (startsWith(p, next, "cpu"))
+        {
+            // "cpu" is the sum of all, "cpu<n>" a single one
+            p += 3;
+            size_t index = 0;
+            guint64 cpu = 0;
+            if ((p < next) && (*p >= '0') && (*p <= '9') && parseU64(p, next, cpu))
+                index = (size_t)cpu + 1;
+
+            // steal is missing before 2.6.11
+            CpuTimes current = {};
+            guint64 *values[] = {&current.user, &current.nice, &current.system, &current.idle,
+                                 &current.iowait, &current.irq, &current.softirq, &current.steal};
+            int parsed = 0;
+            for (guint64 *value : values)
+            {
+                if (!parseU64(p, next, *value)) break;
+                parsed++;
+            }
+
+            if (parsed >= 4)
+            {
+                current.valid = true;
+                if (index >= cpuTimes.size())
+                    cpuTimes.resize(index + 1, CpuTimes());
+
+                CpuTimes &previous = cpuTimes[index];
+                guint64 currentTotal = current.user + current.nice + current.system + current.idle +
+                                       current.iowait + current.irq + current.softirq + current.steal;
+                guint64 previousTotal = previous.user + previous.nice + previous.system + previous.idle +
+                                        previous.iowait + previous.irq + previous.softirq + previous.steal;
+
+                if (previous.valid && (currentTotal > previousTotal) && (current.idle >= previous.idle))
+                {
+                    guint64 total = currentTotal - previousTotal;
+                    auto delta = [](guint64 now, guint64 before) { return (now > before) ? (now - before) : 0; };
+
+                    record.clear();
+                    LineProtocolEncoder encoder(record);
+                    encoder.measurement("system_cpu");
+                    if (index == 0)
+                    {
+                        encoder.tag("cpu", "cpu-total");
+                    }
+                    else
+                    {
+                        char name[32];
+                        snprintf(name, sizeof(name), "cpu%zu", index - 1);
+                        encoder.tag("cpu", name);
+                    }
+                    encoder.field("usage_user", percentOf(delta(current.user, previous.user), total), 2)
+                        .field("usage_nice", percentOf(delta(current.nice, previous.nice), total), 2)
+                        .field("usage_system", percentOf(delta(current.system, previous.system), total), 2)
+                        .field("usage_idle", percentOf(delta(current.idle, previous.idle), total), 2)
+                        .field("usage_iowait", percentOf(delta(current.iowait, previous.iowait), total), 2)
+                        .field("usage_irq", percentOf(delta(current.irq, previous.irq), total), 2)
+                        .field("usage_softirq", percentOf(delta(current.softirq, previous.softirq), total), 2)
+                        .field("usage_steal", percentOf(delta(current.steal, previous.steal), total), 2)
+                        .timestamp(timestampNs);
+                    send();
+                }
+                previous = current;
+            }
+        }
+        else if (startsWith(p, next, "ctxt "))
+        {
+            p += 5;
+            parseU64(p, next, currentContextSwitches);
+        }
+        else if (startsWith(p, next, "processes "))
+        {
+            p += 10;
+            parseU64(p, next, currentForks);
+        }
+        else if (startsWith(p, next, "procs_running "))
+        {
+            p += 14;
+            parseU64(p, next, procsRunning);
+        }
+        else if (startsWith(p, next, "procs_blocked "))
+        {
+            p += 14;
+            parseU64(p, next, procsBlocked);
+        }
+        line = next + 1;
+    }
+
+    record.clear();
+    LineProtocolEncoder encoder(record);
+    encoder.measurement("system_kernel");
+    if (elapsedUs > 0)
+    {
+        encoder.field("context_switches_per_sec", perSecond(currentContextSwitches, contextSwitches, elapsedUs), 1)
+            .field("forks_per_sec", perSecond(currentForks, forks, elapsedUs), 1);
+    }
+    encoder.field("procs_running", (int64_t)procsRunning)
+        .field("procs_blocked", (int64_t)procsBlocked)
+        .timestamp(timestampNs);
+    send();
+
+    contextSwitches = currentContextSwitches;
+    forks = currentForks;
+}
+
+// "MemTotal:        3930460 kB"
+void SystemCollector::collectMemory(int64_t timestampNs)
+{
+    size_t length = 0;
+    const char *data = readFile(files[MEMORY], &length);
+    if (data == NULL) return;
+    const char *end = data + length;
+
+    guint64 values[MEMINFO_FIELD_COUNT] = {};
+    bool found[MEMINFO_FIELD_COUNT] = {};
+
+    for (const char *line = data; line < end;)
+    {
+        const char *next = lineEnd(line, end);
+        const char *colon = (const char *)memchr(line, ':', next - line);
+        if (colon)
+        {
+            size_t keyLength = colon - line;
+            for (size_t i = 0; i < MEMINFO_FIELD_COUNT; i++)
+            {
+                if ((strlen(memInfoFields[i].key) == keyLength) && (memcmp(memInfoFields[i].key, line, keyLength) == 0))
+                {
+                    const char *p = colon + 1;
+                    found[i] = parseU64(p, next, values[i]);
+                    break;
+                }
+            }
+        }
+        line = next + 1;
+    }
+
+    record.clear();
+    LineProtocolEncoder encoder(record);
+    encoder.measurement("system_memory");
+    for (size_t i = 0; i < MEMINFO_FIELD_COUNT; i++)
+    {
+        if (found[i])
+            encoder.field(memInfoFields[i].field, (int64_t)values[i]);
+    }
+
+    // MemAvailable (3.14+) already accounts for the reclaimable caches
+    guint64 total = values[0];
+    if (found[0] && found[2] && (total >= values[2]))
+    {
+        encoder.field("used_kb", (int64_t)(total - values[2]))
+            .field("used_percent", percentOf(total - values[2], total), 2)
+            .field("available_percent", percentOf(values[2], total), 2);
+    }
+    if (!encoder.hasFields()) return;
+    encoder.timestamp(timestampNs);
+    send();
+}
+
+// "0.20 0.18 0.12 1/80 11206"
+void SystemCollector::collectLoad(int64_t timestampNs)
+{
+    size_t length = 0;
+    const char *data = readFile(files[LOAD], &length);
+    if (data == NULL) return;
+
+    double load1 = 0, load5 = 0, load15 = 0;
+    int running = 0, total = 0;
+    if (sscanf(data, "%lf %lf %lf %d/%d", &load1, &load5, &load15, &running, &total) != 5)
+        return;
+
+    record.clear();
+    LineProtocolEncoder(record)
+        .measurement("system_load")
+        .field("load1", load1, 2)
+        .field("load5", load5, 2)
+        .field("load15", load15, 2)
+        .field("runnable_tasks", (int64_t)running)
+        .field("total_tasks", (int64_t)total)
+        .timestamp(timestampNs);
+    send();
+}
+
+// "pgfault 1249858"
+void SystemCollector::collectVmstat(gint64 elapsedUs, int64_t timestampNs)
+{
+    size_t length = 0;
+    const char *data = readFile(files[VMSTAT], &length);
+    if (data == NULL) return;
+    const char *end = data + length;
+
+    guint64 counters[VMSTAT_COUNT] = {};
+    bool found[VMSTAT_COUNT] = {};
+
+    for (const char *line = data; line < end;)
+    {
+        const char *next = lineEnd(line, end);
+        const char *space = (const char *)memchr(line, ' ', next - line);
+        if (space)
+        {
+            size_t nameLength = space - line;
+            for (auto &name : vmstatNames)
+            {
+                size_t keyLength = strlen(name.name);
+                bool match = name.prefix ? ((nameLength >= keyLength) && (memcmp(name.name, line, keyLength) == 0))
+                                         : ((nameLength == keyLength) && (memcmp(name.name, line, keyLength) == 0));
+                if (!match) continue;
+
+                const char *p = space;
+                guint64 value = 0;
+                if (parseU64(p, next, value))
+                {
+                    counters[name.slot] += value;
+                    found[name.slot] = true;
+                }
+                break;
+            }
+        }
+        line = next + 1;
+    }
+
+    bool hasPrevious = (vmstatCounters.size() == VMSTAT_COUNT) && (elapsedUs > 0);
+
+    record.clear();
+    LineProtocolEncoder encoder(record);
+    encoder.measurement("system_vmstat");
+    for (int i = 0; i < VMSTAT_COUNT; i++)
+    {
+        if (!found[i]) continue;
+        if (i == VMSTAT_OOM_KILL)
+            encoder.field(vmstatFields[i], (int64_t)counters[i]);
+        else if (hasPrevious)
+            encoder.field(vmstatFields[i], perSecond(counters[i], vmstatCounters[i], elapsedUs), 1);
+    }
+    vmstatCounters.assign(counters, counters + VMSTAT_COUNT);
+
+    if (!encoder.hasFields()) return;
+    encoder.timestamp(timestampNs);
+    send();
+}
+
+/*
+ *  179       0 mmcblk0 3427 1042 259846 1523 1009 1233 56738 2839 0 3072 4362 ...
+ * reads, merged, sectors read, ms reading, writes, merged, sectors written,
+ * ms writing, I/Os in progress, ms doing I/O, ...
+ */
+void SystemCollector::collectDisk(gint64 elapsedUs, int64_t timestampNs)
+{
+    size_t length = 0;
+    const char *data = readFile(files[DISK], &length);
+    if (data == NULL) return;
+    const char *end = data + length;
+
+    std::string &name = token;
+    for (const char *line = data; line < end;)
+    {
+        const char *next = lineEnd(line, end);
+        const char *p = line;
+        guint64 major = 0, minor = 0;
+        guint64 values[10];
+        bool parsed = parseU64(p, next, major) && parseU64(p, next, minor);
+        if (parsed)
+        {
+            parseToken(p, next, name);
+            for (guint64 &value : values)
+                parsed = parsed && parseU64(p, next, value);
+        }
+        line = next + 1;
+
+        // block devices which never did any I/O are not reported
+        if (!parsed || name.empty() || ((values[0] == 0) && (values[4] == 0)))
+            continue;
+        if ((name.compare(0, 4, "loop") == 0) || (name.compare(0, 3, "ram") == 0))
+            continue;
+
+        DiskCounters current = {values[0], values[2], values[4], values[6], values[9], cycle};
+        auto it = diskCounters.find(name);
+        if (it == diskCounters.end())
+        {
+            diskCounters.emplace(name, current);
+            continue;
+        }
+
+        DiskCounters &previous = it->second;
+        if (elapsedUs > 0)
+        {
+            double ioTimePercent = perSecond(current.ioTimeMs, previous.ioTimeMs, elapsedUs) * 100.0 / 1000.0;
+            record.clear();
+            LineProtocolEncoder(record)
+                .measurement("system_disk")
+                .tag("name", name)
+                .field("reads_per_sec", perSecond(current.reads, previous.reads, elapsedUs), 1)
+                .field("writes_per_sec", perSecond(current.writes, previous.writes, elapsedUs), 1)
+                .field("read_bytes_per_sec", perSecond(current.sectorsRead, previous.sectorsRead, elapsedUs) * SECTOR_SIZE, 0)
+                .field("write_bytes_per_sec", perSecond(current.sectorsWritten, previous.sectorsWritten, elapsedUs) * SECTOR_SIZE, 0)
+                .field("io_util_percent", MIN(ioTimePercent, 100.0), 2)
+                .field("io_in_progress", (int64_t)values[8])
+                .timestamp(timestampNs);
+            send();
+        }
+        previous = current;
+    }
+
+    // removed devices
+    for (auto it = diskCounters.begin(); it != diskCounters.end();)
+    {
+        if (it->second.cycle != cycle)
+            it = diskCounters.erase(it);
+        else
+            ++it;
+    }
+}
+
+/*
+ * Inter-|   Receive                                                |  Transmit
+ *  face |bytes    packets errs drop fifo frame compressed multicast|bytes    packets errs drop ...
+ *   eth0: 1215645    2751    0    0    0     0          0         0  1782404    4324    0    0 ...
+ */
+void SystemCollector::collectNetwork(gint64 elapsedUs, int64_t timestampNs)
+{
+    size_t length = 0;
+    const char *data = readFile(files[NETWORK], &length);
+    if (data == NULL) return;
+    const char *end = data + length;
+
+    std::string &name = token;
+    for (const char *line = data; line < end;)
+    {
+        const char *next = lineEnd(line, end);
+        const char *colon = (const char *)memchr(line, ':', next - line);
+        const char *p = line;
+        line = next + 1;
+        if (colon == NULL) continue;
+
+        // the two header lines have no ':'
+        skipBlanks(p, colon);
+        name.assign(p, colon - p);
+        if (name.empty() || (name == "lo")) continue;
+
+        p = colon + 1;
+        guint64 values[12];
+        bool parsed = true;
+        for (guint64 &value : values)
+            parsed = parsed && parseU64(p, next, value);
+        if (!parsed) continue;
+
+        NetCounters current = {values[0], values[1], values[8], values[9], cycle};
+
+        record.clear();
+        LineProtocolEncoder encoder(record);
+        encoder.measurement("system_net").tag("interface", name);
+
+        auto it = netCounters.find(name);
+        if (it != netCounters.end())
+        {
+            NetCounters &previous = it->second;
+            if (elapsedUs > 0)
+            {
+                encoder.field("rx_bytes_per_sec", perSecond(current.rxBytes, previous.rxBytes, elapsedUs), 0)
+                    .field("tx_bytes_per_sec", perSecond(current.txBytes, previous.txBytes, elapsedUs), 0)
+                    .field("rx_packets_per_sec", perSecond(current.rxPackets, previous.rxPackets, elapsedUs), 1)
+                    .field("tx_packets_per_sec", perSecond(current.txPackets, previous.txPackets, elapsedUs), 1);
+            }
+            previous = current;
+        }
+        else
+        {
+            netCounters.emplace(name, current);
+        }
+
+        encoder.field("rx_errors", (int64_t)values[2])
+            .field("rx_drop", (int64_t)values[3])
+            .field("tx_errors", (int64_t)values[10])
+            .field("tx_drop", (int64_t)values[11])
+            .timestamp(timestampNs);
+        send();
+    }
+
+    // removed interfaces
+    for (auto it = netCounters.begin(); it != netCounters.end();)
+    {
+        if (it->second.cycle != cycle)
+            it = netCounters.erase(it);
+        else
+            ++it;
+    }
+}
+
+// directory entries "<prefix><n>" of a sysfs directory, in the order of n
+static void listNumberedEntries(const char *directory, const char *prefix, std::vector<std::pair<long, std::string>> &out)
+{
+    out.clear();
+    DIR *dir = opendir(directory);
+    if (dir == NULL) return;
+
+    size_t prefixLength = strlen(prefix);
+    struct dirent *dirEntry;
+    while ((dirEntry = readdir(dir)) != NULL)
+    {
+        const char *name = dirEntry->d_name;
+        if ((strncmp(name, prefix, prefixLength) != 0) || (name[prefixLength] < '0') || (name[prefixLength] > '9'))
+            continue;
+
+        char *numberEnd = NULL;
+        long number = strtol(name + prefixLength, &numberEnd, 10);
+        if (*numberEnd == '\0')
+            out.push_back({number, name});
+    }
+    closedir(dir);
+    std::sort(out.begin(), out.end());
+}
+
+void SystemCollector::scanCpufreq()
+{
+    for (auto &entry : cpufreqEntries)
+        closeFile(entry.file.fd);
+    cpufreqEntries.clear();
+
+    std::vector<std::pair<long, std::string>> cpus;
+    listNumberedEntries("/sys/devices/system/cpu", "cpu", cpus);
+    for (auto &cpu : cpus)
+    {
+        std::string path = "/sys/devices/system/cpu/" + cpu.second + "/cpufreq/scaling_cur_freq";
+        int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) continue;
+        cpufreqEntries.push_back({cpu.second, "", {path, fd}});
+    }
+    cpufreqScanned = true;
+}
+
+// scaling_cur_freq in kHz
+void SystemCollector::collectCpufreq(int64_t timestampNs)
+{
+    if (!cpufreqScanned || (cycle % SYSFS_RESCAN_CYCLES == 0))
+        scanCpufreq();
+
+    for (auto &entry : cpufreqEntries)
+    {
+        size_t length = 0;
+        const char *data = readFile(entry.file, &length);
+        if (data == NULL) continue;
+
+        const char *p = data;
+        guint64 khz = 0;
+        if (!parseU64(p, data + length, khz)) continue;
+
+        record.clear();
+        LineProtocolEncoder(record)
+            .measurement("system_cpufreq")
+            .tag("cpu", entry.name)
+            .field("cur_freq_khz", (int64_t)khz)
+            .timestamp(timestampNs);
+        send();
+    }
+}
+
+void SystemCollector::scanThermal()
+{
+    for (auto &entry : thermalEntries)
+        closeFile(entry.file.fd);
+    thermalEntries.clear();
+
+    std::vector<std::pair<long, std::string>> zones;
+    listNumberedEntries("/sys/class/thermal", "thermal_zone", zones);
+    for (auto &zone : zones)
+    {
+        std::string directory = "/sys/class/thermal/" + zone.second;
+        std::string path = directory + "/temp";
+        int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) continue;
+
+        std::string type = readTextFile((directory + "/type").c_str());
+        while (!type.empty() && isspace((unsigned char)type.back()))
+            type.pop_back();
+        thermalEntries.push_back({zone.second, type, {path, fd}});
+    }
+    thermalScanned = true;
+}
+
+// temp in millidegree Celsius, sensors which are not ready fail the read
+void SystemCollector::collectThermal(int64_t timestampNs)
+{
+    if (!thermalScanned || (cycle % SYSFS_RESCAN_CYCLES == 0))
+        scanThermal();
+
+    for (auto &entry : thermalEntries)
+    {
+        size_t length = 0;
+        const char *data = readFile(entry.file, &length);
+        if (data == NULL) continue;
+
+        char *numberEnd = NULL;
+        long milliCelsius = strtol(data, &numberEnd, 10);
+        if (numberEnd == data) continue;
+
+        record.clear();
+        LineProtocolEncoder(record)
+            .measurement("system_thermal")
+            .tag("zone", entry.name)
+            .tag("type", entry.type)
+            .field("temp_c", milliCelsius / 1000.0, 1)
+            .timestamp(timestampNs);
+        send();
+    }
+}
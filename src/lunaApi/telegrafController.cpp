@@ -18,6 +18,7 @@
 #include "common.h"
 #include "logging.h"
 #include "tomlParser.h"
+#include "webOSConfig.h"
 #include <spawn.h>
 #include <signal.h>
 #include <sys/wait.h>
@@ -43,7 +44,17 @@ std::unordered_map<std::string, std::unordered_set<std::string>> availableConfig
     {"agent", {"interval", "flush_interval"}},
     {"outputs.influxdb", {"database", "urls"}},
     {"webOS.webProcessSize", {"enabled"}},
-    {"webOS.processMonitoring", {"process_name", "enabled"}}
+    {"webOS.processMonitoring", {"process_name", "enabled", "proc_connector", "workers",
+                                 "memory_fields", "smaps_interval_ms", "thread_processes", "thread_top_k"}},
+    {"webOS.socket", {"send_buffer_size", "max_datagram_size", "linger_ms",
+                      "queue_capacity", "max_record_size", "overflow_policy", "block_timeout_ms",
+                      "stats_interval_sec"}},
+    {"webOS.system", {"cpu", "memory", "load", "vmstat", "disk", "network", "cpufreq", "thermal"}},
+    {"webOS.spool", {"enabled", "max_size_kb", "replay_rate"}},
+    {"webOS.sinks", {"telegraf", "unix_sockets", "file_path", "file_max_size_kb", "file_max_files",
+                     "shm", "shm_entries"}},
+    {"webOS.influxdb", {"enabled", "batch_size_kb", "flush_interval_ms", "gzip", "max_retries",
+                        "retry_backoff_ms", "timeout_ms"}}
 };
 
 std::string getSectionConfigPath(std::string sectionName)
@@ -58,11 +69,28 @@ TelegrafController::TelegrafController()
 {
     splitMainConfig();
     initAvailableConfigurations();
+    reloadConfig();
+
+    configWatcher = new FileWatcher("TelegrafConfigWatch", {TELEGRAF_DIR, TELEGRAF_CONFIG_DIR},
+                                    [](const std::set<std::string> &changedPaths) {
+        for (auto &path : changedPaths)
+        {
+            bool isConf = (path.length() > 5) && (path.compare(path.length() - 5, 5, ".conf") == 0);
+            if (isConf || (path == TELEGRAF_DIR) || (path == TELEGRAF_CONFIG_DIR))
+            {
+                reloadConfig();
+                return;
+            }
+        }
+    });
+    WebOSConfig::getInstance()->addListener([]() { reloadConfig(); });
 }
 
 TelegrafController::~TelegrafController()
 {
     if (pid_ <= 0) stop();
+    delete configWatcher;
+    configWatcher = nullptr;
 }
 
 static std::tuple<bool, tomlObject> getTelegrafConfig()
@@ -120,47 +148,67 @@ void TelegrafController::initAvailableConfigurations()
     }
 }
 
-void TelegrafController::loadConfig()
+// reports the webOS sections of config.json in the telegraf configuration
+void TelegrafController::mergeWebOSConfig(tomlObject &config)
 {
-    bool ret = true;
-    std::tie(ret, _allConfig) = getTelegrafConfig();
-
-    // load webOS Config
-    if (ret) {
-
-        pbnjson::JValue webOSConfigJson = readWebOSJsonConfig();
+    WebOSConfig::Snapshot webOSConfig = WebOSConfig::getInstance()->snapshot();
+    const pbnjson::JValue &webOSConfigJson = *webOSConfig;
+
+    if (
+        webOSConfigJson.hasKey("webOS.webProcessSize") &&
+        webOSConfigJson["webOS.webProcessSize"].hasKey("enabled")
+    ) {
+        config["webOS.webProcessSize"]["enabled"] = "false";
+        if (webOSConfigJson["webOS.webProcessSize"]["enabled"].asBool()) {
+            config["webOS.webProcessSize"]["enabled"] = "true";
+        }
+    }
 
-        if (
-            webOSConfigJson.hasKey("webOS.webProcessSize") &&
-            webOSConfigJson["webOS.webProcessSize"].hasKey("enabled")
-        ) {
-            _allConfig["webOS.webProcessSize"]["enabled"] = "false";
-            if (webOSConfigJson["webOS.webProcessSize"]["enabled"].asBool()) {
-                _allConfig["webOS.webProcessSize"]["enabled"] = "true";
+    if (
+        webOSConfigJson.hasKey("webOS.processMonitoring") && 
+        webOSConfigJson["webOS.processMonitoring"].hasKey("enabled")
+    ) {
+        config["webOS.processMonitoring"]["enabled"] = "false";
+        if (webOSConfigJson["webOS.processMonitoring"]["enabled"].asBool()) {
+            config["webOS.processMonitoring"]["enabled"] = "true";
+            std::string processList = "[";
+            pbnjson::JValue process_name = (webOSConfigJson["webOS.processMonitoring"])["process_name"];
+            if (process_name.isArray())
+            {
+                for (int i = 0; i < process_name.arraySize(); i++) {
+                    processList += '\"' + process_name[i].asString() + "\", ";
+                }
+                if ((!processList.empty()) && (processList.at(processList.length() - 2) == ',')) {
+                    processList.pop_back();
+                    processList.pop_back();
+                }
+            }
+            processList += ']';
+            config["webOS.processMonitoring"]["process_name"] = std::move(processList);
+        }
+        if (webOSConfigJson["webOS.processMonitoring"].hasKey("proc_connector")) {
+            config["webOS.processMonitoring"]["proc_connector"] = webOSConfigJson["webOS.processMonitoring"]["proc_connector"].stringify();
+        }
+        for (const char *key : {"workers", "memory_fields", "smaps_interval_ms", "thread_processes", "thread_top_k"}) {
+            if (webOSConfigJson["webOS.processMonitoring"].hasKey(key)) {
+                config["webOS.processMonitoring"][key] = webOSConfigJson["webOS.processMonitoring"][key].stringify();
             }
         }
+    }
 
-        if (
-            webOSConfigJson.hasKey("webOS.processMonitoring") && 
-            webOSConfigJson["webOS.processMonitoring"].hasKey("enabled")
-        ) {
-            _allConfig["webOS.processMonitoring"]["enabled"] = "false";
-            if (webOSConfigJson["webOS.processMonitoring"]["enabled"].asBool()) {
-                _allConfig["webOS.processMonitoring"]["enabled"] = "true";
-                std::string processList = "[";
-                pbnjson::JValue process_name = (webOSConfigJson["webOS.processMonitoring"])["process_name"];
-                if (process_name.isArray())
-                {
-                    for (int i = 0; i < process_name.arraySize(); i++) {
-                        processList += '\"' + process_name[i].asString() + "\", ";
-                    }
-                    if ((!processList.empty()) && (processList.at(processList.length() - 2) == ',')) {
-                        processList.pop_back();
-                        processList.pop_back();
-                    }
-                }
-                processList += ']';
-                _allConfig["webOS.processMonitoring"]["process_name"] = std::move(processList);
+    // the other webOS sections are reported as they are stored
+    for (auto &it : availableConfiguration)
+    {
+        auto &sectionName = it.first;
+        if ((sectionName.compare(0, 6, "webOS.") != 0) ||
+            (sectionName == "webOS.webProcessSize") ||
+            (sectionName == "webOS.processMonitoring") ||
+            !webOSConfigJson.hasKey(sectionName))
+            continue;
+
+        for (auto &configParam : it.second) {
+            if (webOSConfigJson[sectionName].hasKey(configParam)) {
+                config[sectionName][configParam] = webOSConfigJson[sectionName][configParam].stringify();
             }
         }
     }
@@ -256,7 +304,7 @@ SDKError TelegrafController::start()
             lastStartedTime = std::chrono::system_clock::now();
 
             SDK_LOG_INFO(MSGID_SDKAGENT, 0, "SDKAgent loading telegraf configurations");
-            loadConfig();
+            reloadConfig();
         }
         else {
             SDK_LOG_ERROR(MSGID_SDKAGENT, 0, "Failed to start telegraf with errorCode: %d", errCode);
@@ -337,10 +385,43 @@ bool TelegrafController::isRunning()
     return false;
 }
 
+void TelegrafController::reloadConfig()
+{
+    std::lock_guard<std::mutex> lock(configMutex);
+
+    bool ret = true;
+    tomlObject config;
+    std::tie(ret, config) = getTelegrafConfig();
+    if (!ret) return;
+    mergeWebOSConfig(config);
+
+    if (*std::atomic_load(&configSnapshot) == config) return;
+    std::atomic_store(&configSnapshot, ConfigSnapshot(std::make_shared<const tomlObject>(std::move(config))));
+    guint64 version = configVersion.fetch_add(1) + 1;
+    SDK_LOG_INFO(MSGID_SDKAGENT, 0, "Telegraf configuration version %llu", (unsigned long long)version);
+}
+
+TelegrafController::ConfigSnapshot TelegrafController::getConfigSnapshot()
+{
+    return std::atomic_load(&configSnapshot);
+}
+
+guint64 TelegrafController::getConfigVersion()
+{
+    return configVersion.load();
+}
+
 tomlObject TelegrafController::getConfig()
 {
-    loadConfig();
-    return _allConfig;
+    return *getConfigSnapshot();
+}
+
+std::string TelegrafController::configValue(const tomlObject &config, const std::string &section, const std::string &key)
+{
+    auto sectionIt = config.find(section);
+    if (sectionIt == config.end()) return "";
+    auto valueIt = sectionIt->second.find(key);
+    return (valueIt == sectionIt->second.end()) ? "" : valueIt->second;
 }
 
 bool TelegrafController::updateSectionConfig(const std::string &section, tomlObject &inputConfig)
@@ -432,6 +513,7 @@ bool TelegrafController::setConfig(tomlObject &inputConfig)
         updateSectionConfig(it.first, inputConfig);
     }
     updateWebOSConfig(inputConfig);
+    reloadConfig();
 
     return true;
 }
@@ -19,19 +19,39 @@
 #include "threadForInterval.h"
 #include "common.h"
 #include "telegrafController.h"
+#include "lineProtocol.h"
+#include "procHandleCache.h"
+#include "procMemory.h"
+#include "procStat.h"
+#include "processNameCache.h"
+#include "processSampleTable.h"
+#include "processTracker.h"
+#include "runningApps.h"
+#include "samplingPool.h"
+#include "systemCollector.h"
+#include "webOSConfig.h"
 
 #include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
 #include <unordered_map>
 #include <iomanip>
 #include <unordered_set>
 #include <iterator>
 
+// client-only name of the private bus handle, see the role file
+#define COLLECTOR_SERVICE_NAME "com.webos.service.sdkagent.collector"
+
 ThreadForInterval::ThreadForInterval()
 {
     IntervalHandle *intervalHandle = g_new(IntervalHandle, 1);
     if (intervalHandle != NULL)
     {
+        intervalHandle->collectorLoop = collectorLoop_create();
         intervalHandle->queue = g_async_queue_new();
+        intervalHandle->scheduler = new IntervalScheduler();
         intervalHandle->thread = g_thread_new("IntervalThread", ThreadForInterval::intervalHandle_process, intervalHandle);
     }
     pIntervalHandle = intervalHandle;
@@ -51,20 +71,33 @@ bool ThreadForInterval::cb_getWebProcessSize(LSHandle *sh, LSMessage *msg, void
         SDK_LOG_ERROR(MSGID_SDKAGENT, 0, "%s returnValue is false [%d:%s]\n", __FUNCTION__, errno, strerror(errno));
         return false;
     }
+    // every sample of this reply shares one timestamp
+    int64_t timestampNs = LineProtocolEncoder::nowNs();
+    // replies are dispatched by the collector loop only
+    static std::string sendData;
+
     pbnjson::JValue webProcesses = response["WebProcesses"];
     for (int i = 0; i < webProcesses.arraySize(); i++)
     {
         std::string pid = webProcesses[i]["pid"].asString();
+        // reported as "<size>KB"
         std::string webProcessSize = webProcesses[i]["webProcessSize"].asString();
-        webProcessSize.erase(webProcessSize.size() - 2);
+        char *sizeEnd = NULL;
+        long long webProcessSizeKB = strtoll(webProcessSize.c_str(), &sizeEnd, 10);
+        if (sizeEnd == webProcessSize.c_str()) continue;
+
         pbnjson::JValue runningApps = webProcesses[i]["runningApps"];
         for (int j = 0; j < runningApps.arraySize(); j++)
         {
             pbnjson::JValue app = runningApps[j];
             std::string processId = app["id"].asString();
-            std::string sendData = std::string("webProcessSize,webId=");
-            sendData += processId + ",pid=" + pid + " webProcessSize=" + webProcessSize;
-            SDK_LOG_INFO(MSGID_SDKAGENT, 0, "[webProcessSize] sendData : %s", sendData.c_str());
+
+            sendData.clear();
+            LineProtocolEncoder(sendData).measurement("webProcessSize")
+                .tag("webId", processId)
+                .tag("pid", pid)
+                .field("webProcessSize", (int64_t)webProcessSizeKB)
+                .timestamp(timestampNs);
             LunaApiCollector::Instance()->sendToTelegraf(sendData);
         }
     }
@@ -78,169 +111,553 @@ static unsigned long page_to_kb(int x)
     return (unsigned long)(x * npage_per_kb);
 }
 
-// get utime/stime in /proc/pid/stat
-float getProcessTime(const std::string& sPID)
+// /proc handles of the monitored processes, read by the sampling workers
+static ProcHandleCache procHandles;
+
+bool readProcessStat(int pid, ProcStat &stat)
+{
+    size_t length = 0;
+    const char *buffer = procHandles.read(pid, ProcHandleCache::STAT, &length);
+    if (!parseProcStat(buffer, length, stat)) {
+        SDK_LOG_ERROR(MSGID_SDKAGENT, 0, "Error reading /proc/%d/stat", pid);
+        return false;
+    }
+    return true;
+}
+
+gint64 configIntervalUs = 0;
+
+// previous utime + stime of every sampled process
+static ProcessSampleTable processSamples;
+
+static const double clockTicksPerSec = (double)sysconf(_SC_CLK_TCK);
+// refreshed by the interval thread at the start of every cycle
+static long onlineCpus = 1;
+
+// CPU time used between two samples, in percent of the monotonic time between them
+typedef struct _CpuUsage CpuUsage;
+struct _CpuUsage
+{
+    double userPercent;             // of one core
+    double systemPercent;
+    double corePercent;             // user + system, above 100 for a process busy on several cores
+    double totalPercent;            // of all online CPUs
+};
+
+static bool computeCpuUsage(const ProcessSampleTable::Sample &previous, const ProcessSampleTable::Sample &current, CpuUsage &usage)
+{
+    gint64 elapsedUs = current.timeUs - previous.timeUs;
+    if (elapsedUs <= 0) return false;
+
+    double percentPerTick = 100.0 * G_USEC_PER_SEC / (clockTicksPerSec * elapsedUs);
+    guint64 userTicks = (current.utime > previous.utime) ? (current.utime - previous.utime) : 0;
+    guint64 systemTicks = (current.stime > previous.stime) ? (current.stime - previous.stime) : 0;
+    usage.userPercent = userTicks * percentPerTick;
+    usage.systemPercent = systemTicks * percentPerTick;
+    usage.corePercent = usage.userPercent + usage.systemPercent;
+    usage.totalPercent = usage.corePercent / onlineCpus;
+    return true;
+}
+
+static void appendCpuFields(LineProtocolEncoder &encoder, const CpuUsage &usage)
 {
-    float utime = 0.0f;
-    float stime = 0.0f;
+    encoder.field("interval_cpu_usage", usage.corePercent, 2)
+        .field("cpu_total_percent", usage.totalPercent, 2)
+        .field("cpu_user_percent", usage.userPercent, 2)
+        .field("cpu_system_percent", usage.systemPercent, 2);
+}
+
+// false for the first sample of a process: there is nothing to compare it with
+bool intervalCPUsage(int pid, const ProcStat &stat, gint64 sampleTimeUs, CpuUsage &usage)
+{
+    ProcessSampleTable::Sample current = {stat.utime, stat.stime, sampleTimeUs, 0, 0};
+    ProcessSampleTable::Sample previous;
+    if (!processSamples.update(pid, stat.starttime, current, &previous))
+        return false;
+    return computeCpuUsage(previous, current, usage);
+}
 
-    gchar * buffer = NULL;
-    gsize bufferSize = 0;
-    GError * err = NULL;
+unsigned long intervalGPUsage(int pid)
+{
+    unsigned long gpu = 0;
+    // /proc/gpu only exists on some targets
+    const char *buffer = procHandles.read(pid, ProcHandleCache::GPU);
+    if (buffer != NULL) {
+        if (sscanf(buffer, "%lu", &gpu) != 1) {
+            SDK_LOG_ERROR(MSGID_SDKAGENT, 0, "Error reading /proc/gpu/%d", pid);
+        }
+    }
+
+    return page_to_kb(gpu) / 1024;      // to KB
+}
+
+std::string exceptionProcesses[1] = {"telegraf"};
+
+// "webOS.processMonitoring" memory_fields, named like the fields they add (kB)
+enum
+{
+    MEMORY_VSZ = 1 << 0,            // statm size
+    MEMORY_VMRSS = 1 << 1,          // statm resident
+    MEMORY_SMAPS_RSS = 1 << 2,
+    MEMORY_SMAPS_PSS = 1 << 3,
+    MEMORY_SMAPS_USS = 1 << 4,      // Private_Clean + Private_Dirty
+    MEMORY_SMAPS_SWAP = 1 << 5,
+};
+#define MEMORY_STATM_FIELDS (MEMORY_VSZ | MEMORY_VMRSS)
+#define MEMORY_SMAPS_FIELDS (MEMORY_SMAPS_RSS | MEMORY_SMAPS_PSS | MEMORY_SMAPS_USS | MEMORY_SMAPS_SWAP)
+
+static const struct {
+    const char *name;
+    guint flag;
+} memoryFieldNames[] = {
+    {"VSZ", MEMORY_VSZ}, {"vmRSS", MEMORY_VMRSS}, {"smaps_RSS", MEMORY_SMAPS_RSS},
+    {"smaps_PSS", MEMORY_SMAPS_PSS}, {"smaps_USS", MEMORY_SMAPS_USS}, {"smaps_swap", MEMORY_SMAPS_SWAP}
+};
+
+// statm is as cheap as stat, smaps walks every mapping and is only read when asked for
+static guint parseMemoryFields(const pbnjson::JValue &processMonitoring)
+{
+    pbnjson::JValue names = processMonitoring["memory_fields"];
+    if (!names.isArray()) return MEMORY_STATM_FIELDS;
+
+    guint fields = 0;
+    for (int i = 0; i < names.arraySize(); i++)
+    {
+        // unknown names are ignored
+        std::string name = trim_string(names[i].asString());
+        for (auto &field : memoryFieldNames)
+        {
+            if (name == field.name)
+                fields |= field.flag;
+        }
+    }
+    return fields;
+}
+
+// smaps_interval_ms: the smaps fields are only added to cycles at least that far apart
+static bool smapsDue(gint64 intervalMs)
+{
+    static gint64 lastSmapsTime = 0;
+    gint64 now = g_get_monotonic_time();
+    // half an interval of slack, the cycles themselves are not exactly periodic
+    if ((intervalMs > 0) && (lastSmapsTime != 0) && (now - lastSmapsTime + configIntervalUs / 2 < intervalMs * 1000))
+        return false;
+    lastSmapsTime = now;
+    return true;
+}
+
+// smaps_rollup when the kernel has it (4.14), otherwise every mapping of smaps
+static bool readSmaps(int pid, SmapsTotals &totals)
+{
+    static const bool rollupSupported = (access("/proc/self/smaps_rollup", R_OK) == 0);
+    thread_local SmapsParser parser;
+    parser.reset();
+
+    if (rollupSupported)
+    {
+        size_t length = 0;
+        const char *buffer = procHandles.read(pid, ProcHandleCache::SMAPS_ROLLUP, &length);
+        if (buffer == NULL) return false;
+        parser.feed(buffer, length);
+    }
+    else if (!procHandles.readStream(pid, ProcHandleCache::SMAPS,
+                                     [](const char *data, size_t length) { parser.feed(data, length); }))
+    {
+        return false;
+    }
+    totals = parser.finish();
+    return true;
+}
 
-    std::string psPath = "/proc/" + sPID + "/stat";
-    if (!g_file_get_contents(psPath.c_str(), &buffer, &bufferSize, &err)) {
-        SDK_LOG_ERROR(MSGID_SDKAGENT, 0, "Error reading %s", psPath.c_str());
+static void appendMemoryFields(LineProtocolEncoder &encoder, int pid, guint fields)
+{
+    if (fields & MEMORY_STATM_FIELDS)
+    {
+        size_t length = 0;
+        const char *buffer = procHandles.read(pid, ProcHandleCache::STATM, &length);
+        ProcStatm statm;
+        if (parseProcStatm(buffer, length, statm))
+        {
+            if (fields & MEMORY_VSZ) encoder.field("VSZ", (int64_t)statm.sizeKb);
+            if (fields & MEMORY_VMRSS) encoder.field("vmRSS", (int64_t)statm.residentKb);
+        }
     }
-    else {
-        // we want to obtain 14-15th values (utime, stime).
-        // split to maximum 16 tokens (last token is for the rest of the string)
-        gchar **tokens = g_strsplit(buffer, " ", 16);
-        utime = (float)g_strtod(tokens[13], NULL);
-        stime = (float)g_strtod(tokens[14], NULL);
-        g_strfreev(tokens);
+
+    SmapsTotals totals;
+    if ((fields & MEMORY_SMAPS_FIELDS) && readSmaps(pid, totals))
+    {
+        if (fields & MEMORY_SMAPS_RSS) encoder.field("smaps_RSS", (int64_t)totals.rssKb);
+        if (fields & MEMORY_SMAPS_PSS) encoder.field("smaps_PSS", (int64_t)totals.pssKb);
+        if (fields & MEMORY_SMAPS_USS) encoder.field("smaps_USS", (int64_t)totals.ussKb());
+        if (fields & MEMORY_SMAPS_SWAP) encoder.field("smaps_swap", (int64_t)totals.swapKb);
     }
+}
 
-    g_free(buffer);
-    g_error_free(err);
+// running list of the cycle, taken by the interval thread before the sampling workers start
+static RunningApps::Snapshot runningApps = std::make_shared<const RunningApps::Table>();
 
-    return utime + stime;
+// web apps run in WebAppMgr processes and are reported by their app id
+static bool findWebAppId(int pid, const std::string &exe, std::string &appId)
+{
+    if (exe.find("WebAppMgr") == std::string::npos) return false;
+    auto it = runningApps->appIdByPid.find(pid);
+    if (it == runningApps->appIdByPid.end()) return false;
+    appId = it->second;
+    return true;
 }
 
-int configIntervalSecond = 0;
+// exe, comm and app id of the processes found by the /proc walk
+static ProcessNameCache processNames;
 
-std::unordered_map<int, float> process_time_mapper;
-std::string intervalCPUsage(int pid)
+typedef struct _SamplingTarget SamplingTarget;
+struct _SamplingTarget
 {
-    std::string sPID = std::to_string(pid);
-    float curr_process_time = getProcessTime(sPID);
+    int pid;
+    std::string processName;        // empty: resolved through processNames
+    std::vector<std::string> sharedNames;   // other monitored apps in the same process
+};
+
+// "webOS.processMonitoring" thread_processes: the hottest threads of these processes are
+// reported too, at most thread_top_k of them per process and cycle.
+#define DEFAULT_THREAD_TOP_K 5
+#define MAX_THREAD_TOP_K 32
+
+// set by the interval thread before the sampling workers start
+static std::vector<std::string> threadProcesses;
+static size_t threadTopK = DEFAULT_THREAD_TOP_K;
 
-    if (process_time_mapper.find(pid) == process_time_mapper.end()) {
-        process_time_mapper[pid] = curr_process_time;
-        return "0";
+// previous CPU times and context switches of every sampled thread
+static ProcessSampleTable threadSamples;
+
+// cost of the thread mode in the current cycle, CPU time summed over the workers
+static std::atomic<guint> cycleThreadProcesses(0);
+static std::atomic<guint> cycleThreads(0);
+static std::atomic<gint64> cycleThreadCostUs(0);
+
+static void updateThreadSelection(const pbnjson::JValue &processMonitoring)
+{
+    threadProcesses.clear();
+    pbnjson::JValue names = processMonitoring["thread_processes"];
+    for (int i = 0; names.isArray() && (i < names.arraySize()); i++)
+    {
+        std::string name = trim_string(names[i].asString());
+        if (!name.empty())
+            threadProcesses.push_back(std::move(name));
     }
+    threadTopK = CLAMP(jsonNumberOrDefault(processMonitoring, "thread_top_k", DEFAULT_THREAD_TOP_K), 1, MAX_THREAD_TOP_K);
+}
 
-    float prev_process_time = process_time_mapper[pid];
-    float elapsed = curr_process_time - prev_process_time;
-    process_time_mapper[pid] = curr_process_time;
-    elapsed = elapsed / (float)configIntervalSecond;
+// matches the reported name (app id or executable) or the basename of the executable
+static bool wantsThreads(const std::string &processName)
+{
+    for (auto &name : threadProcesses)
+    {
+        if (processName == name) return true;
+        size_t offset = processName.length() - name.length();
+        if ((processName.length() > name.length()) && (processName[offset - 1] == '/') &&
+            (processName.compare(offset, std::string::npos, name) == 0))
+            return true;
+    }
+    return false;
+}
+
+typedef struct _ThreadUsage ThreadUsage;
+struct _ThreadUsage
+{
+    int tid;
+    char name[sizeof(ProcStat::comm)];
+    CpuUsage cpu;
+    double voluntarySwitchesPerSec;
+    double involuntarySwitchesPerSec;
+};
+
+// appends a threadMonitoring record for each of the top-K threads of pid; runs on any sampling worker
+static void sampleThreads(int pid, const std::string &processName, int64_t timestampNs, std::string &out)
+{
+    gint64 startTime = g_get_monotonic_time();
 
-    std::stringstream cpu_usage_stream;
-    cpu_usage_stream << std::fixed << std::setprecision(2) << elapsed;
-    return cpu_usage_stream.str();
+    // reused by every process sampled on this worker
+    thread_local std::vector<int> tids;
+    thread_local std::vector<ThreadUsage> usages;
+    usages.clear();
+    if (!procHandles.readTasks(pid, tids)) return;
+
+    for (int tid : tids)
+    {
+        size_t length = 0;
+        ProcStat stat;
+        const char *buffer = procHandles.readTask(pid, tid, ProcHandleCache::STAT, &length);
+        // the thread exited since the directory was read
+        if (!parseProcStat(buffer, length, stat)) continue;
+
+        ProcessSampleTable::Sample current = {stat.utime, stat.stime, g_get_monotonic_time(), 0, 0};
+        buffer = procHandles.readTask(pid, tid, ProcHandleCache::STATUS, &length);
+        parseContextSwitches(buffer, length, current.voluntarySwitches, current.involuntarySwitches);
+
+        // the first sample of a thread is only the baseline
+        ThreadUsage usage;
+        ProcessSampleTable::Sample previous;
+        if (!threadSamples.update(tid, stat.starttime, current, &previous) || !computeCpuUsage(previous, current, usage.cpu))
+            continue;
+
+        double elapsedSec = (double)(current.timeUs - previous.timeUs) / G_USEC_PER_SEC;
+        usage.tid = tid;
+        memcpy(usage.name, stat.comm, sizeof(usage.name));
+        usage.voluntarySwitchesPerSec = (current.voluntarySwitches > previous.voluntarySwitches)
+                                            ? (current.voluntarySwitches - previous.voluntarySwitches) / elapsedSec : 0;
+        usage.involuntarySwitchesPerSec = (current.involuntarySwitches > previous.involuntarySwitches)
+                                              ? (current.involuntarySwitches - previous.involuntarySwitches) / elapsedSec : 0;
+        usages.push_back(usage);
+    }
+
+    // the series stay bounded: only the busiest threads are reported
+    size_t count = MIN(threadTopK, usages.size());
+    std::partial_sort(usages.begin(), usages.begin() + count, usages.end(),
+                      [](const ThreadUsage &a, const ThreadUsage &b) { return a.cpu.corePercent > b.cpu.corePercent; });
+    for (size_t i = 0; i < count; i++)
+    {
+        LineProtocolEncoder(out).measurement("threadMonitoring")
+            .tag("processName", processName)
+            .tag("pid", (int64_t)pid)
+            .tag("tid", (int64_t)usages[i].tid)
+            .tag("threadName", usages[i].name)
+            .field("cpu_percent", usages[i].cpu.corePercent, 2)
+            .field("cpu_user_percent", usages[i].cpu.userPercent, 2)
+            .field("cpu_system_percent", usages[i].cpu.systemPercent, 2)
+            .field("voluntary_ctxt_switches_per_sec", usages[i].voluntarySwitchesPerSec, 2)
+            .field("nonvoluntary_ctxt_switches_per_sec", usages[i].involuntarySwitchesPerSec, 2)
+            .timestamp(timestampNs);
+    }
+
+    cycleThreadProcesses.fetch_add(1, std::memory_order_relaxed);
+    cycleThreads.fetch_add((guint)tids.size(), std::memory_order_relaxed);
+    cycleThreadCostUs.fetch_add(g_get_monotonic_time() - startTime, std::memory_order_relaxed);
 }
 
-std::string intervalGPUsage(const std::string & sPID)
+// appends one processMonitoring record to out, and the threadMonitoring records
+// of a process in thread mode; runs on any sampling worker
+static void sampleProcess(const SamplingTarget &target, int64_t timestampNs, guint memoryFields, std::string &out)
 {
-    unsigned long gpu = 0;
-    std::string procGPUPath = "/proc/gpu/" + sPID;
-    FILE * fp = fopen(procGPUPath.c_str(), "r");
-    if (NULL != fp) {
-        if (fscanf(fp, "%lu", &gpu) != 1) {
-            SDK_LOG_ERROR(MSGID_SDKAGENT, 0, "Error reading %s", procGPUPath.c_str());
-        }
-        fclose(fp);
+    int pid = target.pid;
+    ProcStat stat;
+    if ((pid <= 0) || (configIntervalUs == 0) || !readProcessStat(pid, stat)) return;
+    gint64 sampleTimeUs = g_get_monotonic_time();
+
+    const std::string *processName = &target.processName;
+    ProcessNameCache::NamesPtr names;
+    if (processName->empty())
+    {
+        names = processNames.get(pid, stat.starttime, stat.comm, runningApps->generation,
+            [&stat](int newPid, ProcessNameCache::Names &resolved) {
+                procHandles.readExe(newPid, resolved.exe);
+                resolved.comm = stat.comm;
+            },
+            [](int newPid, ProcessNameCache::Names &resolved) {
+                findWebAppId(newPid, resolved.exe, resolved.appId);
+            });
+        // kernel threads have no exe and are not monitored
+        if (names->exe.empty()) return;
+        processName = names->appId.empty() ? &names->exe : &names->appId;
     }
-    else {
-        SDK_LOG_ERROR(MSGID_SDKAGENT, 0, "Error reading %s", procGPUPath.c_str());
+
+    LineProtocolEncoder encoder(out);
+    encoder.measurement("processMonitoring")
+        .tag("processName", *processName);
+    size_t tailStart = out.size();
+    encoder.tag("pid", (int64_t)pid);
+    CpuUsage usage;
+    if (intervalCPUsage(pid, stat, sampleTimeUs, usage))
+        appendCpuFields(encoder, usage);
+    encoder.field("interval_gpu_usage", (int64_t)intervalGPUsage(pid));
+    appendMemoryFields(encoder, pid, memoryFields);
+    encoder.timestamp(timestampNs);
+    size_t tailEnd = out.size();
+
+    // web apps sharing a WebAppMgr process: the same numbers under each app id
+    const std::string *threadName = wantsThreads(*processName) ? processName : NULL;
+    for (auto &name : target.sharedNames)
+    {
+        LineProtocolEncoder shared(out);
+        shared.measurement("processMonitoring")
+            .tag("processName", name);
+        out.append(out, tailStart, tailEnd - tailStart);
+        if ((threadName == NULL) && wantsThreads(name))
+            threadName = &name;
     }
 
-    return std::to_string(page_to_kb(gpu) / 1024);      // to KB
+    if (threadName != NULL)
+        sampleThreads(pid, *threadName, timestampNs, out);
 }
 
-std::string exceptionProcesses[1] = {"telegraf"};
-void calculateProcessMonitoring(const std::string& processName, const std::string& sPID)
+// "webOS.processMonitoring" workers: 0 (default) sizes the pool to the CPUs, 1 samples inline
+#define AUTO_SAMPLING_WORKERS_MAX 4
+
+// where the record of a target ended up: one buffer per worker
+typedef struct _SampledRecord SampledRecord;
+struct _SampledRecord
 {
-    int pid = string_to_positive_int(sPID);
-    if (pid == -1 || (configIntervalSecond == 0)) return;
-        
-    std::string sendData = std::string("processMonitoring");
-    sendData += ",processName=" + processName + ",pid=" + sPID + " ";
-
-    sendData += "interval_cpu_usage=" + intervalCPUsage(pid);
-    sendData += ",interval_gpu_usage=" + intervalGPUsage(sPID);
-
-    // calculate memory (kB)
-    // VSZ (Virtual Memory Size) (kB)
-    /*
-    std::string cmd = "cat /proc/" + sPID + "/stat | cut -d\" \" -f23 | xargs -n 1 bash -c 'echo $(($1/1024))' args";
-    std::string VSZ = executeCommand(cmd);
-    sendData += ",VSZ=" + VSZ;
-    // VmRSS = RssAnon + RssFile + RssSHmem (kB)
-    cmd = "cat /proc/" + sPID + "/status | grep '^VmRSS:' | awk '{print $2}'";
-    std::string vmRSS = executeCommand(cmd);
-    sendData += ",vmRSS=" + vmRSS;
-    // RSS (Resident Set Size) (kB)
-    cmd = "grep -e '^Rss' /proc/" + sPID + "/smaps | awk '{sum += $2} END {print sum}'";
-    std::string smaps_RSS = executeCommand(cmd);
-    sendData += ",smaps_RSS=" + smaps_RSS;
-    // PSS (Proportional Set Size) (kB)
-    cmd = "grep -e '^Pss' /proc/" + sPID + "/smaps | awk '{sum += $2} END {print sum}'";
-    std::string smaps_PSS = executeCommand(cmd);
-    sendData += ",smaps_PSS=" + smaps_PSS;
-    // USS (Unique Set Size) = Private_Clean + Private_Dirty (kB)
-    cmd = "grep -e '^Private' /proc/" + sPID + "/smaps | awk '{sum += $2} END {print sum}'";
-    std::string smaps_USS = executeCommand(cmd);
-    sendData += ",smaps_USS=" + smaps_USS;
-    */
-    SDK_LOG_INFO(MSGID_SDKAGENT, 0, "[processMonitoring] sendData : %s", sendData.c_str());
-    LunaApiCollector::Instance()->sendToTelegraf(sendData);
+    size_t worker;
+    size_t offset;
+    size_t length;
+};
+
+// created and resized from the interval thread only
+static std::unique_ptr<SamplingPool> samplingPool;
+static std::vector<std::string> workerBuffers;
+
+static std::mutex samplingStatsMutex;
+static ThreadForInterval::SamplingStats samplingStats = {};
+static gint64 samplingCycleSumUs = 0;
+
+static void resizeSamplingPool(gint64 configuredWorkers)
+{
+    size_t workers = (configuredWorkers > 0) ? (size_t)configuredWorkers
+                                             : MIN(SamplingPool::availableCpus(), (size_t)AUTO_SAMPLING_WORKERS_MAX);
+    workers = CLAMP(workers, (size_t)1, SamplingPool::MAX_WORKERS);
+    if (samplingPool && (samplingPool->workers() == workers)) return;
+
+    samplingPool.reset();
+    samplingPool.reset(new SamplingPool(workers));
+    workerBuffers.resize(workers);
+    SDK_LOG_INFO(MSGID_SDKAGENT, 0, "Process sampling uses %zu worker(s)", workers);
 }
 
-void monitoringAllProcesses(pbnjson::JValue runningWebProcesses)
+// samples every target on the pool, then sends the records in target order
+static void sampleProcesses(const std::vector<SamplingTarget> &targets, int64_t timestampNs, guint memoryFields)
 {
-    char targetProcessName[256];
-    DIR *pDir = opendir("/proc/"); // Open /proc/ directory
-    struct dirent *pDirEntry;
-    while (NULL != (pDirEntry = readdir(pDir)))
-    { // Reading /proc/ entries
-        if (strspn(pDirEntry->d_name, "0123456789") == strlen(pDirEntry->d_name))
-        { // Checking for numbered directories
-            std::string exeLink = "/proc/" + std::string(pDirEntry->d_name) + "/exe";
-            int targetResult = readlink(exeLink.c_str(), targetProcessName, sizeof(targetProcessName) - 1);
-            if (targetResult > 0)
-            {
-                targetProcessName[targetResult] = 0;
-                std::string targetmonitorProcessName(targetProcessName);
-                if (targetmonitorProcessName.find("WebAppMgr") != std::string::npos)
-                { // Not Need???
-                    for (int i = 0; i < runningWebProcesses.arraySize(); i++)
-                    {
-                        pbnjson::JValue webProcess = runningWebProcesses[i];
-                        std::string pid = webProcess["processid"].asString();
-                        if (strcmp(pid.c_str(), pDirEntry->d_name) == 0)
-                        {
-                            std::string runningProcessName = webProcess["id"].asString();
-                            targetmonitorProcessName = std::move(runningProcessName);
-                            break;
-                        }
-                    }
-                }
-                calculateProcessMonitoring(targetmonitorProcessName, std::string(pDirEntry->d_name));
-            }
-        }
+    gint64 startTime = g_get_monotonic_time();
+
+    static std::vector<SampledRecord> records;
+    records.assign(targets.size(), SampledRecord());
+    for (auto &buffer : workerBuffers)
+        buffer.clear();
+    cycleThreadProcesses.store(0);
+    cycleThreads.store(0);
+    cycleThreadCostUs.store(0);
+
+    samplingPool->run(targets.size(), [&](size_t index, size_t worker) {
+        std::string &buffer = workerBuffers[worker];
+        if (!buffer.empty()) buffer.push_back('\n');
+        size_t offset = buffer.size();
+        sampleProcess(targets[index], timestampNs, memoryFields, buffer);
+        records[index] = {worker, offset, buffer.size() - offset};
+    });
+
+    // the records in target order, queued in one call; the socket thread
+    // packs the lines into datagrams
+    static std::string batch;
+    batch.clear();
+    for (auto &record : records)
+    {
+        if (record.length == 0) continue;
+        if (!batch.empty()) batch.push_back('\n');
+        batch.append(workerBuffers[record.worker], record.offset, record.length);
     }
-    closedir(pDir);
+    if (!batch.empty())
+        LunaApiCollector::Instance()->sendBatchToTelegraf(batch);
+
+    gint64 cycleUs = g_get_monotonic_time() - startTime;
+    std::lock_guard<std::mutex> lock(samplingStatsMutex);
+    samplingStats.workers = (guint)samplingPool->workers();
+    samplingStats.processes = (guint)targets.size();
+    samplingStats.cycles++;
+    samplingStats.lastCycleUs = cycleUs;
+    samplingStats.maxCycleUs = MAX(samplingStats.maxCycleUs, cycleUs);
+    samplingCycleSumUs += cycleUs;
+    samplingStats.avgCycleUs = samplingCycleSumUs / (gint64)samplingStats.cycles;
+    samplingStats.threadProcesses = cycleThreadProcesses.load();
+    samplingStats.threads = cycleThreads.load();
+    samplingStats.lastThreadCostUs = cycleThreadCostUs.load();
+    samplingStats.maxThreadCostUs = MAX(samplingStats.maxThreadCostUs, samplingStats.lastThreadCostUs);
 }
 
-bool ThreadForInterval::cb_getRunningProcess(LSHandle *sh, LSMessage *msg, void *monitoringProcesses)
+// "webOS.processMonitoring" proc_connector: started and stopped by the interval thread
+static ProcessTracker processTracker;
+
+// a process that exited since the previous cycle, with the CPU time it used since then
+void recordExitedProcess(const ProcessTracker::ExitedProcess &process, int64_t timestampNs)
 {
-    pbnjson::JValue response = stringToJValue(LSMessageGetPayload(msg));
-    if (!response["returnValue"].asBool())
+    ProcessSampleTable::Sample previous;
+    bool sampled = process.statValid && processSamples.take(process.pid, process.starttime, &previous);
+    if (configIntervalUs == 0) return;
+
+    // named like the live samples in monitoringAllProcesses(), so the exit joins their series
+    static std::string processName;
+    if (!findWebAppId(process.pid, process.exe, processName))
+        processName = process.exe;
+
+    static std::string sendData;
+    sendData.clear();
+    LineProtocolEncoder encoder(sendData);
+    encoder.measurement("processMonitoring")
+        .tag("processName", processName)
+        .tag("pid", (int64_t)process.pid)
+        .field("exited", true);
+
+    // without stat (already reaped) only the exit itself is recorded
+    if (process.statValid)
     {
-        SDK_LOG_ERROR(MSGID_SDKAGENT, 0, "%s returnValue is false [%d:%s]\n", __FUNCTION__, errno, strerror(errno));
-        return false;
+        // never sampled: its whole life was within this interval
+        if (!sampled)
+            previous = {0, 0, process.exitTimeUs - process.lifetimeUs, 0, 0};
+        ProcessSampleTable::Sample current = {process.utime, process.stime, process.exitTimeUs, 0, 0};
+        CpuUsage usage;
+        if (computeCpuUsage(previous, current, usage))
+            appendCpuFields(encoder, usage);
+    }
+    encoder.timestamp(timestampNs);
+    LunaApiCollector::Instance()->sendToTelegraf(sendData);
+}
+
+void monitoringAllProcesses(std::vector<SamplingTarget> &targets)
+{
+    if (processTracker.isRunning())
+    {
+        static std::vector<ProcessTracker::Process> liveProcesses;
+
+        processTracker.getLiveProcesses(liveProcesses);
+        for (auto &process : liveProcesses)
+        {
+            if (process.exe.empty()) continue;
+            SamplingTarget target = {process.pid, std::string(), {}};
+            if (!findWebAppId(process.pid, process.exe, target.processName))
+                target.processName = process.exe;
+            targets.push_back(std::move(target));
+        }
+        return;
     }
 
-    pbnjson::JValue monitorProcessNameList = stringToJValue((char*)monitoringProcesses)["process_name"];
-    if (!monitorProcessNameList.isArray()) return false;
+    // names are resolved by the workers, once per process
+    procHandles.forEachPid([&](int pid) {
+        targets.push_back({pid, std::string(), {}});
+    });
+}
 
-    pbnjson::JValue allRunningProcesses = response["running"];
+// one processMonitoring cycle on the interval thread, the running apps come from the subscription
+void ThreadForInterval::sampleProcessMonitoring(const pbnjson::JValue &processMonitoring)
+{
+    pbnjson::JValue monitorProcessNameList = processMonitoring["process_name"];
+    if (!monitorProcessNameList.isArray()) return;
+
+    runningApps = RunningApps::getInstance()->snapshot();
+    onlineCpus = MAX(sysconf(_SC_NPROCESSORS_ONLN), 1L);
+
+    // every sample of this collection cycle shares one timestamp
+    int64_t timestampNs = LineProtocolEncoder::nowNs();
+    procHandles.beginCycle();
+    processSamples.beginCycle();
+    processNames.beginCycle();
+    threadSamples.beginCycle();
+    updateThreadSelection(processMonitoring);
+    resizeSamplingPool(jsonNumberOrDefault(processMonitoring, "workers", 0));
+
+    static std::vector<SamplingTarget> targets;
+    targets.clear();
 
     if ((monitorProcessNameList.arraySize() == 1) &&
         (monitorProcessNameList[0].asString().compare(".") == 0)
     ) {
-        monitoringAllProcesses(allRunningProcesses);
+        monitoringAllProcesses(targets);
     }
     else
     {
@@ -250,80 +667,141 @@ bool ThreadForInterval::cb_getRunningProcess(LSHandle *sh, LSMessage *msg, void
             monitorProcSet.insert(trim_string(monitorProcessNameList[i].asString()));
         }
         
-        // running process in monitoring processes -> collect data
-        for (int i = 0; i < allRunningProcesses.arraySize(); i++) {
-            pbnjson::JValue runningProcess = allRunningProcesses[i];
-            std::string runningProcessName = trim_string(runningProcess["id"].asString());
+        // running process in monitoring processes -> collect data.
+        // Apps in the same process are one target, a pid is sampled by one worker only.
+        static std::unordered_map<int, size_t> targetByPid;
+        targetByPid.clear();
+        for (auto &app : runningApps->apps) {
+            std::string runningProcessName = trim_string(app.id);
 
             if (monitorProcSet.find(runningProcessName) != monitorProcSet.end()) {
-                std::string sPID = runningProcess["processid"].asString();
                 monitorProcSet.erase(runningProcessName);
-                calculateProcessMonitoring(runningProcessName, sPID);
+                auto it = targetByPid.find(app.pid);
+                if (it != targetByPid.end()) {
+                    targets[it->second].sharedNames.push_back(runningProcessName);
+                    continue;
+                }
+                targetByPid[app.pid] = targets.size();
+                targets.push_back({app.pid, runningProcessName, {}});
             }
         }
     }
 
-    free((char *)monitoringProcesses);
+    guint memoryFields = parseMemoryFields(processMonitoring);
+    if ((memoryFields & MEMORY_SMAPS_FIELDS) && !smapsDue(jsonNumberOrDefault(processMonitoring, "smaps_interval_ms", 0)))
+        memoryFields &= ~MEMORY_SMAPS_FIELDS;
+    sampleProcesses(targets, timestampNs, memoryFields);
 
-    return true;
+    if (processTracker.isRunning())
+    {
+        static std::vector<ProcessTracker::ExitedProcess> exitedProcesses;
+        processTracker.takeExited(exitedProcesses);
+        for (auto &process : exitedProcesses)
+            recordExitedProcess(process, timestampNs);
+    }
 }
 
+guint64 configVersionSeen = 0;
+
 bool needUpdateTelegrafAgentInterval()
 {
+    TelegrafController *controller = TelegrafController::getInstance();
+
     // update for the first time
-    if (configIntervalSecond <= 0) return true;
+    if (configIntervalUs <= 0) {
+        configVersionSeen = controller->getConfigVersion();
+        return true;
+    }
 
-    // check if telegraf is recently started. If yes -> update interval
-    if (TelegrafController::getInstance()->elapsedFromLastStartedTime() <= 60) {
+    // telegraf applies its configuration when it starts: follow changes around that time
+    if ((controller->elapsedFromLastStartedTime() <= 60) && (controller->getConfigVersion() != configVersionSeen)) {
+        configVersionSeen = controller->getConfigVersion();
         return true;
     }
 
     return false;
 }
 
-int ThreadForInterval::getTelegrafAgentInterval()
+// [agent] interval, e.g. "10s" or "500ms"; -1 when missing or invalid
+gint64 ThreadForInterval::getTelegrafAgentIntervalUs()
 {
-    std::string strInterval = trim_string(TelegrafController::getInstance()->getConfig()["agent"]["interval"]);
-    strInterval.erase(0, 1);
-    strInterval.pop_back();
+    TelegrafController::ConfigSnapshot telegrafConfig = TelegrafController::getInstance()->getConfigSnapshot();
+    std::string strInterval = trim_string(TelegrafController::configValue(*telegrafConfig, "agent", "interval"));
+    if ((strInterval.length() >= 2) && ((strInterval[0] == '"') || (strInterval[0] == '\'')))
+        strInterval = strInterval.substr(1, strInterval.length() - 2);
 
-    if (!strInterval.empty())
+    int64_t intervalNs = 0;
+    if (!parseGoDuration(strInterval, intervalNs) || (intervalNs <= 0))
     {
-        int newIntervalInSecond = 0;
+        SDK_LOG_WARNING(MSGID_SDKAGENT, 0, "Invalid agent interval '%s'", strInterval.c_str());
+        return -1;
+    }
 
-        if (strInterval.find("ms") != std::string::npos)
-        {
-            newIntervalInSecond += 1;
-            strInterval = strInterval.substr(strInterval.find("ms") + 1);
-        }
-        if (strInterval.find("h") != std::string::npos)
-        {
-            std::string h = strInterval.substr(0, strInterval.find("h"));
-            int hour = string_to_positive_int(h);
-            newIntervalInSecond += hour * 60 * 60;
-            strInterval = strInterval.substr(strInterval.find("h") + 1);
-        }
-        if (strInterval.find("m") != std::string::npos)
-        {
-            std::string m = strInterval.substr(0, strInterval.find("m"));
-            int minute = string_to_positive_int(m);
-            newIntervalInSecond += minute * 60;
-            strInterval = strInterval.substr(strInterval.find("m") + 1);
-        }
-        if (strInterval.find("s") != std::string::npos)
-        {
-            std::string s = strInterval.substr(0, strInterval.find("s"));
-            int second = string_to_positive_int(s);
-            newIntervalInSecond += second;
-        }
+    gint64 intervalUs = intervalNs / 1000;
+    if (intervalUs < IntervalScheduler::MIN_INTERVAL_US)
+    {
+        SDK_LOG_WARNING(MSGID_SDKAGENT, 0, "Agent interval '%s' is below the minimum, using 100ms", strInterval.c_str());
+        intervalUs = IntervalScheduler::MIN_INTERVAL_US;
+    }
+    return intervalUs;
+}
 
-        return newIntervalInSecond;
+CollectorLoop *ThreadForInterval::collectorLoop_create()
+{
+    CollectorLoop *collectorLoop = g_new0(CollectorLoop, 1);
+    collectorLoop->context = g_main_context_new();
+    collectorLoop->loop = g_main_loop_new(collectorLoop->context, FALSE);
+
+    LSError lserror;
+    LSErrorInit(&lserror);
+    if (!LSRegister(COLLECTOR_SERVICE_NAME, &collectorLoop->lsHandle, &lserror) ||
+        !LSGmainContextAttach(collectorLoop->lsHandle, collectorLoop->context, &lserror))
+    {
+        SDK_LOG_WARNING(MSGID_SDKAGENT, 0, "Cannot register %s, collecting on the main loop: %s",
+                        COLLECTOR_SERVICE_NAME, lserror.message);
+        LSErrorFree(&lserror);
+        if (collectorLoop->lsHandle != NULL)
+            LSUnregister(collectorLoop->lsHandle, NULL);
+        collectorLoop->lsHandle = NULL;
     }
 
-    return -1;
+    collectorLoop->thread = g_thread_new("CollectorLoop", ThreadForInterval::collectorLoop_process, collectorLoop);
+    return collectorLoop;
 }
 
-void ThreadForInterval::collectWebProcessSize(pbnjson::JValue & webOSConfig)
+gpointer ThreadForInterval::collectorLoop_process(gpointer data)
+{
+    CollectorLoop *collectorLoop = (CollectorLoop *)data;
+    g_main_context_push_thread_default(collectorLoop->context);
+    g_main_loop_run(collectorLoop->loop);
+    g_main_context_pop_thread_default(collectorLoop->context);
+    return NULL;
+}
+
+void ThreadForInterval::collectorLoop_destroy(CollectorLoop *collectorLoop)
+{
+    g_return_if_fail(collectorLoop != NULL);
+    g_main_loop_quit(collectorLoop->loop);
+    g_thread_join(collectorLoop->thread);
+    if (collectorLoop->lsHandle != NULL)
+        LSUnregister(collectorLoop->lsHandle, NULL);
+    g_main_loop_unref(collectorLoop->loop);
+    g_main_context_unref(collectorLoop->context);
+    g_free(collectorLoop);
+}
+
+// the public handle and the main loop when the private handle is missing
+static LSHandle *collectorHandle(CollectorLoop *collectorLoop)
+{
+    return collectorLoop->lsHandle ? collectorLoop->lsHandle : LunaApiCollector::Instance()->pLSHandle;
+}
+
+static GMainContext *collectorContext(CollectorLoop *collectorLoop)
+{
+    return collectorLoop->lsHandle ? collectorLoop->context : NULL;
+}
+
+void ThreadForInterval::collectWebProcessSize(CollectorLoop *collectorLoop, const pbnjson::JValue & webOSConfig)
 {
     if (
         webOSConfig.hasKey("webOS.webProcessSize") &&
@@ -332,7 +810,7 @@ void ThreadForInterval::collectWebProcessSize(pbnjson::JValue & webOSConfig)
     ) {
         LSError lserror;
         LSErrorInit(&lserror);
-        if (!LSCall(LunaApiCollector::Instance()->pLSHandle,
+        if (!LSCall(collectorHandle(collectorLoop),
                     "luna://com.webos.service.webappmanager/getWebProcessSize",
                     "{}",
                     ThreadForInterval::cb_getWebProcessSize,
@@ -346,7 +824,27 @@ void ThreadForInterval::collectWebProcessSize(pbnjson::JValue & webOSConfig)
     }
 }
 
-void ThreadForInterval::collectProcessesData(pbnjson::JValue & webOSConfig)
+// the tracker only replaces the /proc walk of the "." mode
+static void updateProcessTracker(const pbnjson::JValue &processMonitoring)
+{
+    static bool trackerFailed = false;
+
+    pbnjson::JValue processNames = processMonitoring["process_name"];
+    bool wanted = processMonitoring.hasKey("proc_connector") && processMonitoring["proc_connector"].asBool() &&
+                  processNames.isArray() && (processNames.arraySize() == 1) && (processNames[0].asString() == ".");
+    if (!wanted)
+    {
+        trackerFailed = false;
+        processTracker.stop();
+    }
+    else if (!trackerFailed && !processTracker.isRunning())
+    {
+        // not retried until the configuration changes, the /proc walk is used instead
+        trackerFailed = !processTracker.start();
+    }
+}
+
+void ThreadForInterval::collectProcessesData(CollectorLoop *collectorLoop, const pbnjson::JValue & webOSConfig)
 {
     if (
         webOSConfig.hasKey("webOS.processMonitoring") &&
@@ -354,56 +852,83 @@ void ThreadForInterval::collectProcessesData(pbnjson::JValue & webOSConfig)
         webOSConfig["webOS.processMonitoring"]["enabled"].asBool()
     ) {
         pbnjson::JValue processMonitoringJValue = webOSConfig["webOS.processMonitoring"];
-        LSError lserror;
-        LSErrorInit(&lserror);
-        char *ctx = strdup(processMonitoringJValue.stringify().c_str());
-        if (!LSCall(LunaApiCollector::Instance()->pLSHandle,
-                    "luna://com.webos.applicationManager/running",
-                    "{}",
-                    ThreadForInterval::cb_getRunningProcess,
-                    (void*)ctx,
-                    NULL,
-                    &lserror))
-        {
-            LSErrorPrint(&lserror, stderr);
-            LSErrorFree(&lserror);
-        }
-    }    
+        updateProcessTracker(processMonitoringJValue);
+        RunningApps::getInstance()->start(collectorHandle(collectorLoop), collectorContext(collectorLoop));
+        sampleProcessMonitoring(processMonitoringJValue);
+    }
+    else
+    {
+        processTracker.stop();
+    }
+}
+
+// "webOS.system": cpu, memory, load, vmstat, disk, network, cpufreq, thermal
+static SystemCollector systemCollector;
+
+void ThreadForInterval::collectSystemData(const pbnjson::JValue & webOSConfig)
+{
+    // also called with the section removed, so that the families disabled close their files
+    pbnjson::JValue systemConfig = webOSConfig.hasKey("webOS.system") ? webOSConfig["webOS.system"] : pbnjson::Object();
+    systemCollector.collect(systemConfig, LineProtocolEncoder::nowNs());
 }
 
 gpointer ThreadForInterval::intervalHandle_process(gpointer data)
 {
     IntervalHandle *intervalHandle = (IntervalHandle *)data;
-    int intervalCountDown = 1;
+    IntervalScheduler *scheduler = intervalHandle->scheduler;
+
+    guint64 missedSinceLog = 0;
+    gint64 lastMissedLogTime = 0;
+
     while (intervalHandle != NULL)
     {
         gpointer msg = g_async_queue_try_pop(intervalHandle->queue);
         if ((msg) && (msg == GINT_TO_POINTER(INTERVAL_THREAD_MSG_STOP))) break;
-            
-        if (TelegrafController::getInstance()->isRunning())
+
+        if (!TelegrafController::getInstance()->isRunning())
+        {
+            // check the telegraf state once a second
+            if (scheduler->interval() > 0)
+                scheduler->setInterval(0);
+            scheduler->wait(1000);
+            continue;
+        }
+
+        if (needUpdateTelegrafAgentInterval())
         {
-            if (needUpdateTelegrafAgentInterval())
+            gint64 newIntervalUs = getTelegrafAgentIntervalUs();
+            if ((newIntervalUs > 0) && (configIntervalUs != newIntervalUs))
             {
-                int newIntervalInSecond = getTelegrafAgentInterval();
-                if ((newIntervalInSecond != -1) && (configIntervalSecond != newIntervalInSecond))
-                {
-                    configIntervalSecond = newIntervalInSecond;
-                    intervalCountDown = 1;     // reassign to start new interval
-                }
+                configIntervalUs = newIntervalUs;
+                scheduler->setInterval(configIntervalUs);
             }
+        }
+        if ((scheduler->interval() == 0) && (configIntervalUs > 0))
+            scheduler->setInterval(configIntervalUs);
 
-            if (intervalCountDown <= 1) {
-                intervalCountDown = configIntervalSecond;
-                pbnjson::JValue webOSConfigJson = readWebOSJsonConfig();
-                collectWebProcessSize(webOSConfigJson);
-                collectProcessesData(webOSConfigJson);
-            }
-            else {
-                intervalCountDown--;
+        guint64 missed = 0;
+        if (scheduler->wait(1000, &missed) != IntervalScheduler::WaitResult::TICK)
+            continue;
+
+        // a cycle that overran its interval skips the boundaries it missed
+        if (missed > 0)
+        {
+            missedSinceLog += missed;
+            gint64 now = g_get_monotonic_time();
+            if (now - lastMissedLogTime >= 60 * G_USEC_PER_SEC)
+            {
+                IntervalScheduler::Stats stats = scheduler->getStats();
+                SDK_LOG_WARNING(MSGID_SDKAGENT, 0, "Missed %llu collection deadlines (interval %lld us, max drift %lld us)",
+                                (unsigned long long)missedSinceLog, (long long)stats.intervalUs, (long long)stats.maxDriftUs);
+                missedSinceLog = 0;
+                lastMissedLogTime = now;
             }
         }
 
-        g_usleep(G_USEC_PER_SEC);
+        WebOSConfig::Snapshot webOSConfig = WebOSConfig::getInstance()->snapshot();
+        collectWebProcessSize(intervalHandle->collectorLoop, *webOSConfig);
+        collectProcessesData(intervalHandle->collectorLoop, *webOSConfig);
+        collectSystemData(*webOSConfig);
     }
 
     return NULL;
@@ -413,7 +938,21 @@ void ThreadForInterval::intervalHandle_destroy(IntervalHandle *intervalHandle)
 {
     g_return_if_fail(intervalHandle != NULL);
     g_async_queue_push(intervalHandle->queue, GINT_TO_POINTER(INTERVAL_THREAD_MSG_STOP));
+    intervalHandle->scheduler->wakeUp();
     g_thread_join(intervalHandle->thread);
     g_async_queue_unref(intervalHandle->queue);
+    delete intervalHandle->scheduler;
+    collectorLoop_destroy(intervalHandle->collectorLoop);
     g_free(intervalHandle);
 }
+
+ThreadForInterval::SamplingStats ThreadForInterval::getSamplingStats()
+{
+    std::lock_guard<std::mutex> lock(samplingStatsMutex);
+    return samplingStats;
+}
+
+IntervalScheduler::Stats ThreadForInterval::getSchedulerStats()
+{
+    return pIntervalHandle->scheduler->getStats();
+}
@@ -15,84 +15,663 @@
 // SPDX-License-Identifier: Apache-2.0
 
 #include "threadForSocket.h"
+#include "common.h"
+#include "influxHttpSink.h"
+#include "lineProtocol.h"
 #include "logging.h"
+#include "shmSink.h"
+#include "telegrafController.h"
+#include "unixDatagramSocket.h"
+#include "webOSConfig.h"
 
 const static std::string sockPath = "/tmp/telegraf.sock";
+const static std::string spoolPath = "/var/lib/com.webos.service.sdkagent/spool.bin";
 
-ThreadForSocket::ThreadForSocket()
+#define DEFAULT_MAX_DATAGRAM_SIZE 8192
+#define DEFAULT_LINGER_MS 50
+#define DEFAULT_QUEUE_CAPACITY 2048
+#define DEFAULT_MAX_RECORD_SIZE 512
+#define DEFAULT_BLOCK_TIMEOUT_MS 100
+
+#define DEFAULT_SPOOL_SIZE_KB 4096
+#define DEFAULT_REPLAY_RATE 2000
+
+#define STATS_MEASUREMENT "sdkagent_pipeline"
+
+#define DEFAULT_FILE_MAX_SIZE_KB 10240
+#define DEFAULT_FILE_MAX_FILES 3
+#define DEFAULT_SHM_ENTRIES 1024
+
+// TOML values are kept as written: "telegraf" or ["http://127.0.0.1:8086", ...]
+static std::vector<std::string> tomlStrings(const std::string &value)
 {
-    SocketHandle *socketHandle = g_new(SocketHandle, 1);
-    if (socketHandle != NULL)
+    std::vector<std::string> strings;
+    size_t pos = 0;
+    while ((pos = value.find_first_of("\"'", pos)) != std::string::npos)
     {
-        socketHandle->queue = g_async_queue_new();
-        socketHandle->thread = g_thread_new("SocketThread", ThreadForSocket::socketHandle_process, socketHandle);
+        size_t end = value.find(value[pos], pos + 1);
+        if (end == std::string::npos) break;
+        strings.push_back(value.substr(pos + 1, end - pos - 1));
+        pos = end + 1;
     }
-    pSocketHandle = socketHandle;
+    return strings;
 }
 
-ThreadForSocket::~ThreadForSocket()
+ThreadForSocket::ThreadForSocket()
 {
-    socketHandle_destroy(pSocketHandle);
+    reloadSinks();
 }
 
-void ThreadForSocket::sendToMSGQ(std::string &msgData)
+ThreadForSocket::~ThreadForSocket()
 {
-    gint test_data = 0;
-    SocketMsg *msg = g_slice_new(SocketMsg);
-    if (msg != NULL)
+    std::vector<SocketHandle *> stopping;
     {
-        msg->send_string = g_strdup(msgData.c_str());
-        msg->data_int = GINT_TO_POINTER(test_data);
+        std::unique_lock<std::shared_mutex> lock(sinksMutex);
+        stopping.swap(sinks);
     }
-    g_async_queue_push(pSocketHandle->queue, msg);
+    for (SocketHandle *socketHandle : stopping)
+        socketHandle_destroy(socketHandle);
 }
 
-gpointer ThreadForSocket::socketHandle_process(gpointer sData)
+bool ThreadForSocket::sendToMSGQ(const char *data, size_t length)
 {
-    SocketHandle *socketHandle = (SocketHandle *)sData;
-    while (socketHandle != NULL)
+    std::shared_lock<std::shared_mutex> lock(sinksMutex);
+
+    bool queued = false;
+    for (auto &sink : sinks)
+        queued |= sink->ring->push(data, length);
+    return queued;
+}
+
+bool ThreadForSocket::sendBatchToMSGQ(const char *data, size_t length)
+{
+    std::shared_lock<std::shared_mutex> lock(sinksMutex);
+
+    bool queued = false;
+    for (auto &sink : sinks)
+        queued |= (sink->ring->pushLines(data, length) > 0);
+    return queued;
+}
+
+// "webOS.sinks": {
+//     "telegraf": <send to telegraf socket_listener at /tmp/telegraf.sock, default true>,
+//     "unix_sockets": [<additional AF_UNIX datagram socket paths>],
+//     "file_path": <line-protocol file, no file sink when empty>,
+//     "file_max_size_kb": <size at which the file is rotated>,
+//     "file_max_files": <rotated files kept as file_path.1 ... file_path.N>,
+//     "shm": <publish the latest value of each series to shared memory, see shmSamples.h>,
+//     "shm_entries": <number of series the segment can hold>
+// }
+void ThreadForSocket::reloadSinks()
+{
+    pbnjson::JValue sinksConfig = WebOSConfig::getInstance()->section("webOS.sinks");
+
+    std::vector<std::string> wanted;
+    if (!sinksConfig.isObject() || !sinksConfig.hasKey("telegraf") || !sinksConfig["telegraf"].isBoolean() ||
+        sinksConfig["telegraf"].asBool())
+        wanted.push_back("telegraf:" + sockPath);
+
+    if (sinksConfig.isObject() && sinksConfig.hasKey("unix_sockets") && sinksConfig["unix_sockets"].isArray())
+    {
+        pbnjson::JValue paths = sinksConfig["unix_sockets"];
+        for (ssize_t i = 0; i < paths.arraySize(); i++)
+        {
+            if (paths[i].isString() && !paths[i].asString().empty() && (paths[i].asString() != sockPath))
+                wanted.push_back("unix:" + paths[i].asString());
+        }
+    }
+
+    std::string filePath = jsonStringOrDefault(sinksConfig, "file_path", "");
+    gint64 fileMaxSizeKb = CLAMP(jsonNumberOrDefault(sinksConfig, "file_max_size_kb", DEFAULT_FILE_MAX_SIZE_KB), 0, 1024 * 1024);
+    gint64 fileMaxFiles = CLAMP(jsonNumberOrDefault(sinksConfig, "file_max_files", DEFAULT_FILE_MAX_FILES), 0, 100);
+    if (!filePath.empty())
+        wanted.push_back("file:" + std::to_string(fileMaxSizeKb) + ":" + std::to_string(fileMaxFiles) + ":" + filePath);
+
+    bool shmEnabled = sinksConfig.isObject() && sinksConfig.hasKey("shm") && sinksConfig["shm"].isBoolean() && sinksConfig["shm"].asBool();
+    gint64 shmEntries = CLAMP(jsonNumberOrDefault(sinksConfig, "shm_entries", DEFAULT_SHM_ENTRIES), 16, 65536);
+    if (shmEnabled)
+        wanted.push_back("shm:" + std::to_string(shmEntries));
+
+    // "webOS.influxdb" writes to the urls and database of [[outputs.influxdb]]
+    pbnjson::JValue influxConfig = WebOSConfig::getInstance()->section("webOS.influxdb");
+    std::vector<std::string> influxUrls;
+    std::string influxDatabase;
+    if (influxConfig.isObject() && influxConfig.hasKey("enabled") && influxConfig["enabled"].asBool())
+    {
+        TelegrafController::ConfigSnapshot telegrafConfig = TelegrafController::getInstance()->getConfigSnapshot();
+        influxUrls = tomlStrings(TelegrafController::configValue(*telegrafConfig, "outputs.influxdb", "urls"));
+        std::vector<std::string> databases = tomlStrings(TelegrafController::configValue(*telegrafConfig, "outputs.influxdb", "database"));
+        influxDatabase = databases.empty() ? "telegraf" : databases[0];
+
+        if (influxUrls.empty()) {
+            SDK_LOG_WARNING(MSGID_SDKAGENT, 0, "webOS.influxdb is enabled but outputs.influxdb has no urls");
+        }
+        else {
+            std::string key = "influxdb:" + influxDatabase;
+            for (auto &url : influxUrls)
+                key += " " + url;
+            wanted.push_back(key);
+        }
+    }
+
+    std::vector<SocketHandle *> kept;
+    std::vector<SocketHandle *> stopping;
     {
-        SocketMsg *msg = (SocketMsg *)g_async_queue_pop(socketHandle->queue);
-        if (msg)
+        std::unique_lock<std::shared_mutex> lock(sinksMutex);
+
+        for (SocketHandle *socketHandle : sinks)
         {
-            if (msg == GINT_TO_POINTER(-1))
-                break;
-
-            std::string sendData = std::string((gchar *)(((SocketMsg *)msg)->send_string));
-
-            /**
-             * https://docs.influxdata.com/influxdb/v1.8/write_protocols/line_protocol_reference/
-             * https://docs.influxdata.com/influxdb/v1.8/write_protocols/line_protocol_tutorial/
-             * Need to check tag key, field key
-             */
-            int sock = socket(AF_UNIX, SOCK_DGRAM, 0);
-            if (sock < 0)
+            bool stillWanted = false;
+            for (auto &key : wanted)
+                stillWanted |= (key == socketHandle->sinkKey);
+            (stillWanted ? kept : stopping).push_back(socketHandle);
+        }
+
+        for (auto &key : wanted)
+        {
+            bool running = false;
+            for (SocketHandle *socketHandle : kept)
+                running |= (key == socketHandle->sinkKey);
+            if (running) continue;
+
+            SocketHandle *socketHandle = nullptr;
+            if (key.compare(0, 9, "telegraf:") == 0)
             {
-                SDK_LOG_ERROR(MSGID_SDKAGENT, 0, "Error opening datagram socket [%d:%s]\n", errno, strerror(errno));
-                continue;
+                socketHandle = socketHandle_create(key, new UnixSocketSink("telegraf", sockPath), true);
+            }
+            else if (key.compare(0, 5, "unix:") == 0)
+            {
+                socketHandle = socketHandle_create(key, new UnixSocketSink(key, key.substr(5)), false);
             }
+            else if (key.compare(0, 4, "shm:") == 0)
+            {
+                socketHandle = socketHandle_create(key, new ShmSink("shm", SDKAGENT_SHM_NAME, shmEntries), false);
+            }
+            else if (key.compare(0, 9, "influxdb:") == 0)
+            {
+                socketHandle = socketHandle_create(key, new InfluxHttpSink("influxdb", influxUrls, influxDatabase), false);
+            }
+            else
+            {
+                socketHandle = socketHandle_create(key, new FileSink("file:" + filePath, filePath, fileMaxSizeKb * 1024, fileMaxFiles), false);
+            }
+            if (socketHandle)
+            {
+                SDK_LOG_INFO(MSGID_SDKAGENT, 0, "Sink %s started", socketHandle->sink->name().c_str());
+                kept.push_back(socketHandle);
+            }
+        }
+
+        sinks = kept;
+    }
+
+    // running sinks pick up "webOS.socket" changes in their own thread
+    for (SocketHandle *socketHandle : kept)
+    {
+        g_atomic_int_set(&socketHandle->reloadRequested, 1);
+        socketHandle->ring->wakeUp();
+    }
+
+    // joined outside the lock so that producers are not held up. A stopping sink
+    // does not deliver what is still queued, the join only waits for the write in flight.
+    for (SocketHandle *socketHandle : stopping)
+        socketHandle_destroy(socketHandle);
+}
+
+std::vector<ThreadForSocket::SinkStats> ThreadForSocket::getSinkStats()
+{
+    std::vector<SinkStats> result;
+    std::shared_lock<std::shared_mutex> lock(sinksMutex);
+    for (SocketHandle *socketHandle : sinks)
+    {
+        SinkStats stats = collectStats(socketHandle);
+
+        // rates over the time since the previous query, at least one second apart
+        std::lock_guard<std::mutex> statsLock(socketHandle->statsMutex);
+        gint64 now = g_get_monotonic_time();
+        gint64 elapsed = now - socketHandle->rateSampleTime;
+        if (elapsed >= G_USEC_PER_SEC)
+        {
+            socketHandle->recordsPerSec = (double)(stats.writtenRecords - socketHandle->rateSampleRecords) * G_USEC_PER_SEC / elapsed;
+            socketHandle->bytesPerSec = (double)(stats.writtenBytes - socketHandle->rateSampleBytes) * G_USEC_PER_SEC / elapsed;
+            socketHandle->rateSampleTime = now;
+            socketHandle->rateSampleRecords = stats.writtenRecords;
+            socketHandle->rateSampleBytes = stats.writtenBytes;
+        }
+        stats.recordsPerSec = socketHandle->recordsPerSec;
+        stats.bytesPerSec = socketHandle->bytesPerSec;
+        result.push_back(std::move(stats));
+    }
+    return result;
+}
+
+// everything but the rates, which depend on who is asking
+ThreadForSocket::SinkStats ThreadForSocket::collectStats(SocketHandle *socketHandle)
+{
+    SinkStats stats;
+    stats.name = socketHandle->sink->name();
+    stats.queue = socketHandle->ring->getStats();
+    stats.writtenRecords = socketHandle->writtenRecords.load(std::memory_order_relaxed);
+    stats.writtenBytes = socketHandle->writtenBytes.load(std::memory_order_relaxed);
+    stats.droppedRecords = stats.queue.dropped + socketHandle->droppedRecords.load(std::memory_order_relaxed);
+    stats.recordsPerSec = 0;
+    stats.bytesPerSec = 0;
+    stats.latencyAvgUs = stats.writtenRecords ? socketHandle->latencySumUs.load(std::memory_order_relaxed) / stats.writtenRecords : 0;
+    stats.latencyMaxUs = socketHandle->latencyMaxUs.load(std::memory_order_relaxed);
+    stats.latencyBuckets = socketHandle->latency.snapshot();
+    stats.sendErrors = socketHandle->sink->sendErrors().snapshot();
+
+    std::lock_guard<std::mutex> statsLock(socketHandle->statsMutex);
+    stats.spoolOpen = socketHandle->spoolOpen;
+    stats.spool = socketHandle->spoolStats;
+    return stats;
+}
+
+// sdkagent_pipeline,sink=<name> queue_depth=..,written_records=..,latency_p99_us=.. <timestamp>
+void ThreadForSocket::encodeStats(const SinkStats &stats, std::string &out)
+{
+    guint64 sendErrors = 0;
+    for (auto &error : stats.sendErrors)
+        sendErrors += error.second;
+
+    LineProtocolEncoder lp(out);
+    lp.measurement(STATS_MEASUREMENT)
+      .tag("sink", stats.name)
+      .field("queue_depth", (uint64_t)stats.queue.depth)
+      .field("queue_high_water_mark", (uint64_t)stats.queue.highWaterMark)
+      .field("queue_dropped", (uint64_t)stats.queue.dropped)
+      .field("written_records", (uint64_t)stats.writtenRecords)
+      .field("written_bytes", (uint64_t)stats.writtenBytes)
+      .field("dropped_records", (uint64_t)stats.droppedRecords)
+      .field("send_errors", (uint64_t)sendErrors)
+      .field("records_per_sec", stats.recordsPerSec, 1)
+      .field("bytes_per_sec", stats.bytesPerSec, 1)
+      .field("latency_avg_us", (uint64_t)stats.latencyAvgUs)
+      .field("latency_max_us", (uint64_t)stats.latencyMaxUs);
+
+    const char *percentileNames[] = {"latency_p50_us", "latency_p95_us", "latency_p99_us"};
+    const double percentiles[] = {50, 95, 99};
+    for (int i = 0; i < 3; i++)
+    {
+        guint64 bound = LatencyHistogram::percentile(stats.latencyBuckets, percentiles[i]);
+        if (bound != G_MAXUINT64)
+            lp.field(percentileNames[i], (uint64_t)bound);
+    }
+
+    if (stats.spoolOpen)
+        lp.field("spool_pending_records", (uint64_t)stats.spool.pendingRecords);
+
+    lp.timestamp(LineProtocolEncoder::nowNs());
+}
+
+SocketHandle *ThreadForSocket::socketHandle_create(const std::string &sinkKey, MetricSink *sink, bool withSpool)
+{
+    // the ring is preallocated once per sink, its size only changes when the sink is recreated
+    pbnjson::JValue socketConfig = WebOSConfig::getInstance()->section("webOS.socket");
+    gint64 queueCapacity = jsonNumberOrDefault(socketConfig, "queue_capacity", DEFAULT_QUEUE_CAPACITY);
+    gint64 maxRecordSize = jsonNumberOrDefault(socketConfig, "max_record_size", DEFAULT_MAX_RECORD_SIZE);
+
+    SocketHandle *socketHandle = new SocketHandle();
+    socketHandle->ring = new MpscRing(CLAMP(queueCapacity, 16, 65536), CLAMP(maxRecordSize, 128, MAX_DATAGRAM_SIZE_LIMIT));
+    socketHandle->stopRequested = 0;
+    socketHandle->reloadRequested = 0;
+    socketHandle->sink = sink;
+    socketHandle->sinkKey = sinkKey;
+    socketHandle->maxDatagramSize = DEFAULT_MAX_DATAGRAM_SIZE;
+    socketHandle->lingerUs = DEFAULT_LINGER_MS * 1000;
+    socketHandle->statsIntervalUs = 0;
+    socketHandle->droppedSinceDelivery = 0;
+    socketHandle->batchEnqueueTimes.reserve(1024);
+    socketHandle->nextStatsTime = 0;
+    socketHandle->writtenRecords = 0;
+    socketHandle->writtenBytes = 0;
+    socketHandle->droppedRecords = 0;
+    socketHandle->latencySumUs = 0;
+    socketHandle->latencyMaxUs = 0;
+    socketHandle->spool = withSpool ? new DiskSpool() : nullptr;
+    socketHandle->replayRate = DEFAULT_REPLAY_RATE;
+    socketHandle->nextReplayTime = 0;
+    socketHandle->spoolOpen = false;
+    socketHandle->spoolStats = DiskSpool::Stats();
+    socketHandle->rateSampleTime = g_get_monotonic_time();
+    socketHandle->rateSampleRecords = 0;
+    socketHandle->rateSampleBytes = 0;
+    socketHandle->recordsPerSec = 0;
+    socketHandle->bytesPerSec = 0;
+    loadSocketConfig(socketHandle);
+
+    std::string threadName = "Sink-" + sink->name().substr(0, 10);
+    socketHandle->thread = g_thread_new(threadName.c_str(), ThreadForSocket::socketHandle_process, socketHandle);
+    return socketHandle;
+}
+
+// "webOS.socket", applies to every sink: {
+//     "send_buffer_size": <SO_SNDBUF in bytes for socket sinks>,
+//     "max_datagram_size": <bytes packed into one datagram or file write>,
+//     "linger_ms": <how long a partially filled batch may wait>,
+//     "queue_capacity": <records buffered per sink>,
+//     "max_record_size": <bytes preallocated per queued record>,
+//     "overflow_policy": "drop_oldest" | "drop_newest" | "block",
+//     "block_timeout_ms": <how long a producer may wait with "block">,
+//     "stats_interval_sec": <emit an "sdkagent_pipeline" record per sink, 0 to disable>
+// }
+void ThreadForSocket::loadSocketConfig(SocketHandle *socketHandle)
+{
+    pbnjson::JValue socketConfig = WebOSConfig::getInstance()->section("webOS.socket");
+    gint64 maxDatagramSize = jsonNumberOrDefault(socketConfig, "max_datagram_size", DEFAULT_MAX_DATAGRAM_SIZE);
+    gint64 lingerMs = jsonNumberOrDefault(socketConfig, "linger_ms", DEFAULT_LINGER_MS);
+    gint64 blockTimeoutMs = jsonNumberOrDefault(socketConfig, "block_timeout_ms", DEFAULT_BLOCK_TIMEOUT_MS);
+    gint64 statsIntervalSec = jsonNumberOrDefault(socketConfig, "stats_interval_sec", 0);
+
+    MpscRing::OverflowPolicy policy = MpscRing::OverflowPolicy::DROP_OLDEST;
+    std::string policyName = jsonStringOrDefault(socketConfig, "overflow_policy", "drop_oldest");
+    if (!MpscRing::parseOverflowPolicy(policyName, policy)) {
+        SDK_LOG_WARNING(MSGID_SDKAGENT, 0, "Unknown overflow_policy '%s', using drop_oldest", policyName.c_str());
+    }
+    socketHandle->ring->setOverflowPolicy(policy, CLAMP(blockTimeoutMs, 0, 10000) * 1000);
+
+    socketHandle->sink->configure(socketConfig);
+    socketHandle->maxDatagramSize = socketHandle->sink->batchSize((size_t)CLAMP(maxDatagramSize, 256, MAX_DATAGRAM_SIZE_LIMIT));
+    socketHandle->lingerUs = socketHandle->sink->batchLingerUs(CLAMP(lingerMs, 0, 1000) * 1000);
+    socketHandle->statsIntervalUs = CLAMP(statsIntervalSec, 0, 3600) * G_USEC_PER_SEC;
+    socketHandle->nextStatsTime = g_get_monotonic_time() + socketHandle->statsIntervalUs;
+
+    if (socketHandle->spool)
+        loadSpoolConfig(socketHandle);
+}
+
+// "webOS.spool": {
+//     "enabled": <store records on disk while telegraf is unreachable>,
+//     "max_size_kb": <size of the ring file>,
+//     "replay_rate": <records per second sent from the spool once telegraf is back>
+// }
+void ThreadForSocket::loadSpoolConfig(SocketHandle *socketHandle)
+{
+    pbnjson::JValue spoolConfig = WebOSConfig::getInstance()->section("webOS.spool");
+    bool enabled = spoolConfig.isObject() && spoolConfig.hasKey("enabled") && spoolConfig["enabled"].asBool();
+    gint64 maxSizeKb = CLAMP(jsonNumberOrDefault(spoolConfig, "max_size_kb", DEFAULT_SPOOL_SIZE_KB), 64, 256 * 1024);
+    socketHandle->replayRate = CLAMP(jsonNumberOrDefault(spoolConfig, "replay_rate", DEFAULT_REPLAY_RATE), 1, 1000000);
+
+    DiskSpool *spool = socketHandle->spool;
+    if (enabled && (!spool->isOpen() || (spool->getStats().capacity != (guint64)maxSizeKb * 1024)))
+    {
+        if (spool->open(spoolPath, maxSizeKb * 1024)) {
+            SDK_LOG_INFO(MSGID_SDKAGENT, 0, "Spooling to %s (%lld KB) while telegraf is unreachable", spoolPath.c_str(), (long long)maxSizeKb);
+        }
+    }
+    else if (!enabled && spool->isOpen())
+    {
+        spool->close();
+    }
+    publishSpoolStats(socketHandle);
+}
+
+void ThreadForSocket::publishSpoolStats(SocketHandle *socketHandle)
+{
+    std::lock_guard<std::mutex> statsLock(socketHandle->statsMutex);
+    socketHandle->spoolOpen = socketHandle->spool->isOpen();
+    if (socketHandle->spoolOpen)
+        socketHandle->spoolStats = socketHandle->spool->getStats();
+}
+
+// a record larger than maxDatagramSize still goes out alone
+void ThreadForSocket::appendToBatch(SocketHandle *socketHandle, std::string &batch, guint &batchRecords,
+                                    const std::string &record, gint64 enqueueTime)
+{
+    if (!batch.empty() && (batch.length() + record.length() + 1 > socketHandle->maxDatagramSize))
+        flushBatch(socketHandle, batch, batchRecords);
+
+    batch.append(record);
+    batch.push_back('\n');
+    batchRecords++;
+    socketHandle->batchEnqueueTimes.push_back(enqueueTime);
+
+    if (batch.length() >= socketHandle->maxDatagramSize)
+        flushBatch(socketHandle, batch, batchRecords);
+}
+
+// Hand one packed batch to the sink. Congestion and reconnects are handled by
+// the sink; what it cannot deliver is spooled (telegraf only) or dropped.
+void ThreadForSocket::flushBatch(SocketHandle *socketHandle, std::string &batch, guint &batchRecords)
+{
+    MetricSink *sink = socketHandle->sink;
+    if (batch.empty()) return;
+
+    MetricSink::WriteResult result = sink->write(batch.data(), batch.length());
+    if (result == MetricSink::WriteResult::WRITTEN)
+    {
+        gint64 now = g_get_monotonic_time();
+        guint64 latencySum = 0;
+        guint64 latencyMax = 0;
+        for (gint64 enqueueTime : socketHandle->batchEnqueueTimes)
+        {
+            guint64 latency = (guint64)MAX(now - enqueueTime, 0);
+            socketHandle->latency.record(latency);
+            latencySum += latency;
+            latencyMax = MAX(latencyMax, latency);
+        }
+
+        socketHandle->writtenRecords.fetch_add(batchRecords, std::memory_order_relaxed);
+        socketHandle->writtenBytes.fetch_add(batch.length(), std::memory_order_relaxed);
+        socketHandle->latencySumUs.fetch_add(latencySum, std::memory_order_relaxed);
+        if (latencyMax > socketHandle->latencyMaxUs.load(std::memory_order_relaxed))
+            socketHandle->latencyMaxUs.store(latencyMax, std::memory_order_relaxed);
 
-            // if (!fileExists(sockPath.c_str())) {
-            //     executeCommand("touch /tmp/telegraf.sock");
-            // }
+        if (socketHandle->droppedSinceDelivery > 0) {
+            SDK_LOG_INFO(MSGID_SDKAGENT, 0, "Delivery to %s resumed, %llu records were dropped",
+                         sink->name().c_str(), (unsigned long long)socketHandle->droppedSinceDelivery);
+            socketHandle->droppedSinceDelivery = 0;
+        }
+    }
+    // FAILED means the batch itself is rejected, spooling it would not help
+    else if ((result != MetricSink::WriteResult::FAILED) && socketHandle->spool &&
+             socketHandle->spool->append(batch.data(), batch.length(), batchRecords))
+    {
+        publishSpoolStats(socketHandle);
+    }
+    else
+    {
+        if (result == MetricSink::WriteResult::RETRY_LATER) {
+            SDK_LOG_ERROR(MSGID_SDKAGENT, 0, "%s stays congested, dropping %u records", sink->name().c_str(), batchRecords);
+        }
+        else if ((result == MetricSink::WriteResult::UNREACHABLE) && (socketHandle->droppedSinceDelivery == 0)) {
+            SDK_LOG_WARNING(MSGID_SDKAGENT, 0, "%s is unreachable, dropping records until it is back", sink->name().c_str());
+        }
+        socketHandle->droppedSinceDelivery += batchRecords;
+        socketHandle->droppedRecords.fetch_add(batchRecords, std::memory_order_relaxed);
+    }
 
-            struct sockaddr_un sock_name;
-            sock_name.sun_family = AF_UNIX;
-            strncpy(sock_name.sun_path, sockPath.c_str(), sizeof(sock_name.sun_path));
-            sock_name.sun_path[sizeof(sock_name.sun_path) - 1] = '\0';
+    batch.clear();
+    batchRecords = 0;
+    socketHandle->batchEnqueueTimes.clear();
+}
 
-            size_t sock_size = SUN_LEN(&sock_name);
+// Stop requested: the partial batch and whatever is still queued go to the
+// spool in datagram-sized entries when the sink has one, the rest is dropped
+void ThreadForSocket::abandonQueued(SocketHandle *socketHandle, std::string &batch, guint &batchRecords, std::string &record)
+{
+    DiskSpool *spool = socketHandle->spool;
+    guint64 spooled = 0;
+    guint64 dropped = 0;
 
-            SDK_LOG_INFO(MSGID_SDKAGENT, 0, "Prepare to send data to socket");
+    while (true)
+    {
+        bool more = socketHandle->ring->pop(record);
+        if (!batch.empty() && (!more || (batch.length() + record.length() + 1 > socketHandle->maxDatagramSize)))
+        {
+            if (spool && spool->append(batch.data(), batch.length(), batchRecords))
+                spooled += batchRecords;
+            else
+                dropped += batchRecords;
+            batch.clear();
+            batchRecords = 0;
+        }
+        if (!more) break;
+        if (record.empty()) continue;
+
+        batch.append(record);
+        batch.push_back('\n');
+        batchRecords++;
+    }
+    socketHandle->batchEnqueueTimes.clear();
 
-            if (sendto(sock, sendData.c_str(), sendData.length(), 0, (struct sockaddr *)&sock_name, sock_size) < 0)
+    if (spooled > 0)
+        publishSpoolStats(socketHandle);
+    if (dropped > 0)
+        socketHandle->droppedRecords.fetch_add(dropped, std::memory_order_relaxed);
+    if (spooled + dropped > 0)
+    {
+        SDK_LOG_INFO(MSGID_SDKAGENT, 0, "Sink %s stopped with %llu records queued: %llu spooled, %llu dropped",
+                     socketHandle->sink->name().c_str(), (unsigned long long)(spooled + dropped),
+                     (unsigned long long)spooled, (unsigned long long)dropped);
+    }
+}
+
+// Send one spooled datagram if telegraf is reachable, paced to replayRate records per second
+void ThreadForSocket::replaySpool(SocketHandle *socketHandle, std::string &buffer)
+{
+    DiskSpool *spool = socketHandle->spool;
+    MetricSink *sink = socketHandle->sink;
+    gint64 now = g_get_monotonic_time();
+
+    if (!spool || spool->empty() || (now < socketHandle->nextReplayTime))
+        return;
+
+    uint32_t records = 0;
+    if (!sink->ready() || !spool->front(buffer, records))
+    {
+        socketHandle->nextReplayTime = now + G_USEC_PER_SEC;
+        return;
+    }
+
+    switch (sink->write(buffer.data(), buffer.length()))
+    {
+        case MetricSink::WriteResult::WRITTEN:
+            spool->popFront(true);
+            publishSpoolStats(socketHandle);
+            socketHandle->nextReplayTime = now + (gint64)records * G_USEC_PER_SEC / socketHandle->replayRate;
+            if (spool->empty())
             {
-                SDK_LOG_ERROR(MSGID_SDKAGENT, 0, "Error sending datagram message [%d:%s]\n", errno, strerror(errno));
+                DiskSpool::Stats stats = spool->getStats();
+                SDK_LOG_INFO(MSGID_SDKAGENT, 0, "Spool replayed: spooled %llu, replayed %llu, dropped %llu records",
+                             (unsigned long long)stats.spooledRecords, (unsigned long long)stats.replayedRecords,
+                             (unsigned long long)stats.droppedRecords);
             }
-            close(sock);
+            break;
+
+        case MetricSink::WriteResult::FAILED:
+            spool->popFront(false);
+            publishSpoolStats(socketHandle);
+            break;
+
+        default:
+            socketHandle->nextReplayTime = now + G_USEC_PER_SEC / 10;
+            break;
+    }
+}
+
+/**
+ * https://docs.influxdata.com/influxdb/v1.8/write_protocols/line_protocol_reference/
+ * https://docs.influxdata.com/influxdb/v1.8/write_protocols/line_protocol_tutorial/
+ *
+ * telegraf socket_listener accepts newline separated records in a single datagram,
+ * so everything queued is packed into batches of at most maxDatagramSize bytes.
+ * A record is never split; a partially filled batch is flushed after lingerUs.
+ * Each sink runs this loop in its own thread.
+ */
+gpointer ThreadForSocket::socketHandle_process(gpointer sData)
+{
+    SocketHandle *socketHandle = (SocketHandle *)sData;
+    MpscRing *ring = socketHandle->ring;
+
+    std::string record;
+    record.reserve(DEFAULT_MAX_RECORD_SIZE);
+    std::string batch;
+    batch.reserve(MAX_DATAGRAM_SIZE_LIMIT);
+    guint batchRecords = 0;
+    gint64 flushDeadline = 0;
+    gint64 enqueueTime = 0;
 
-            g_slice_free(SocketMsg, msg);
+    std::string replayBuffer;
+
+    // internal measurement, rates are over the interval since the previous one
+    std::string statsRecord;
+    guint64 statsLastRecords = 0;
+    guint64 statsLastBytes = 0;
+    gint64 statsLastTime = g_get_monotonic_time();
+
+    while (true)
+    {
+        // nothing is delivered once stop is requested: a dead or congested destination
+        // would otherwise hold up reloadSinks() on the main loop, and the shutdown
+        if (g_atomic_int_get(&socketHandle->stopRequested))
+        {
+            abandonQueued(socketHandle, batch, batchRecords, record);
+            break;
         }
+
+        if (g_atomic_int_get(&socketHandle->reloadRequested))
+        {
+            g_atomic_int_set(&socketHandle->reloadRequested, 0);
+            flushBatch(socketHandle, batch, batchRecords);
+            loadSocketConfig(socketHandle);
+        }
+
+        replaySpool(socketHandle, replayBuffer);
+
+        if ((socketHandle->statsIntervalUs > 0) && (g_get_monotonic_time() >= socketHandle->nextStatsTime))
+        {
+            gint64 now = g_get_monotonic_time();
+            SinkStats stats = collectStats(socketHandle);
+            stats.recordsPerSec = (double)(stats.writtenRecords - statsLastRecords) * G_USEC_PER_SEC / MAX(now - statsLastTime, 1);
+            stats.bytesPerSec = (double)(stats.writtenBytes - statsLastBytes) * G_USEC_PER_SEC / MAX(now - statsLastTime, 1);
+            statsLastRecords = stats.writtenRecords;
+            statsLastBytes = stats.writtenBytes;
+            statsLastTime = now;
+
+            // goes straight into this sink's batch, not through the queue of every sink
+            statsRecord.clear();
+            encodeStats(stats, statsRecord);
+            appendToBatch(socketHandle, batch, batchRecords, statsRecord, now);
+            if (batchRecords == 1)
+                flushDeadline = now + socketHandle->lingerUs;
+            socketHandle->nextStatsTime = now + socketHandle->statsIntervalUs;
+        }
+
+        if (ring->pop(record, &enqueueTime))
+        {
+            if (record.empty())
+                continue;
+
+            appendToBatch(socketHandle, batch, batchRecords, record, enqueueTime);
+            if (batchRecords == 1)
+                flushDeadline = g_get_monotonic_time() + socketHandle->lingerUs;
+            continue;
+        }
+
+        // nothing queued
+        gint64 now = g_get_monotonic_time();
+        gint64 waitUs = -1;
+        if (!batch.empty())
+        {
+            if (flushDeadline <= now)
+            {
+                flushBatch(socketHandle, batch, batchRecords);
+                continue;
+            }
+            waitUs = flushDeadline - now;
+        }
+        if (socketHandle->spool && !socketHandle->spool->empty())
+        {
+            gint64 replayWait = MAX(socketHandle->nextReplayTime - now, 0);
+            waitUs = (waitUs < 0) ? replayWait : MIN(waitUs, replayWait);
+        }
+        if (socketHandle->statsIntervalUs > 0)
+        {
+            gint64 statsWait = MAX(socketHandle->nextStatsTime - now, 0);
+            waitUs = (waitUs < 0) ? statsWait : MIN(waitUs, statsWait);
+        }
+        ring->waitForData(waitUs);
     }
 
     return NULL;
@@ -101,8 +680,28 @@ gpointer ThreadForSocket::socketHandle_process(gpointer sData)
 void ThreadForSocket::socketHandle_destroy(SocketHandle *socketHandle)
 {
     g_return_if_fail(socketHandle != NULL);
-    g_async_queue_push(socketHandle->queue, GINT_TO_POINTER(-1));
+    g_atomic_int_set(&socketHandle->stopRequested, 1);
+    socketHandle->ring->wakeUp();
+    // cuts a write in flight short, its batch is spooled like a congested one
+    socketHandle->sink->requestStop();
     g_thread_join(socketHandle->thread);
-    g_async_queue_unref(socketHandle->queue);
-    g_free(socketHandle);
-}
\ No newline at end of file
+
+    MpscRing::Stats stats = socketHandle->ring->getStats();
+    SDK_LOG_INFO(MSGID_SDKAGENT, 0, "Sink %s: written %llu, queue dropped %llu (oversized %llu), delivery dropped %llu, high-water mark %zu of %zu",
+                 socketHandle->sink->name().c_str(), (unsigned long long)socketHandle->writtenRecords.load(),
+                 (unsigned long long)stats.dropped, (unsigned long long)stats.oversized,
+                 (unsigned long long)socketHandle->droppedRecords.load(), stats.highWaterMark, stats.capacity);
+
+    if (socketHandle->spool && socketHandle->spool->isOpen())
+    {
+        DiskSpool::Stats spoolStats = socketHandle->spool->getStats();
+        SDK_LOG_INFO(MSGID_SDKAGENT, 0, "Spool: spooled %llu, replayed %llu, dropped %llu, pending %llu records",
+                     (unsigned long long)spoolStats.spooledRecords, (unsigned long long)spoolStats.replayedRecords,
+                     (unsigned long long)spoolStats.droppedRecords, (unsigned long long)spoolStats.pendingRecords);
+    }
+
+    delete socketHandle->ring;
+    delete socketHandle->sink;
+    delete socketHandle->spool;
+    delete socketHandle;
+}
@@ -0,0 +1,111 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+// sdkagent-shm: print the latest samples published by com.webos.service.sdkagent
+//
+//   sdkagent-shm                     print every series once
+//   sdkagent-shm -f processMonitoring -i 200
+//                                    print matching series every 200 ms
+//
+// The agent only publishes when "webOS.sinks": {"shm": true} is set.
+
+#include "shmSamples.h"
+
+#include <getopt.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static void usage(const char *argv0)
+{
+    fprintf(stderr, "Usage: %s [-f <series prefix>] [-i <interval ms>] [-n <count>] [-s <shm name>]\n", argv0);
+}
+
+static void printEntry(const ShmEntryData &data)
+{
+    printf("%s ", data.series);
+    for (uint32_t i = 0; i < data.fieldCount; i++)
+    {
+        const ShmField &field = data.fields[i];
+        printf("%s%s=", (i > 0) ? "," : "", field.name);
+        switch (field.type)
+        {
+            case SHM_FIELD_INT:   printf("%" PRId64 "i", field.intValue); break;
+            case SHM_FIELD_FLOAT: printf("%g", field.floatValue); break;
+            case SHM_FIELD_BOOL:  printf("%s", field.intValue ? "true" : "false"); break;
+            default:              printf("?"); break;
+        }
+    }
+    if (data.timestampNs > 0)
+        printf(" %" PRId64, data.timestampNs);
+    printf("\n");
+}
+
+int main(int argc, char **argv)
+{
+    const char *filter = "";
+    const char *shmName = SDKAGENT_SHM_NAME;
+    long intervalMs = 0;
+    long count = 1;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "f:i:n:s:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'f': filter = optarg; break;
+            case 'i': intervalMs = atol(optarg); count = -1; break;
+            case 'n': count = atol(optarg); break;
+            case 's': shmName = optarg; break;
+            default:
+                usage(argv[0]);
+                return (opt == 'h') ? 0 : 1;
+        }
+    }
+
+    ShmSampleReader reader;
+    if (!reader.open(shmName))
+    {
+        fprintf(stderr, "Cannot open %s, is the shm sink enabled?\n", shmName);
+        return 1;
+    }
+
+    size_t filterLength = strlen(filter);
+    uint64_t lastUpdate = (uint64_t)-1;
+    for (long n = 0; (count < 0) || (n < count); n++)
+    {
+        if (n > 0)
+            usleep(intervalMs * 1000);
+
+        // nothing changed since the last pass
+        uint64_t update = reader.updateCount();
+        if (update == lastUpdate)
+            continue;
+        lastUpdate = update;
+
+        ShmEntryData data;
+        uint32_t entries = reader.count();
+        for (uint32_t i = 0; i < entries; i++)
+        {
+            if (reader.read(i, data) && (strncmp(data.series, filter, filterLength) == 0))
+                printEntry(data);
+        }
+        fflush(stdout);
+    }
+    return 0;
+}
@@ -16,13 +16,11 @@
 
 #include "common.h"
 #include "logging.h"
+#include "webOSConfig.h"
 #include <fstream>
-#include <mutex>
 #include <algorithm>
 #include <cctype>
 
-#define WEBOS_CONFIG_JSON "/var/lib/com.webos.service.sdkagent/config.json"
-
 std::string executeCommand(const std::string& pszCommand, bool linefeedToSpace)
 {
     FILE *fp = popen(pszCommand.c_str(), "r");
@@ -152,6 +150,73 @@ std::string removeAllSpaces(std::string str)
     return str;
 }
 
+bool parseGoDuration(const std::string &str, int64_t &durationNs)
+{
+    static const struct {
+        const char *name;
+        int64_t ns;
+    } units[] = {
+        {"ns", 1LL}, {"us", 1000LL}, {"\u00b5s", 1000LL}, {"\u03bcs", 1000LL}, {"ms", 1000000LL},
+        {"s", 1000000000LL}, {"m", 60 * 1000000000LL}, {"h", 3600 * 1000000000LL}
+    };
+
+    size_t pos = 0;
+    bool negative = false;
+    if ((pos < str.length()) && ((str[pos] == '-') || (str[pos] == '+')))
+        negative = (str[pos++] == '-');
+
+    if (str.compare(pos, std::string::npos, "0") == 0) {
+        durationNs = 0;
+        return true;
+    }
+    if (pos == str.length())
+        return false;
+
+    double total = 0;
+    while (pos < str.length())
+    {
+        // [0-9]*(\.[0-9]*)?
+        size_t numberStart = pos;
+        double value = 0;
+        while ((pos < str.length()) && isdigit((unsigned char)str[pos]))
+            value = value * 10 + (str[pos++] - '0');
+        bool digits = (pos > numberStart);
+        if ((pos < str.length()) && (str[pos] == '.'))
+        {
+            double scale = 0.1;
+            for (pos++; (pos < str.length()) && isdigit((unsigned char)str[pos]); pos++, scale /= 10) {
+                value += (str[pos] - '0') * scale;
+                digits = true;
+            }
+        }
+        if (!digits)
+            return false;
+
+        // the unit runs up to the next number
+        size_t unitStart = pos;
+        while ((pos < str.length()) && !isdigit((unsigned char)str[pos]) && (str[pos] != '.'))
+            pos++;
+        std::string unit = str.substr(unitStart, pos - unitStart);
+
+        int64_t unitNs = 0;
+        for (auto &u : units)
+        {
+            if (unit == u.name) {
+                unitNs = u.ns;
+                break;
+            }
+        }
+        if (unitNs == 0)
+            return false;
+        total += value * unitNs;
+    }
+
+    if (total > 9.2e18)
+        return false;
+    durationNs = negative ? -(int64_t)total : (int64_t)total;
+    return true;
+}
+
 bool fileExists(const char* filePath) {
     std::ifstream fp(filePath);
     bool ret = true;
@@ -205,42 +270,34 @@ pbnjson::JValue stringToJValue(const char* rawData)
     return parser.getDom();
 }
 
+int64_t jsonNumberOrDefault(const pbnjson::JValue &obj, const std::string &key, int64_t defaultValue)
+{
+    if (obj.isObject() && obj.hasKey(key) && obj[key].isNumber()) {
+        return obj[key].asNumber<int64_t>();
+    }
+    return defaultValue;
+}
+
+std::string jsonStringOrDefault(const pbnjson::JValue &obj, const std::string &key, const std::string &defaultValue)
+{
+    if (obj.isObject() && obj.hasKey(key) && obj[key].isString()) {
+        return obj[key].asString();
+    }
+    return defaultValue;
+}
+
 //===================================================================
 // Read/Write webOS json config
 
-std::mutex webOSConfigMutex;
-
+// a modifiable copy, see WebOSConfig::snapshot() for read-only access
 pbnjson::JValue readWebOSJsonConfig()
 {
-    if (!fileExists(WEBOS_CONFIG_JSON)) {
-        return pbnjson::Object();
-    }
-
-    webOSConfigMutex.lock();
-    std::ifstream configFile(WEBOS_CONFIG_JSON);
-    std::string readAllData;
-    std::string readline;
-    if (configFile.good())
-    {
-        while (getline(configFile, readline))
-        {
-            readAllData += readline;
-        }
-    }
-    configFile.close();
-    webOSConfigMutex.unlock();
-    return stringToJValue(readAllData.c_str());
+    return WebOSConfig::getInstance()->snapshot()->duplicate();
 }
 
 void writeWebOSConfigJson(pbnjson::JValue webOSConfigJson)
 {
-    webOSConfigMutex.lock();
-    std::ofstream fileOut;
-    fileOut.open(WEBOS_CONFIG_JSON);
-    const std::string strData = webOSConfigJson.stringify();
-    fileOut.write(strData.c_str(), strData.size());
-    fileOut.close();
-    webOSConfigMutex.unlock();
+    WebOSConfig::getInstance()->write(webOSConfigJson);
 }
 
 // void cReadTextFile(const char * filePath, char *& buffer) {
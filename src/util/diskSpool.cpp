@@ -0,0 +1,222 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "diskSpool.h"
+#include "logging.h"
+
+#include <algorithm>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define SPOOL_MAGIC 0x4c4f5053     // "SPOL"
+#define SPOOL_VERSION 1
+
+DiskSpool::DiskSpool() : fd(-1),
+                         mappedSize(0),
+                         header(nullptr),
+                         dataArea(nullptr),
+                         spooledRecords(0),
+                         replayedRecords(0),
+                         droppedRecords(0)
+{
+}
+
+DiskSpool::~DiskSpool()
+{
+    close();
+}
+
+bool DiskSpool::open(const std::string &path, uint64_t capacity)
+{
+    close();
+
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (fd < 0)
+    {
+        SDK_LOG_ERROR(MSGID_SDKAGENT, 0, "Error opening spool %s [%d:%s]", path.c_str(), errno, strerror(errno));
+        return false;
+    }
+
+    mappedSize = sizeof(SpoolHeader) + capacity;
+
+    struct stat st;
+    bool resetHeader = (fstat(fd, &st) < 0) || ((uint64_t)st.st_size != mappedSize);
+    if (resetHeader && (ftruncate(fd, mappedSize) < 0))
+    {
+        SDK_LOG_ERROR(MSGID_SDKAGENT, 0, "Error resizing spool %s [%d:%s]", path.c_str(), errno, strerror(errno));
+        close();
+        return false;
+    }
+
+    // ftruncate() leaves the file sparse: a store to a page without blocks
+    // behind it raises SIGBUS once the filesystem is full. Also covers a
+    // file left sparse by an earlier run.
+    int error = posix_fallocate(fd, 0, mappedSize);
+    if (error != 0)
+    {
+        SDK_LOG_ERROR(MSGID_SDKAGENT, 0, "Error reserving %llu bytes for spool %s [%d:%s], running without it",
+                      (unsigned long long)mappedSize, path.c_str(), error, strerror(error));
+        // give back what was allocated of a file that held nothing yet
+        if (resetHeader && (ftruncate(fd, 0) < 0))
+            SDK_LOG_WARNING(MSGID_SDKAGENT, 0, "Error truncating spool %s [%d:%s]", path.c_str(), errno, strerror(errno));
+        close();
+        return false;
+    }
+
+    void *addr = mmap(NULL, mappedSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED)
+    {
+        SDK_LOG_ERROR(MSGID_SDKAGENT, 0, "Error mapping spool %s [%d:%s]", path.c_str(), errno, strerror(errno));
+        close();
+        return false;
+    }
+
+    header = (SpoolHeader *)addr;
+    dataArea = (char *)addr + sizeof(SpoolHeader);
+
+    if (resetHeader ||
+        (header->magic != SPOOL_MAGIC) || (header->version != SPOOL_VERSION) ||
+        (header->capacity != capacity) ||
+        (header->tail < header->head) || (header->tail - header->head > capacity))
+    {
+        header->magic = SPOOL_MAGIC;
+        header->version = SPOOL_VERSION;
+        header->capacity = capacity;
+        header->head = 0;
+        header->tail = 0;
+        header->pendingRecords = 0;
+    }
+    else if (header->pendingRecords > 0)
+    {
+        SDK_LOG_INFO(MSGID_SDKAGENT, 0, "Spool %s still holds %llu records from a previous run",
+                     path.c_str(), (unsigned long long)header->pendingRecords);
+    }
+
+    return true;
+}
+
+void DiskSpool::close()
+{
+    if (header)
+    {
+        msync(header, mappedSize, MS_ASYNC);
+        munmap(header, mappedSize);
+        header = nullptr;
+        dataArea = nullptr;
+    }
+    if (fd >= 0)
+    {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+void DiskSpool::readAt(uint64_t offset, void *dst, uint64_t length) const
+{
+    uint64_t pos = offset % header->capacity;
+    uint64_t first = std::min(length, header->capacity - pos);
+    memcpy(dst, dataArea + pos, first);
+    if (first < length)
+        memcpy((char *)dst + first, dataArea, length - first);
+}
+
+void DiskSpool::writeAt(uint64_t offset, const void *src, uint64_t length)
+{
+    uint64_t pos = offset % header->capacity;
+    uint64_t first = std::min(length, header->capacity - pos);
+    memcpy(dataArea + pos, src, first);
+    if (first < length)
+        memcpy(dataArea, (const char *)src + first, length - first);
+}
+
+bool DiskSpool::append(const char *data, uint32_t length, uint32_t records)
+{
+    if (!header) return false;
+
+    uint64_t needed = sizeof(SpoolEntry) + length;
+    if (needed > header->capacity)
+    {
+        droppedRecords += records;
+        return false;
+    }
+
+    while (header->capacity - (header->tail - header->head) < needed)
+        popFront(false);
+
+    SpoolEntry entry = {length, records};
+    writeAt(header->tail, &entry, sizeof(entry));
+    writeAt(header->tail + sizeof(entry), data, length);
+    header->tail += needed;
+    header->pendingRecords += records;
+    spooledRecords += records;
+    return true;
+}
+
+bool DiskSpool::empty() const
+{
+    return !header || (header->head == header->tail);
+}
+
+bool DiskSpool::front(std::string &out, uint32_t &records)
+{
+    if (empty()) return false;
+
+    SpoolEntry entry;
+    readAt(header->head, &entry, sizeof(entry));
+    if (sizeof(entry) + entry.length > header->tail - header->head)
+    {
+        // torn write from an unclean shutdown, nothing after it can be trusted
+        SDK_LOG_WARNING(MSGID_SDKAGENT, 0, "Spool is corrupted, discarding %llu records", (unsigned long long)header->pendingRecords);
+        droppedRecords += header->pendingRecords;
+        header->head = header->tail;
+        header->pendingRecords = 0;
+        return false;
+    }
+    out.resize(entry.length);
+    readAt(header->head + sizeof(entry), &out[0], entry.length);
+    records = entry.records;
+    return true;
+}
+
+void DiskSpool::popFront(bool replayed)
+{
+    if (empty()) return;
+
+    SpoolEntry entry;
+    readAt(header->head, &entry, sizeof(entry));
+    header->head = std::min(header->head + sizeof(entry) + entry.length, header->tail);
+    header->pendingRecords -= std::min<uint64_t>(entry.records, header->pendingRecords);
+    if (replayed)
+        replayedRecords += entry.records;
+    else
+        droppedRecords += entry.records;
+}
+
+DiskSpool::Stats DiskSpool::getStats() const
+{
+    Stats stats;
+    stats.spooledRecords = spooledRecords;
+    stats.replayedRecords = replayedRecords;
+    stats.droppedRecords = droppedRecords;
+    stats.pendingRecords = header ? header->pendingRecords : 0;
+    stats.usedBytes = header ? (header->tail - header->head) : 0;
+    stats.capacity = header ? header->capacity : 0;
+    return stats;
+}
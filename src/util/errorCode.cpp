@@ -43,6 +43,10 @@ const char* getErrorMessage(SDKError ec) {
     case SDKError::DEVMODE_DISABLE:
         return "{\"returnValue\":false,\"errorCode\":6,\"errorText\":\"The developer mode must be activated in order to monitor performance.\"}";
         break;
+
+    case SDKError::CAPTURE_IN_PROGRESS:
+        return "{\"returnValue\":false,\"errorCode\":7,\"errorText\":\"A burst capture is already running.\"}";
+        break;
     
     default:
         return "{\"returnValue\":true,\"errorCode\":0,\"errorText\":\"Success.\"}";
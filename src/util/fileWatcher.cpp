@@ -0,0 +1,157 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "fileWatcher.h"
+#include "logging.h"
+
+#include <algorithm>
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+
+// retry interval while a directory does not exist
+#define WATCH_RETRY_MS 5000
+
+#define WATCH_EVENTS (IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE | IN_DELETE_SELF | IN_MOVE_SELF)
+
+FileWatcher::FileWatcher(const char *name, const std::vector<std::string> &dirs, Callback callback) : dirs(dirs),
+                                                                                                      watchFds(dirs.size(), -1),
+                                                                                                      callback(callback),
+                                                                                                      inotifyFd(-1),
+                                                                                                      stopFd(-1),
+                                                                                                      thread(NULL)
+{
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    stopFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if ((inotifyFd < 0) || (stopFd < 0))
+    {
+        SDK_LOG_ERROR(MSGID_SDKAGENT, 0, "%s: inotify [%d:%s]", name, errno, strerror(errno));
+        return;
+    }
+
+    std::set<std::string> ignored;
+    addWatches(ignored);
+    thread = g_thread_new(name, FileWatcher::watch_process, this);
+}
+
+FileWatcher::~FileWatcher()
+{
+    if (thread)
+    {
+        eventfd_write(stopFd, 1);
+        g_thread_join(thread);
+    }
+    if (inotifyFd >= 0) close(inotifyFd);
+    if (stopFd >= 0) close(stopFd);
+}
+
+// returns true when every directory is watched
+bool FileWatcher::addWatches(std::set<std::string> &changedPaths)
+{
+    bool complete = true;
+    for (size_t i = 0; i < dirs.size(); i++)
+    {
+        if (watchFds[i] >= 0) continue;
+
+        watchFds[i] = inotify_add_watch(inotifyFd, dirs[i].c_str(), WATCH_EVENTS);
+        if (watchFds[i] >= 0)
+            changedPaths.insert(dirs[i]);
+        else
+            complete = false;
+    }
+    return complete;
+}
+
+void FileWatcher::readEvents(std::set<std::string> &changedPaths)
+{
+    char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    ssize_t len;
+    while ((len = read(inotifyFd, buffer, sizeof(buffer))) > 0)
+    {
+        for (char *ptr = buffer; ptr < buffer + len;)
+        {
+            struct inotify_event *event = (struct inotify_event *)ptr;
+            ptr += sizeof(struct inotify_event) + event->len;
+
+            for (size_t i = 0; i < dirs.size(); i++)
+            {
+                if (watchFds[i] != event->wd) continue;
+
+                if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED))
+                {
+                    // the directory is gone, wait for it to come back
+                    inotify_rm_watch(inotifyFd, watchFds[i]);
+                    watchFds[i] = -1;
+                    changedPaths.insert(dirs[i]);
+                }
+                else if (event->len > 0)
+                {
+                    std::string path = dirs[i];
+                    if (path.back() != '/') path += '/';
+                    changedPaths.insert(path + event->name);
+                }
+                break;
+            }
+        }
+    }
+}
+
+gpointer FileWatcher::watch_process(gpointer data)
+{
+    FileWatcher *self = (FileWatcher *)data;
+    std::set<std::string> changedPaths;
+    bool complete = (std::find(self->watchFds.begin(), self->watchFds.end(), -1) == self->watchFds.end());
+
+    while (true)
+    {
+        int timeoutMs = -1;
+        if (!changedPaths.empty())
+            timeoutMs = DEBOUNCE_MS;
+        else if (!complete)
+            timeoutMs = WATCH_RETRY_MS;
+
+        struct pollfd fds[2] = {{self->inotifyFd, POLLIN, 0}, {self->stopFd, POLLIN, 0}};
+        int ret = poll(fds, 2, timeoutMs);
+        if (ret < 0)
+        {
+            if (errno == EINTR) continue;
+            SDK_LOG_ERROR(MSGID_SDKAGENT, 0, "%s: poll [%d:%s]", __FUNCTION__, errno, strerror(errno));
+            break;
+        }
+        if (fds[1].revents & POLLIN)
+            break;
+
+        if (fds[0].revents & POLLIN)
+        {
+            self->readEvents(changedPaths);
+            complete = self->addWatches(changedPaths);
+            continue;
+        }
+
+        // quiet for DEBOUNCE_MS, or time to retry the missing directories
+        complete = self->addWatches(changedPaths);
+        if (!changedPaths.empty())
+        {
+            self->callback(changedPaths);
+            changedPaths.clear();
+        }
+    }
+
+    return NULL;
+}
@@ -0,0 +1,179 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "intervalScheduler.h"
+#include "logging.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+
+static gint64 realtimeUs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (gint64)ts.tv_sec * G_USEC_PER_SEC + ts.tv_nsec / 1000;
+}
+
+static struct timespec toTimespec(gint64 us)
+{
+    struct timespec ts;
+    ts.tv_sec = us / G_USEC_PER_SEC;
+    ts.tv_nsec = (us % G_USEC_PER_SEC) * 1000;
+    return ts;
+}
+
+IntervalScheduler::IntervalScheduler() : intervalUs(0),
+                                         nextDeadlineUs(0),
+                                         ticks(0),
+                                         missedDeadlines(0),
+                                         lastDriftUs(0),
+                                         maxDriftUs(0),
+                                         driftSumUs(0)
+{
+    timerFd = timerfd_create(CLOCK_REALTIME, TFD_NONBLOCK | TFD_CLOEXEC);
+    eventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if ((timerFd < 0) || (eventFd < 0)) {
+        SDK_LOG_ERROR(MSGID_SDKAGENT, 0, "Error creating interval timer [%d:%s]", errno, strerror(errno));
+    }
+}
+
+IntervalScheduler::~IntervalScheduler()
+{
+    if (timerFd >= 0) close(timerFd);
+    if (eventFd >= 0) close(eventFd);
+}
+
+bool IntervalScheduler::setInterval(gint64 newIntervalUs)
+{
+    if (newIntervalUs > 0)
+        newIntervalUs = MAX(newIntervalUs, MIN_INTERVAL_US);
+
+    intervalUs = newIntervalUs;
+    return arm();
+}
+
+bool IntervalScheduler::arm()
+{
+    if (timerFd < 0) return false;
+
+    struct itimerspec spec;
+    memset(&spec, 0, sizeof(spec));
+    if (intervalUs > 0)
+    {
+        // the next multiple of the interval, counted from the epoch
+        gint64 now = realtimeUs();
+        nextDeadlineUs = (now / intervalUs + 1) * intervalUs;
+        spec.it_value = toTimespec(nextDeadlineUs);
+        spec.it_interval = toTimespec(intervalUs);
+    }
+
+    // TFD_TIMER_CANCEL_ON_SET: a clock change fails the read with ECANCELED so we can re-align
+    if (timerfd_settime(timerFd, TFD_TIMER_ABSTIME | TFD_TIMER_CANCEL_ON_SET, &spec, NULL) < 0)
+    {
+        SDK_LOG_ERROR(MSGID_SDKAGENT, 0, "Error arming interval timer [%d:%s]", errno, strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+IntervalScheduler::WaitResult IntervalScheduler::wait(int idleTimeoutMs, guint64 *missed)
+{
+    if (!isValid()) return WaitResult::ERROR;
+
+    struct pollfd pfds[2] = {
+        {timerFd, POLLIN, 0},
+        {eventFd, POLLIN, 0}
+    };
+
+    while (true)
+    {
+        int ret = poll(pfds, 2, (intervalUs > 0) ? -1 : idleTimeoutMs);
+        if (ret < 0)
+        {
+            if (errno == EINTR) continue;
+            return WaitResult::ERROR;
+        }
+        if (ret == 0)
+            return WaitResult::TIMEOUT;
+
+        if (pfds[1].revents & POLLIN)
+        {
+            uint64_t value;
+            if (read(eventFd, &value, sizeof(value)) < 0) {
+                // another wakeUp() raced with us, nothing to do
+            }
+            return WaitResult::WOKEN;
+        }
+
+        if (pfds[0].revents & POLLIN)
+        {
+            uint64_t expirations = 0;
+            if (read(timerFd, &expirations, sizeof(expirations)) < 0)
+            {
+                if (errno == ECANCELED)
+                {
+                    SDK_LOG_INFO(MSGID_SDKAGENT, 0, "System clock changed, re-aligning the collection interval");
+                    arm();
+                }
+                // EAGAIN: the timer was re-armed in between
+                continue;
+            }
+            if (expirations == 0)
+                continue;
+
+            // the boundary this tick belongs to is the last one that expired
+            nextDeadlineUs += (gint64)(expirations - 1) * intervalUs;
+            gint64 drift = MAX(realtimeUs() - nextDeadlineUs, 0);
+            nextDeadlineUs += intervalUs;
+
+            ticks.fetch_add(1, std::memory_order_relaxed);
+            missedDeadlines.fetch_add(expirations - 1, std::memory_order_relaxed);
+            lastDriftUs.store(drift, std::memory_order_relaxed);
+            driftSumUs.fetch_add(drift, std::memory_order_relaxed);
+            if (drift > maxDriftUs.load(std::memory_order_relaxed))
+                maxDriftUs.store(drift, std::memory_order_relaxed);
+
+            if (missed) *missed = expirations - 1;
+            return WaitResult::TICK;
+        }
+    }
+}
+
+void IntervalScheduler::wakeUp()
+{
+    uint64_t one = 1;
+    if (write(eventFd, &one, sizeof(one)) < 0) {
+        // the counter is already non-zero, the waiter will wake up anyway
+    }
+}
+
+IntervalScheduler::Stats IntervalScheduler::getStats() const
+{
+    Stats stats;
+    stats.ticks = ticks.load(std::memory_order_relaxed);
+    stats.missedDeadlines = missedDeadlines.load(std::memory_order_relaxed);
+    stats.lastDriftUs = lastDriftUs.load(std::memory_order_relaxed);
+    stats.maxDriftUs = maxDriftUs.load(std::memory_order_relaxed);
+    stats.avgDriftUs = stats.ticks ? driftSumUs.load(std::memory_order_relaxed) / (gint64)stats.ticks : 0;
+    stats.intervalUs = intervalUs;
+    return stats;
+}
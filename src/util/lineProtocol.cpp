@@ -0,0 +1,215 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "lineProtocol.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+// characters that must be escaped, per element
+static const char *MEASUREMENT_SPECIALS = ", ";
+static const char *KEY_VALUE_SPECIALS = ",= ";
+
+static const uint64_t POW10[] = {
+    1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL, 1000000000ULL
+};
+#define MAX_PRECISION 9
+
+int64_t LineProtocolEncoder::nowNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+void LineProtocolEncoder::appendUInt(std::string &out, uint64_t value)
+{
+    char digits[20];
+    int pos = sizeof(digits);
+    do {
+        digits[--pos] = (char)('0' + (value % 10));
+        value /= 10;
+    } while (value != 0);
+    out.append(digits + pos, sizeof(digits) - pos);
+}
+
+void LineProtocolEncoder::appendInt(std::string &out, int64_t value)
+{
+    if (value < 0) {
+        out.push_back('-');
+        appendUInt(out, (uint64_t)0 - (uint64_t)value);
+    }
+    else {
+        appendUInt(out, (uint64_t)value);
+    }
+}
+
+void LineProtocolEncoder::appendFixed(std::string &out, double value, int precision)
+{
+    if (precision < 0) precision = 0;
+    if (precision > MAX_PRECISION) precision = MAX_PRECISION;
+
+    double scaled = fabs(value) * (double)POW10[precision] + 0.5;
+    if (scaled >= 9.0e18)
+    {
+        // out of the integer fast path, still no heap allocation
+        char buf[64];
+        int n = snprintf(buf, sizeof(buf), "%.*f", precision, value);
+        if (n > 0) out.append(buf, (size_t)n < sizeof(buf) ? (size_t)n : sizeof(buf) - 1);
+        return;
+    }
+
+    uint64_t rounded = (uint64_t)scaled;
+    if ((value < 0) && (rounded != 0))
+        out.push_back('-');
+
+    appendUInt(out, rounded / POW10[precision]);
+    if (precision > 0)
+    {
+        char digits[MAX_PRECISION];
+        uint64_t fraction = rounded % POW10[precision];
+        for (int i = precision - 1; i >= 0; i--)
+        {
+            digits[i] = (char)('0' + (fraction % 10));
+            fraction /= 10;
+        }
+        out.push_back('.');
+        out.append(digits, precision);
+    }
+}
+
+void LineProtocolEncoder::appendEscaped(const char *str, size_t length, const char *specials)
+{
+    for (size_t i = 0; i < length; i++)
+    {
+        char c = str[i];
+        if ((c == '\n') || (c == '\r') || (c == '\t'))
+        {
+            // not representable in line protocol
+            c = ' ';
+        }
+        if ((c != '\0') && (strchr(specials, c) != NULL))
+            out.push_back('\\');
+        out.push_back(c);
+    }
+}
+
+LineProtocolEncoder &LineProtocolEncoder::measurement(const char *name)
+{
+    if (!out.empty() && (out.back() != '\n'))
+        out.push_back('\n');
+    appendEscaped(name, strlen(name), MEASUREMENT_SPECIALS);
+    state = State::TAGS;
+    return *this;
+}
+
+LineProtocolEncoder &LineProtocolEncoder::tag(const char *key, const char *value, size_t valueLength)
+{
+    if ((state != State::TAGS) || (valueLength == 0))
+        return *this;
+
+    out.push_back(',');
+    appendEscaped(key, strlen(key), KEY_VALUE_SPECIALS);
+    out.push_back('=');
+    appendEscaped(value, valueLength, KEY_VALUE_SPECIALS);
+    return *this;
+}
+
+LineProtocolEncoder &LineProtocolEncoder::tag(const char *key, const char *value)
+{
+    return tag(key, value, value ? strlen(value) : 0);
+}
+
+LineProtocolEncoder &LineProtocolEncoder::tag(const char *key, int64_t value)
+{
+    if (state != State::TAGS)
+        return *this;
+
+    out.push_back(',');
+    appendEscaped(key, strlen(key), KEY_VALUE_SPECIALS);
+    out.push_back('=');
+    appendInt(out, value);
+    return *this;
+}
+
+void LineProtocolEncoder::beginField(const char *key)
+{
+    out.push_back((state == State::FIELDS) ? ',' : ' ');
+    appendEscaped(key, strlen(key), KEY_VALUE_SPECIALS);
+    out.push_back('=');
+    state = State::FIELDS;
+}
+
+LineProtocolEncoder &LineProtocolEncoder::field(const char *key, int64_t value)
+{
+    if (state == State::IDLE)
+        return *this;
+
+    beginField(key);
+    appendInt(out, value);
+    out.push_back('i');
+    return *this;
+}
+
+LineProtocolEncoder &LineProtocolEncoder::field(const char *key, double value, int precision)
+{
+    // NaN and Inf cannot be written, leave the field out
+    if ((state == State::IDLE) || !isfinite(value))
+        return *this;
+
+    beginField(key);
+    appendFixed(out, value, precision);
+    return *this;
+}
+
+LineProtocolEncoder &LineProtocolEncoder::field(const char *key, bool value)
+{
+    if (state == State::IDLE)
+        return *this;
+
+    beginField(key);
+    out.append(value ? "true" : "false");
+    return *this;
+}
+
+LineProtocolEncoder &LineProtocolEncoder::fieldString(const char *key, const char *value, size_t valueLength)
+{
+    if (state == State::IDLE)
+        return *this;
+
+    beginField(key);
+    out.push_back('"');
+    for (size_t i = 0; i < valueLength; i++)
+    {
+        if ((value[i] == '"') || (value[i] == '\\'))
+            out.push_back('\\');
+        out.push_back(value[i]);
+    }
+    out.push_back('"');
+    return *this;
+}
+
+void LineProtocolEncoder::timestamp(int64_t ns)
+{
+    if ((state == State::FIELDS) && (ns > 0))
+    {
+        out.push_back(' ');
+        appendInt(out, ns);
+    }
+    state = State::IDLE;
+}
@@ -0,0 +1,316 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "mpscRing.h"
+#include <string.h>
+#include <chrono>
+
+static size_t roundUpPowerOfTwo(size_t n)
+{
+    size_t ret = 2;
+    while (ret < n) ret <<= 1;
+    return ret;
+}
+
+MpscRing::MpscRing(size_t capacity, size_t slotSize) : slots(roundUpPowerOfTwo(capacity)),
+                                                       mask(slots.size() - 1),
+                                                       slotSize(slotSize),
+                                                       enqueuePos(0),
+                                                       dequeuePos(0),
+                                                       overflowPolicy((int)OverflowPolicy::DROP_OLDEST),
+                                                       blockTimeoutUs(0),
+                                                       consumerWaiting(false),
+                                                       producersWaiting(0),
+                                                       wakeUpRequested(false),
+                                                       pushedCount(0),
+                                                       poppedCount(0),
+                                                       droppedCount(0),
+                                                       oversizedCount(0),
+                                                       highWaterMark(0)
+{
+    for (size_t i = 0; i < slots.size(); i++)
+    {
+        slots[i].sequence.store(i, std::memory_order_relaxed);
+        slots[i].enqueueTime = 0;
+        slots[i].data.reserve(slotSize);
+    }
+}
+
+bool MpscRing::parseOverflowPolicy(const std::string &name, OverflowPolicy &policy)
+{
+    if (name == "drop_oldest") policy = OverflowPolicy::DROP_OLDEST;
+    else if (name == "drop_newest") policy = OverflowPolicy::DROP_NEWEST;
+    else if (name == "block") policy = OverflowPolicy::BLOCK;
+    else return false;
+    return true;
+}
+
+void MpscRing::setOverflowPolicy(OverflowPolicy policy, gint64 timeoutUs)
+{
+    overflowPolicy.store((int)policy, std::memory_order_relaxed);
+    blockTimeoutUs.store(timeoutUs, std::memory_order_relaxed);
+}
+
+bool MpscRing::push(const char *data, size_t length)
+{
+    return enqueue(length, [data, length](std::string &slotData) {
+        slotData.assign(data, length);
+    });
+}
+
+size_t MpscRing::pushLines(const char *data, size_t length)
+{
+    size_t queued = 0;
+    const char *end = data + length;
+    while (data < end)
+    {
+        const char *lineEnd = (const char *)memchr(data, '\n', end - data);
+        if (lineEnd == NULL) lineEnd = end;
+        size_t lineLength = lineEnd - data;
+        if ((lineLength > 0) && enqueue(lineLength, [data, lineLength](std::string &slotData) {
+                slotData.assign(data, lineLength);
+            }, false))
+            queued++;
+        data = lineEnd + 1;
+    }
+    if (queued > 0)
+        notifyConsumer();
+    return queued;
+}
+
+template <typename Fill>
+bool MpscRing::enqueue(size_t length, Fill fill, bool notify)
+{
+    if (length > slotSize)
+    {
+        oversizedCount.fetch_add(1, std::memory_order_relaxed);
+        droppedCount.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    std::chrono::steady_clock::time_point blockDeadline;
+    bool blockDeadlineSet = false;
+
+    size_t pos = enqueuePos.load(std::memory_order_relaxed);
+    Slot *slot = nullptr;
+    while (true)
+    {
+        slot = &slots[pos & mask];
+        size_t seq = slot->sequence.load(std::memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+
+        if (diff == 0)
+        {
+            if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                break;
+        }
+        else if (diff < 0)
+        {
+            // ring is full
+            switch ((OverflowPolicy)overflowPolicy.load(std::memory_order_relaxed))
+            {
+                case OverflowPolicy::DROP_OLDEST:
+                    if (discardOldest())
+                        droppedCount.fetch_add(1, std::memory_order_relaxed);
+                    break;
+
+                case OverflowPolicy::DROP_NEWEST:
+                    droppedCount.fetch_add(1, std::memory_order_relaxed);
+                    return false;
+
+                case OverflowPolicy::BLOCK:
+                {
+                    // pushLines() has not woken the consumer for its batch yet
+                    notifyConsumer();
+                    if (!blockDeadlineSet)
+                    {
+                        blockDeadline = std::chrono::steady_clock::now() +
+                                        std::chrono::microseconds(blockTimeoutUs.load(std::memory_order_relaxed));
+                        blockDeadlineSet = true;
+                    }
+
+                    std::unique_lock<std::mutex> lock(waitMutex);
+                    producersWaiting.fetch_add(1);
+                    bool timedOut = !notFull.wait_until(lock, blockDeadline, [this] {
+                        size_t enq = enqueuePos.load();
+                        return slots[enq & mask].sequence.load() == enq;
+                    });
+                    producersWaiting.fetch_sub(1);
+                    if (timedOut)
+                    {
+                        droppedCount.fetch_add(1, std::memory_order_relaxed);
+                        return false;
+                    }
+                    break;
+                }
+            }
+            pos = enqueuePos.load(std::memory_order_relaxed);
+        }
+        else
+        {
+            pos = enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+
+    fill(slot->data);
+    slot->enqueueTime = g_get_monotonic_time();
+    slot->sequence.store(pos + 1, std::memory_order_release);
+
+    pushedCount.fetch_add(1, std::memory_order_relaxed);
+    updateHighWaterMark();
+    if (notify)
+        notifyConsumer();
+    return true;
+}
+
+// used by producers with DROP_OLDEST, competes with pop() for the oldest slot
+bool MpscRing::discardOldest()
+{
+    size_t pos = dequeuePos.load(std::memory_order_relaxed);
+    while (true)
+    {
+        Slot &slot = slots[pos & mask];
+        size_t seq = slot.sequence.load(std::memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+
+        if (diff == 0)
+        {
+            if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+                slot.data.clear();
+                slot.sequence.store(pos + mask + 1, std::memory_order_release);
+                return true;
+            }
+        }
+        else if (diff < 0)
+        {
+            // the oldest slot is still being written, let the caller retry
+            return false;
+        }
+        else
+        {
+            pos = dequeuePos.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+bool MpscRing::pop(std::string &out, gint64 *enqueueTime)
+{
+    size_t pos = dequeuePos.load(std::memory_order_relaxed);
+    while (true)
+    {
+        Slot &slot = slots[pos & mask];
+        size_t seq = slot.sequence.load(std::memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+
+        if (diff == 0)
+        {
+            if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+                out.clear();
+                out.swap(slot.data);
+                if (enqueueTime)
+                    *enqueueTime = slot.enqueueTime;
+                slot.sequence.store(pos + mask + 1, std::memory_order_release);
+                poppedCount.fetch_add(1, std::memory_order_relaxed);
+
+                if (producersWaiting.load() > 0)
+                {
+                    std::lock_guard<std::mutex> lock(waitMutex);
+                    notFull.notify_all();
+                }
+                return true;
+            }
+        }
+        else if (diff < 0)
+        {
+            return false;
+        }
+        else
+        {
+            pos = dequeuePos.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+void MpscRing::notifyConsumer()
+{
+    // pairs with the fence in waitForData(): either the consumer sees the new
+    // record before sleeping or we see that it is waiting
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (consumerWaiting.load(std::memory_order_relaxed))
+    {
+        std::lock_guard<std::mutex> lock(waitMutex);
+        notEmpty.notify_one();
+    }
+}
+
+void MpscRing::waitForData(gint64 timeoutUs)
+{
+    std::unique_lock<std::mutex> lock(waitMutex);
+    consumerWaiting.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    auto ready = [this] { return wakeUpRequested || !empty(); };
+    if (timeoutUs < 0)
+        notEmpty.wait(lock, ready);
+    else
+        notEmpty.wait_for(lock, std::chrono::microseconds(timeoutUs), ready);
+
+    consumerWaiting.store(false, std::memory_order_relaxed);
+    wakeUpRequested = false;
+}
+
+void MpscRing::wakeUp()
+{
+    std::lock_guard<std::mutex> lock(waitMutex);
+    wakeUpRequested = true;
+    notEmpty.notify_one();
+}
+
+bool MpscRing::empty() const
+{
+    size_t pos = dequeuePos.load(std::memory_order_relaxed);
+    return slots[pos & mask].sequence.load(std::memory_order_acquire) != pos + 1;
+}
+
+size_t MpscRing::depth() const
+{
+    size_t enq = enqueuePos.load(std::memory_order_relaxed);
+    size_t deq = dequeuePos.load(std::memory_order_relaxed);
+    return (enq > deq) ? (enq - deq) : 0;
+}
+
+void MpscRing::updateHighWaterMark()
+{
+    size_t current = depth();
+    size_t mark = highWaterMark.load(std::memory_order_relaxed);
+    while ((current > mark) && !highWaterMark.compare_exchange_weak(mark, current, std::memory_order_relaxed))
+        ;
+}
+
+MpscRing::Stats MpscRing::getStats() const
+{
+    Stats stats;
+    stats.pushed = pushedCount.load(std::memory_order_relaxed);
+    stats.popped = poppedCount.load(std::memory_order_relaxed);
+    stats.dropped = droppedCount.load(std::memory_order_relaxed);
+    stats.oversized = oversizedCount.load(std::memory_order_relaxed);
+    stats.depth = depth();
+    stats.highWaterMark = highWaterMark.load(std::memory_order_relaxed);
+    stats.capacity = slots.size();
+    return stats;
+}
@@ -0,0 +1,102 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "pipelineStats.h"
+
+const guint64 LatencyHistogram::BUCKET_BOUNDS_US[BUCKET_COUNT - 1] = {
+    100, 250, 500,
+    1000, 2500, 5000,
+    10000, 25000, 50000,
+    100000, 250000, 500000,
+    1000000, 2500000, 5000000
+};
+
+LatencyHistogram::LatencyHistogram()
+{
+    for (int i = 0; i < BUCKET_COUNT; i++)
+        buckets[i].store(0, std::memory_order_relaxed);
+}
+
+void LatencyHistogram::record(guint64 latencyUs)
+{
+    int i = 0;
+    while ((i < BUCKET_COUNT - 1) && (latencyUs > BUCKET_BOUNDS_US[i]))
+        i++;
+    buckets[i].fetch_add(1, std::memory_order_relaxed);
+}
+
+std::vector<guint64> LatencyHistogram::snapshot() const
+{
+    std::vector<guint64> result(BUCKET_COUNT);
+    for (int i = 0; i < BUCKET_COUNT; i++)
+        result[i] = buckets[i].load(std::memory_order_relaxed);
+    return result;
+}
+
+guint64 LatencyHistogram::percentile(const std::vector<guint64> &buckets, double percent)
+{
+    guint64 total = 0;
+    for (guint64 count : buckets)
+        total += count;
+    if (total == 0)
+        return 0;
+
+    // rank of the sample we are looking for, 1 based
+    guint64 rank = (guint64)(percent / 100.0 * (double)total + 0.5);
+    rank = CLAMP(rank, (guint64)1, total);
+
+    guint64 seen = 0;
+    for (size_t i = 0; i < buckets.size(); i++)
+    {
+        seen += buckets[i];
+        if (seen >= rank)
+            return (i < BUCKET_COUNT - 1) ? BUCKET_BOUNDS_US[i] : G_MAXUINT64;
+    }
+    return G_MAXUINT64;
+}
+
+ErrnoCounters::ErrnoCounters()
+{
+    for (int i = 0; i < MAX_ERRNO; i++)
+        counts[i].store(0, std::memory_order_relaxed);
+}
+
+void ErrnoCounters::count(int err)
+{
+    if ((err <= 0) || (err >= MAX_ERRNO))
+        err = 0;
+    counts[err].fetch_add(1, std::memory_order_relaxed);
+}
+
+std::map<int, guint64> ErrnoCounters::snapshot() const
+{
+    std::map<int, guint64> result;
+    for (int i = 0; i < MAX_ERRNO; i++)
+    {
+        guint64 value = counts[i].load(std::memory_order_relaxed);
+        if (value > 0)
+            result[i] = value;
+    }
+    return result;
+}
+
+guint64 ErrnoCounters::total() const
+{
+    guint64 sum = 0;
+    for (int i = 0; i < MAX_ERRNO; i++)
+        sum += counts[i].load(std::memory_order_relaxed);
+    return sum;
+}
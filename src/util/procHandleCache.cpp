@@ -0,0 +1,451 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "procHandleCache.h"
+#include "logging.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#define INITIAL_BUFFER_SIZE 4096
+#define STREAM_CHUNK_SIZE 16384
+
+// the cache takes at most half of RLIMIT_NOFILE, the rest is left to the
+// sockets, the spool and the luna bus
+#define MIN_FD_BUDGET 16
+#define MAX_FD_BUDGET 4096
+
+// fds[] value of a file the process does not have, it is not looked up again
+#define FILE_MISSING -2
+// openFile() result when no descriptor may be kept, the file is read uncached
+#define NOT_CACHED -3
+
+static const char *fileNames[ProcHandleCache::FILE_COUNT] = {"stat", "statm", "smaps_rollup", "smaps", "status", NULL};
+
+// whole files are returned in it, reused by the next read of the same thread
+static thread_local std::vector<char> readBuffer(INITIAL_BUFFER_SIZE);
+
+static size_t fdBudgetFromLimit()
+{
+    struct rlimit limit;
+    if ((getrlimit(RLIMIT_NOFILE, &limit) != 0) || (limit.rlim_cur == RLIM_INFINITY))
+        return MAX_FD_BUDGET;
+    return CLAMP((size_t)limit.rlim_cur / 2, (size_t)MIN_FD_BUDGET, (size_t)MAX_FD_BUDGET);
+}
+
+static void filePath(int pid, int tid, ProcHandleCache::File file, char *path, size_t size)
+{
+    if (file == ProcHandleCache::GPU)
+        snprintf(path, size, "gpu/%d", pid);
+    else if (tid == 0)
+        snprintf(path, size, "%d/%s", pid, fileNames[file]);
+    else
+        snprintf(path, size, "%d/task/%d/%s", pid, tid, fileNames[file]);
+}
+
+// whole file from offset 0, growing buffer until it fits
+static ssize_t preadAll(int fd, std::vector<char> &buffer)
+{
+    ssize_t n;
+    while (true)
+    {
+        n = pread(fd, buffer.data(), buffer.size() - 1, 0);
+        if ((n < 0) || ((size_t)n < buffer.size() - 1)) break;
+        buffer.resize(buffer.size() * 2);
+    }
+    if (n >= 0)
+        buffer[n] = '\0';
+    return n;
+}
+
+static bool listTasks(DIR *taskDir, std::vector<int> &tids)
+{
+    // an exited process lists no task at all
+    rewinddir(taskDir);
+    struct dirent *dirEntry;
+    while ((dirEntry = readdir(taskDir)) != NULL)
+    {
+        const char *name = dirEntry->d_name;
+        if ((name[0] < '1') || (name[0] > '9')) continue;
+
+        char *end = NULL;
+        long tid = strtol(name, &end, 10);
+        if ((*end == '\0') && (tid > 0))
+            tids.push_back((int)tid);
+    }
+    return !tids.empty();
+}
+
+ProcHandleCache::ProcHandleCache() : procFd(-1),
+                                     procDir(NULL),
+                                     cycle(0),
+                                     fdBudget(fdBudgetFromLimit()),
+                                     openFds(0)
+{
+    procFd = open("/proc", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (procFd < 0)
+    {
+        SDK_LOG_ERROR(MSGID_SDKAGENT, 0, "Cannot open /proc [%d:%s]", errno, strerror(errno));
+        return;
+    }
+
+    // the directory stream gets its own descriptor, it owns and closes it
+    int dirFd = fcntl(procFd, F_DUPFD_CLOEXEC, 0);
+    if (dirFd >= 0)
+    {
+        procDir = fdopendir(dirFd);
+        if (procDir == NULL)
+            close(dirFd);
+    }
+}
+
+ProcHandleCache::~ProcHandleCache()
+{
+    while (!entries.empty())
+        dropEntry(entries.begin());
+    if (procDir) closedir(procDir);
+    if (procFd >= 0) close(procFd);
+}
+
+// entriesMutex held
+void ProcHandleCache::dropEntry(EntryMap::iterator it)
+{
+    Entry &entry = it->second;
+    for (int i = 0; i < FILE_COUNT; i++)
+    {
+        if (entry.fds[i] >= 0)
+        {
+            close(entry.fds[i]);
+            openFds--;
+        }
+    }
+    if (entry.taskDir)
+    {
+        closedir(entry.taskDir);
+        openFds--;
+    }
+    lruList.erase(entry.lruPosition);
+    entries.erase(it);
+}
+
+// entriesMutex held. Entries used in this cycle may be in the hands of other
+// workers and are kept, so the count can stay over the budget until the next one.
+void ProcHandleCache::evictLeastRecentlyUsed()
+{
+    while ((openFds >= fdBudget) && !lruList.empty())
+    {
+        auto it = entries.find(lruList.back());
+        if (it->second.lastUsedCycle == cycle) break;
+        dropEntry(it);
+    }
+}
+
+void ProcHandleCache::beginCycle()
+{
+    std::lock_guard<std::mutex> lock(entriesMutex);
+    cycle++;
+    for (auto it = entries.begin(); it != entries.end();)
+    {
+        if (cycle - it->second.lastUsedCycle > EVICT_AFTER_CYCLES)
+        {
+            auto next = std::next(it);
+            dropEntry(it);
+            it = next;
+        }
+        else
+        {
+            ++it;
+        }
+    }
+    // no worker runs now, a budget lowered during the last cycle can be met
+    evictLeastRecentlyUsed();
+}
+
+// entries are nodes of the map, the pointer stays valid while other pids come
+// and go. Nothing is opened here: a pid that does not exist fails on its first file.
+ProcHandleCache::Entry *ProcHandleCache::lookup(int pid)
+{
+    std::lock_guard<std::mutex> lock(entriesMutex);
+    auto it = entries.find(pid);
+    if (it == entries.end())
+    {
+        Entry entry;
+        for (int i = 0; i < FILE_COUNT; i++)
+            entry.fds[i] = -1;
+        entry.taskDir = NULL;
+        lruList.push_front(pid);
+        entry.lruPosition = lruList.begin();
+        it = entries.emplace(pid, entry).first;
+    }
+    else
+    {
+        lruList.splice(lruList.begin(), lruList, it->second.lruPosition);
+    }
+    it->second.lastUsedCycle = cycle;
+    return &it->second;
+}
+
+void ProcHandleCache::evict(int pid)
+{
+    std::lock_guard<std::mutex> lock(entriesMutex);
+    auto it = entries.find(pid);
+    if (it == entries.end()) return;
+    dropEntry(it);
+}
+
+// counts one more descriptor against the budget, false when none is left
+bool ProcHandleCache::reserveFd()
+{
+    std::lock_guard<std::mutex> lock(entriesMutex);
+    evictLeastRecentlyUsed();
+    if (openFds >= fdBudget) return false;
+    openFds++;
+    return true;
+}
+
+void ProcHandleCache::releaseFd()
+{
+    std::lock_guard<std::mutex> lock(entriesMutex);
+    openFds--;
+}
+
+// the agent ran out of descriptors: give half of ours back and keep the budget there
+void ProcHandleCache::shrinkBudget()
+{
+    std::lock_guard<std::mutex> lock(entriesMutex);
+    size_t budget = MAX(openFds / 2, (size_t)MIN_FD_BUDGET);
+    if (budget < fdBudget)
+    {
+        SDK_LOG_WARNING(MSGID_SDKAGENT, 0, "Out of file descriptors, /proc cache budget %zu -> %zu",
+                        fdBudget, budget);
+        fdBudget = budget;
+    }
+    evictLeastRecentlyUsed();
+}
+
+int ProcHandleCache::openFile(int pid, Entry &entry, File file)
+{
+    if (entry.fds[file] != -1)
+        return entry.fds[file];
+    if (!reserveFd())
+        return NOT_CACHED;
+
+    char path[64];
+    filePath(pid, 0, file, path, sizeof(path));
+    int fd = openat(procFd, path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        int error = errno;
+        releaseFd();
+        if ((error == EMFILE) || (error == ENFILE))
+        {
+            shrinkBudget();
+            return NOT_CACHED;
+        }
+        if ((error == ENOENT) && (file == GPU))
+        {
+            entry.fds[file] = FILE_MISSING;
+            return FILE_MISSING;
+        }
+        errno = error;
+        return -1;
+    }
+    entry.fds[file] = fd;
+    return fd;
+}
+
+// open/pread/close, for threads and when the budget leaves no room to keep the descriptor
+const char *ProcHandleCache::readUncached(int pid, int tid, File file, std::vector<char> &buffer, size_t *length)
+{
+    char path[64];
+    filePath(pid, tid, file, path, sizeof(path));
+    int fd = openat(procFd, path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        if ((errno == ENOENT) && (tid == 0) && (file != GPU)) evict(pid);
+        else if ((errno == EMFILE) || (errno == ENFILE)) shrinkBudget();
+        return NULL;
+    }
+    ssize_t n = preadAll(fd, buffer);
+    close(fd);
+    if (n < 0) return NULL;
+    if (length) *length = (size_t)n;
+    return buffer.data();
+}
+
+const char *ProcHandleCache::read(int pid, File file, size_t *length)
+{
+    if ((procFd < 0) || (pid <= 0)) return NULL;
+
+    for (int attempt = 0; attempt < 2; attempt++)
+    {
+        Entry *entry = lookup(pid);
+
+        int fd = openFile(pid, *entry, file);
+        if (fd == FILE_MISSING)
+            return NULL;
+        if (fd == NOT_CACHED)
+            return readUncached(pid, 0, file, readBuffer, length);
+        if (fd < 0)
+        {
+            // the process is gone
+            if (errno == ENOENT || errno == ESRCH) evict(pid);
+            return NULL;
+        }
+
+        ssize_t n = preadAll(fd, readBuffer);
+        if (n >= 0)
+        {
+            if (length) *length = (size_t)n;
+            return readBuffer.data();
+        }
+
+        // the descriptors still point to the exited process, even if the pid was reused
+        if (errno != ESRCH)
+            return NULL;
+        evict(pid);
+    }
+    return NULL;
+}
+
+const char *ProcHandleCache::readTask(int pid, int tid, File file, size_t *length)
+{
+    if ((procFd < 0) || (pid <= 0) || (tid <= 0) || (file == GPU)) return NULL;
+    return readUncached(pid, tid, file, readBuffer, length);
+}
+
+bool ProcHandleCache::readStream(int pid, File file, const Consumer &consumer)
+{
+    thread_local std::vector<char> chunk(STREAM_CHUNK_SIZE);
+    if ((procFd < 0) || (pid <= 0)) return false;
+
+    for (int attempt = 0; attempt < 2; attempt++)
+    {
+        Entry *entry = lookup(pid);
+
+        bool cached = true;
+        int fd = openFile(pid, *entry, file);
+        if (fd == FILE_MISSING)
+            return false;
+        if (fd == NOT_CACHED)
+        {
+            char path[64];
+            filePath(pid, 0, file, path, sizeof(path));
+            fd = openat(procFd, path, O_RDONLY | O_CLOEXEC);
+            cached = false;
+        }
+        if (fd < 0)
+        {
+            if (errno == ENOENT || errno == ESRCH) evict(pid);
+            else if (errno == EMFILE || errno == ENFILE) shrinkBudget();
+            return false;
+        }
+
+        off_t offset = 0;
+        ssize_t n;
+        while ((n = pread(fd, chunk.data(), chunk.size(), offset)) > 0)
+        {
+            consumer(chunk.data(), (size_t)n);
+            offset += n;
+        }
+        int error = errno;
+        if (!cached) close(fd);
+        if (n == 0)
+            return true;
+
+        if (error != ESRCH)
+            return false;
+        evict(pid);
+        // retried only while the consumer has seen nothing
+        if (offset > 0)
+            return false;
+    }
+    return false;
+}
+
+bool ProcHandleCache::readTasks(int pid, std::vector<int> &tids)
+{
+    tids.clear();
+    if ((procFd < 0) || (pid <= 0)) return false;
+
+    Entry *entry = lookup(pid);
+    if (entry->taskDir != NULL)
+        return listTasks(entry->taskDir, tids);
+
+    bool cached = reserveFd();
+    char path[32];
+    snprintf(path, sizeof(path), "%d/task", pid);
+    int taskFd = openat(procFd, path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (taskFd < 0)
+    {
+        int error = errno;
+        if (cached) releaseFd();
+        if (error == ENOENT || error == ESRCH) evict(pid);
+        else if (error == EMFILE || error == ENFILE) shrinkBudget();
+        return false;
+    }
+    DIR *taskDir = fdopendir(taskFd);
+    if (taskDir == NULL)
+    {
+        if (cached) releaseFd();
+        close(taskFd);
+        return false;
+    }
+
+    bool found = listTasks(taskDir, tids);
+    if (cached)
+        entry->taskDir = taskDir;
+    else
+        closedir(taskDir);
+    return found;
+}
+
+// not cached: kernel threads have no exe and the target changes on exec
+bool ProcHandleCache::readExe(int pid, std::string &out)
+{
+    if (procFd < 0) return false;
+
+    char path[32];
+    char target[256];
+    snprintf(path, sizeof(path), "%d/exe", pid);
+    ssize_t n = readlinkat(procFd, path, target, sizeof(target) - 1);
+    if (n <= 0) return false;
+    out.assign(target, n);
+    return true;
+}
+
+void ProcHandleCache::forEachPid(const std::function<void(int pid)> &callback)
+{
+    if (procDir == NULL) return;
+
+    rewinddir(procDir);
+    struct dirent *dirEntry;
+    while ((dirEntry = readdir(procDir)) != NULL)
+    {
+        const char *name = dirEntry->d_name;
+        if ((name[0] < '1') || (name[0] > '9')) continue;
+
+        char *end = NULL;
+        long pid = strtol(name, &end, 10);
+        if ((*end == '\0') && (pid > 0))
+            callback((int)pid);
+    }
+}
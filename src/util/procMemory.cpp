@@ -0,0 +1,132 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "procMemory.h"
+#include <string.h>
+#include <unistd.h>
+
+static const char *skipSpaces(const char *p, const char *end)
+{
+    while ((p < end) && ((*p == ' ') || (*p == '\t'))) p++;
+    return p;
+}
+
+static const char *parseUnsigned(const char *p, const char *end, guint64 &value)
+{
+    p = skipSpaces(p, end);
+    if ((p >= end) || (*p < '0') || (*p > '9'))
+        return NULL;
+
+    value = 0;
+    while ((p < end) && (*p >= '0') && (*p <= '9'))
+        value = value * 10 + (guint64)(*p++ - '0');
+    return p;
+}
+
+bool parseProcStatm(const char *buffer, size_t length, ProcStatm &statm)
+{
+    memset(&statm, 0, sizeof(statm));
+    if ((buffer == NULL) || (length == 0))
+        return false;
+
+    const char *end = buffer + length;
+    guint64 pages[3];
+    const char *p = buffer;
+    for (int i = 0; i < 3; i++)
+    {
+        p = parseUnsigned(p, end, pages[i]);
+        if (p == NULL) return false;
+    }
+
+    static const guint64 pageKb = (guint64)getpagesize() / 1024;
+    statm.sizeKb = pages[0] * pageKb;
+    statm.residentKb = pages[1] * pageKb;
+    statm.sharedKb = pages[2] * pageKb;
+    return true;
+}
+
+void SmapsParser::reset()
+{
+    memset(&totals, 0, sizeof(totals));
+    partial.clear();
+}
+
+void SmapsParser::feed(const char *data, size_t length)
+{
+    const char *end = data + length;
+    while (data < end)
+    {
+        const char *newline = (const char *)memchr(data, '\n', end - data);
+        if (newline == NULL)
+        {
+            partial.append(data, end - data);
+            return;
+        }
+
+        if (partial.empty())
+        {
+            parseLine(data, newline - data);
+        }
+        else
+        {
+            partial.append(data, newline - data);
+            parseLine(partial.data(), partial.length());
+            partial.clear();
+        }
+        data = newline + 1;
+    }
+}
+
+const SmapsTotals &SmapsParser::finish()
+{
+    if (!partial.empty())
+    {
+        parseLine(partial.data(), partial.length());
+        partial.clear();
+    }
+    return totals;
+}
+
+// "Pss:                 123 kB"; mapping headers and VmFlags are ignored
+void SmapsParser::parseLine(const char *line, size_t length)
+{
+    static const struct {
+        const char *key;
+        size_t offset;
+    } keys[] = {
+        {"Rss", offsetof(SmapsTotals, rssKb)},
+        {"Pss", offsetof(SmapsTotals, pssKb)},
+        {"Private_Clean", offsetof(SmapsTotals, privateCleanKb)},
+        {"Private_Dirty", offsetof(SmapsTotals, privateDirtyKb)},
+        {"Swap", offsetof(SmapsTotals, swapKb)},
+        {"SwapPss", offsetof(SmapsTotals, swapPssKb)},
+    };
+
+    const char *colon = (const char *)memchr(line, ':', length);
+    if ((colon == NULL) || (colon == line)) return;
+    size_t keyLength = colon - line;
+
+    for (auto &key : keys)
+    {
+        if ((strlen(key.key) != keyLength) || (memcmp(key.key, line, keyLength) != 0))
+            continue;
+
+        guint64 value = 0;
+        if (parseUnsigned(colon + 1, line + length, value) != NULL)
+            *(guint64 *)((char *)&totals + key.offset) += value;
+        return;
+    }
+}
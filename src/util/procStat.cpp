@@ -0,0 +1,166 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "procStat.h"
+#include <string.h>
+
+// numeric fields after "pid (comm) state", fields 4 to 52 of proc(5)
+#define NUMERIC_FIELD_COUNT 49
+// utime and stime are fields 14 and 15
+#define REQUIRED_FIELD_COUNT 15
+
+// negative values are returned as two's complement
+static const char *parseNumber(const char *p, const char *end, guint64 &value)
+{
+    while ((p < end) && (*p == ' ')) p++;
+
+    bool negative = false;
+    if ((p < end) && (*p == '-'))
+    {
+        negative = true;
+        p++;
+    }
+    if ((p >= end) || (*p < '0') || (*p > '9'))
+        return NULL;
+
+    guint64 result = 0;
+    while ((p < end) && (*p >= '0') && (*p <= '9'))
+        result = result * 10 + (guint64)(*p++ - '0');
+
+    value = negative ? (0 - result) : result;
+    return p;
+}
+
+bool parseProcStat(const char *buffer, size_t length, ProcStat &stat)
+{
+    memset(&stat, 0, sizeof(stat));
+    if ((buffer == NULL) || (length == 0))
+        return false;
+
+    const char *end = buffer + length;
+    const char *commStart = (const char *)memchr(buffer, '(', length);
+    const char *commEnd = (const char *)memrchr(buffer, ')', length);
+    if ((commStart == NULL) || (commEnd == NULL) || (commEnd < commStart))
+        return false;
+
+    guint64 value = 0;
+    if (parseNumber(buffer, commStart, value) == NULL)
+        return false;
+    stat.pid = (int)value;
+
+    size_t commLength = MIN((size_t)(commEnd - commStart - 1), sizeof(stat.comm) - 1);
+    memcpy(stat.comm, commStart + 1, commLength);
+    stat.comm[commLength] = '\0';
+
+    // ") S "
+    const char *p = commEnd + 1;
+    if ((p + 1 >= end) || (p[0] != ' '))
+        return false;
+    stat.state = p[1];
+    p += 2;
+
+    guint64 fields[NUMERIC_FIELD_COUNT] = {0};
+    int count = 0;
+    while (count < NUMERIC_FIELD_COUNT)
+    {
+        const char *next = parseNumber(p, end, fields[count]);
+        // a number running into the end of the buffer may have been cut short
+        if ((next == NULL) || (next >= end) || ((*next != ' ') && (*next != '\n')))
+        {
+            fields[count] = 0;
+            break;
+        }
+        p = next;
+        count++;
+    }
+    stat.fieldCount = 3 + count;
+    if (stat.fieldCount < REQUIRED_FIELD_COUNT)
+        return false;
+
+    const guint64 *f = fields;
+    stat.ppid = (int)*f++;
+    stat.pgrp = (int)*f++;
+    stat.session = (int)*f++;
+    stat.ttyNr = (int)*f++;
+    stat.tpgid = (int)*f++;
+    stat.flags = (guint32)*f++;
+    stat.minflt = *f++;
+    stat.cminflt = *f++;
+    stat.majflt = *f++;
+    stat.cmajflt = *f++;
+    stat.utime = *f++;
+    stat.stime = *f++;
+    stat.cutime = (gint64)*f++;
+    stat.cstime = (gint64)*f++;
+    stat.priority = (gint64)*f++;
+    stat.nice = (gint64)*f++;
+    stat.numThreads = (gint64)*f++;
+    stat.itrealvalue = (gint64)*f++;
+    stat.starttime = *f++;
+    stat.vsize = *f++;
+    stat.rss = (gint64)*f++;
+    stat.rsslim = *f++;
+    stat.startcode = *f++;
+    stat.endcode = *f++;
+    stat.startstack = *f++;
+    stat.kstkesp = *f++;
+    stat.kstkeip = *f++;
+    stat.signal = *f++;
+    stat.blocked = *f++;
+    stat.sigignore = *f++;
+    stat.sigcatch = *f++;
+    stat.wchan = *f++;
+    stat.nswap = *f++;
+    stat.cnswap = *f++;
+    stat.exitSignal = (int)*f++;
+    stat.processor = (int)*f++;
+    stat.rtPriority = (guint32)*f++;
+    stat.policy = (guint32)*f++;
+    stat.delayacctBlkioTicks = *f++;
+    stat.guestTime = *f++;
+    stat.cguestTime = (gint64)*f++;
+    stat.startData = *f++;
+    stat.endData = *f++;
+    stat.startBrk = *f++;
+    stat.argStart = *f++;
+    stat.argEnd = *f++;
+    stat.envStart = *f++;
+    stat.envEnd = *f++;
+    stat.exitCode = (int)*f++;
+    return true;
+}
+
+// the value of "\n<key>" in a status file, keys include the ':'
+static bool statusValue(const char *buffer, size_t length, const char *key, guint64 &value)
+{
+    const char *end = buffer + length;
+    const char *p = (const char *)memmem(buffer, length, key, strlen(key));
+    if (p == NULL) return false;
+
+    p += strlen(key);
+    while ((p < end) && ((*p == ' ') || (*p == '\t'))) p++;
+    return parseNumber(p, end, value) != NULL;
+}
+
+bool parseContextSwitches(const char *buffer, size_t length, guint64 &voluntary, guint64 &involuntary)
+{
+    voluntary = 0;
+    involuntary = 0;
+    if ((buffer == NULL) || (length == 0))
+        return false;
+    return statusValue(buffer, length, "\nvoluntary_ctxt_switches:", voluntary) &&
+           statusValue(buffer, length, "\nnonvoluntary_ctxt_switches:", involuntary);
+}
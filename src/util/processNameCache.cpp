@@ -0,0 +1,74 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "processNameCache.h"
+
+void ProcessNameCache::beginCycle()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    cycle++;
+    for (auto it = entries.begin(); it != entries.end();)
+    {
+        if (cycle - it->second.lastSeenCycle > EVICT_AFTER_CYCLES)
+            it = entries.erase(it);
+        else
+            ++it;
+    }
+}
+
+ProcessNameCache::NamesPtr ProcessNameCache::get(int pid, guint64 starttime, const char *comm, guint64 appGeneration,
+                                                 const Resolver &resolveNames, const Resolver &resolveApp)
+{
+    NamesPtr known;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = entries.find(pid);
+        if ((it != entries.end()) && (it->second.starttime == starttime) && (it->second.names->comm == comm))
+        {
+            it->second.lastSeenCycle = cycle;
+            if (it->second.appGeneration == appGeneration)
+                return it->second.names;
+            known = it->second.names;
+        }
+    }
+
+    // a new process, one that called execve(), or only the app id is out of date
+    std::shared_ptr<Names> names = std::make_shared<Names>();
+    if (known)
+    {
+        names->exe = known->exe;
+        names->comm = known->comm;
+    }
+    else
+    {
+        resolveNames(pid, *names);
+    }
+    resolveApp(pid, *names);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    Entry &entry = entries[pid];
+    entry.starttime = starttime;
+    entry.appGeneration = appGeneration;
+    entry.lastSeenCycle = cycle;
+    entry.names = names;
+    return names;
+}
+
+size_t ProcessNameCache::size()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return entries.size();
+}
@@ -0,0 +1,142 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "processSampleTable.h"
+
+#define INITIAL_CAPACITY 256
+
+ProcessSampleTable::ProcessSampleTable() : slots(INITIAL_CAPACITY),
+                                           mask(INITIAL_CAPACITY - 1),
+                                           count(0),
+                                           generation(1)
+{
+}
+
+size_t ProcessSampleTable::hash(int pid, guint64 starttime)
+{
+    // splitmix64 finalizer
+    guint64 x = ((guint64)(guint32)pid << 32) ^ starttime;
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return (size_t)x;
+}
+
+// index of the entry, or of the empty slot where it would go
+size_t ProcessSampleTable::find(int pid, guint64 starttime) const
+{
+    size_t index = hash(pid, starttime) & mask;
+    while ((slots[index].pid != 0) && ((slots[index].pid != pid) || (slots[index].starttime != starttime)))
+        index = (index + 1) & mask;
+    return index;
+}
+
+// backward-shift deletion keeps the probe sequences intact without tombstones
+void ProcessSampleTable::eraseAt(size_t index)
+{
+    size_t hole = index;
+    size_t next = (hole + 1) & mask;
+    while (slots[next].pid != 0)
+    {
+        size_t home = hash(slots[next].pid, slots[next].starttime) & mask;
+        // move the entry back when the hole lies on its probe path
+        if (((next - home) & mask) >= ((next - hole) & mask))
+        {
+            slots[hole] = slots[next];
+            hole = next;
+        }
+        next = (next + 1) & mask;
+    }
+    slots[hole].pid = 0;
+    count--;
+}
+
+void ProcessSampleTable::grow()
+{
+    std::vector<Slot> old(slots.size() * 2);
+    old.swap(slots);
+    mask = slots.size() - 1;
+    for (auto &slot : old)
+    {
+        if (slot.pid == 0) continue;
+        slots[find(slot.pid, slot.starttime)] = slot;
+    }
+}
+
+void ProcessSampleTable::beginCycle()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    guint32 previous = generation;
+    generation++;
+
+    size_t index = 0;
+    while (index < slots.size())
+    {
+        // eraseAt() may shift the next entry into this slot, check it again
+        if ((slots[index].pid != 0) && (slots[index].generation != previous))
+            eraseAt(index);
+        else
+            index++;
+    }
+}
+
+bool ProcessSampleTable::update(int pid, guint64 starttime, const Sample &sample, Sample *previous)
+{
+    if (pid <= 0) return false;
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // keep the load factor under 1/2
+    if ((count + 1) * 2 > slots.size())
+        grow();
+
+    Slot &slot = slots[find(pid, starttime)];
+    bool known = (slot.pid != 0);
+    if (known)
+    {
+        if (previous) *previous = slot.sample;
+    }
+    else
+    {
+        slot.pid = pid;
+        slot.starttime = starttime;
+        count++;
+    }
+    slot.sample = sample;
+    slot.generation = generation;
+    return known;
+}
+
+bool ProcessSampleTable::take(int pid, guint64 starttime, Sample *previous)
+{
+    if (pid <= 0) return false;
+    std::lock_guard<std::mutex> lock(mutex);
+
+    size_t index = find(pid, starttime);
+    if (slots[index].pid == 0)
+        return false;
+    if (previous) *previous = slots[index].sample;
+    eraseAt(index);
+    return true;
+}
+
+size_t ProcessSampleTable::size()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return count;
+}
@@ -0,0 +1,376 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "processTracker.h"
+#include "procStat.h"
+#include "logging.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <linux/cn_proc.h>
+#include <linux/connector.h>
+#include <linux/netlink.h>
+
+#define RECEIVE_BUFFER_SIZE (1024 * 1024)
+
+// task flags in /proc/<pid>/stat
+#define PF_KTHREAD 0x00200000
+
+ProcessTracker::ProcessTracker() : thread(NULL),
+                                   sock(-1),
+                                   stopFd(-1),
+                                   procFd(-1),
+                                   exitedDropped(0)
+{
+}
+
+ProcessTracker::~ProcessTracker()
+{
+    stop();
+}
+
+bool ProcessTracker::isRunning()
+{
+    std::lock_guard<std::mutex> lock(lifecycleMutex);
+    return (thread != NULL);
+}
+
+bool ProcessTracker::subscribe(bool enable)
+{
+    char request[NLMSG_SPACE(sizeof(struct cn_msg) + sizeof(enum proc_cn_mcast_op))] __attribute__((aligned(NLMSG_ALIGNTO)));
+    memset(request, 0, sizeof(request));
+
+    struct nlmsghdr *header = (struct nlmsghdr *)request;
+    header->nlmsg_len = NLMSG_LENGTH(sizeof(struct cn_msg) + sizeof(enum proc_cn_mcast_op));
+    header->nlmsg_type = NLMSG_DONE;
+
+    struct cn_msg *message = (struct cn_msg *)NLMSG_DATA(header);
+    message->id.idx = CN_IDX_PROC;
+    message->id.val = CN_VAL_PROC;
+    message->len = sizeof(enum proc_cn_mcast_op);
+    enum proc_cn_mcast_op op = enable ? PROC_CN_MCAST_LISTEN : PROC_CN_MCAST_IGNORE;
+    memcpy(message->data, &op, sizeof(op));
+
+    return (send(sock, request, header->nlmsg_len, 0) == (ssize_t)header->nlmsg_len);
+}
+
+bool ProcessTracker::start()
+{
+    std::lock_guard<std::mutex> lock(lifecycleMutex);
+    if (thread) return true;
+
+    sock = socket(PF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, NETLINK_CONNECTOR);
+    if (sock < 0)
+    {
+        SDK_LOG_WARNING(MSGID_SDKAGENT, 0, "Proc connector not available [%d:%s]", errno, strerror(errno));
+        return false;
+    }
+
+    int bufferSize = RECEIVE_BUFFER_SIZE;
+    if (setsockopt(sock, SOL_SOCKET, SO_RCVBUFFORCE, &bufferSize, sizeof(bufferSize)) != 0)
+        setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &bufferSize, sizeof(bufferSize));
+
+    struct sockaddr_nl address;
+    memset(&address, 0, sizeof(address));
+    address.nl_family = AF_NETLINK;
+    address.nl_groups = CN_IDX_PROC;
+    address.nl_pid = 0;
+    if ((bind(sock, (struct sockaddr *)&address, sizeof(address)) != 0) || !subscribe(true))
+    {
+        SDK_LOG_WARNING(MSGID_SDKAGENT, 0, "Cannot subscribe to the proc connector [%d:%s]", errno, strerror(errno));
+        close(sock);
+        sock = -1;
+        return false;
+    }
+
+    stopFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    procFd = open("/proc", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+    // events arriving during the scan are applied after it, they win
+    reconcile();
+    thread = g_thread_new("ProcessTracker", ProcessTracker::tracker_process, this);
+    SDK_LOG_INFO(MSGID_SDKAGENT, 0, "Tracking processes with the proc connector");
+    return true;
+}
+
+void ProcessTracker::stop()
+{
+    std::lock_guard<std::mutex> lock(lifecycleMutex);
+    if (thread == NULL) return;
+
+    eventfd_write(stopFd, 1);
+    g_thread_join(thread);
+    thread = NULL;
+
+    subscribe(false);
+    close(sock);
+    close(stopFd);
+    if (procFd >= 0) close(procFd);
+    sock = stopFd = procFd = -1;
+
+    std::lock_guard<std::mutex> tableLock(tableMutex);
+    live.clear();
+    exited.clear();
+}
+
+bool ProcessTracker::readExe(int procFd, int pid, std::string &exe)
+{
+    char path[32];
+    char target[256];
+    snprintf(path, sizeof(path), "%d/exe", pid);
+    ssize_t n = readlinkat(procFd, path, target, sizeof(target) - 1);
+    if (n <= 0) return false;
+    exe.assign(target, n);
+    return true;
+}
+
+bool ProcessTracker::readComm(int procFd, int pid, std::string &comm)
+{
+    char path[32];
+    char buffer[64];
+    snprintf(path, sizeof(path), "%d/comm", pid);
+    int fd = openat(procFd, path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    ssize_t n = read(fd, buffer, sizeof(buffer));
+    close(fd);
+    if (n <= 0) return false;
+    if (buffer[n - 1] == '\n') n--;
+    comm.assign(buffer, n);
+    return true;
+}
+
+void ProcessTracker::reconcile()
+{
+    if (procFd < 0) return;
+
+    int dirFd = openat(procFd, ".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    DIR *dir = (dirFd >= 0) ? fdopendir(dirFd) : NULL;
+    if (dir == NULL)
+    {
+        if (dirFd >= 0) close(dirFd);
+        return;
+    }
+
+    std::unordered_map<int, Process> scanned;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL)
+    {
+        char *end = NULL;
+        long pid = strtol(entry->d_name, &end, 10);
+        if ((*end != '\0') || (pid <= 0)) continue;
+
+        Process process;
+        process.pid = (int)pid;
+        readExe(procFd, process.pid, process.exe);
+        readComm(procFd, process.pid, process.comm);
+        scanned.emplace(process.pid, std::move(process));
+    }
+    closedir(dir);
+
+    std::lock_guard<std::mutex> lock(tableMutex);
+    live.swap(scanned);
+}
+
+void ProcessTracker::addProcess(int pid, const Process *parent)
+{
+    Process process;
+    process.pid = pid;
+    // a forked child runs the parent's image until it calls exec
+    if (parent)
+    {
+        process.exe = parent->exe;
+        process.comm = parent->comm;
+    }
+    live[pid] = std::move(process);
+}
+
+void ProcessTracker::updateExe(int pid)
+{
+    Process process;
+    process.pid = pid;
+    readExe(procFd, pid, process.exe);
+    readComm(procFd, pid, process.comm);
+
+    std::lock_guard<std::mutex> lock(tableMutex);
+    live[pid] = std::move(process);
+}
+
+void ProcessTracker::removeProcess(int pid)
+{
+    ExitedProcess process;
+    process.pid = pid;
+    process.utime = 0;
+    process.stime = 0;
+    process.starttime = 0;
+    process.exitTimeUs = g_get_monotonic_time();
+    process.lifetimeUs = 0;
+    process.statValid = false;
+
+    // the exit event is sent before the parent reaps the process, stat is usually still there
+    char path[32];
+    char buffer[1024];
+    ProcStat stat;
+    snprintf(path, sizeof(path), "%d/stat", pid);
+    int fd = openat(procFd, path, O_RDONLY | O_CLOEXEC);
+    if (fd >= 0)
+    {
+        ssize_t n = read(fd, buffer, sizeof(buffer) - 1);
+        close(fd);
+        if ((n > 0) && parseProcStat(buffer, n, stat))
+        {
+            process.utime = stat.utime;
+            process.stime = stat.stime;
+            process.starttime = stat.starttime;
+            process.statValid = true;
+
+            // starttime counts from boot, suspend included
+            static const long ticksPerSec = sysconf(_SC_CLK_TCK);
+            struct timespec now;
+            clock_gettime(CLOCK_BOOTTIME, &now);
+            gint64 startUs = (gint64)(stat.starttime * G_USEC_PER_SEC / ticksPerSec);
+            process.lifetimeUs = MAX((gint64)now.tv_sec * G_USEC_PER_SEC + now.tv_nsec / 1000 - startUs, 0);
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(tableMutex);
+    auto it = live.find(pid);
+    if (it == live.end()) return;
+
+    process.exe = std::move(it->second.exe);
+    live.erase(it);
+
+    // a short-lived process may exit before its exec event is handled
+    if (process.exe.empty() && process.statValid && !(stat.flags & PF_KTHREAD))
+        process.exe = stat.comm;
+    if (process.exe.empty()) return;
+
+    if (exited.size() < MAX_EXITED)
+        exited.push_back(std::move(process));
+    else
+        exitedDropped++;
+}
+
+void ProcessTracker::handleMessage(const char *data, size_t length)
+{
+    for (struct nlmsghdr *header = (struct nlmsghdr *)data; NLMSG_OK(header, length); header = NLMSG_NEXT(header, length))
+    {
+        if ((header->nlmsg_type == NLMSG_ERROR) || (header->nlmsg_type == NLMSG_NOOP))
+            continue;
+
+        struct cn_msg *message = (struct cn_msg *)NLMSG_DATA(header);
+        if ((message->id.idx != CN_IDX_PROC) || (message->id.val != CN_VAL_PROC))
+            continue;
+
+        struct proc_event *event = (struct proc_event *)message->data;
+        switch (event->what)
+        {
+            case proc_event::PROC_EVENT_FORK:
+            {
+                // threads share the tgid of their process
+                if (event->event_data.fork.child_pid != event->event_data.fork.child_tgid)
+                    break;
+                std::lock_guard<std::mutex> lock(tableMutex);
+                auto parent = live.find(event->event_data.fork.parent_tgid);
+                addProcess(event->event_data.fork.child_tgid, (parent != live.end()) ? &parent->second : NULL);
+                break;
+            }
+            case proc_event::PROC_EVENT_EXEC:
+                updateExe(event->event_data.exec.process_tgid);
+                break;
+
+            case proc_event::PROC_EVENT_EXIT:
+                if (event->event_data.exit.process_pid == event->event_data.exit.process_tgid)
+                    removeProcess(event->event_data.exit.process_tgid);
+                break;
+
+            default:
+                break;
+        }
+    }
+}
+
+gpointer ProcessTracker::tracker_process(gpointer data)
+{
+    ProcessTracker *self = (ProcessTracker *)data;
+    char buffer[16384] __attribute__((aligned(NLMSG_ALIGNTO)));
+    gint64 nextReconcile = g_get_monotonic_time() + RECONCILE_INTERVAL_SEC * G_USEC_PER_SEC;
+
+    while (true)
+    {
+        gint64 timeoutMs = (nextReconcile - g_get_monotonic_time()) / 1000;
+        struct pollfd fds[2] = {{self->sock, POLLIN, 0}, {self->stopFd, POLLIN, 0}};
+        int ret = poll(fds, 2, (int)MAX(timeoutMs, 0));
+        if ((ret < 0) && (errno != EINTR))
+        {
+            SDK_LOG_ERROR(MSGID_SDKAGENT, 0, "%s: poll [%d:%s]", __FUNCTION__, errno, strerror(errno));
+            break;
+        }
+        if (fds[1].revents & POLLIN)
+            break;
+
+        if (fds[0].revents & POLLIN)
+        {
+            ssize_t n;
+            while ((n = recv(self->sock, buffer, sizeof(buffer), 0)) > 0)
+                self->handleMessage(buffer, (size_t)n);
+
+            // the receive buffer overflowed and events were lost
+            if ((n < 0) && (errno == ENOBUFS))
+            {
+                SDK_LOG_WARNING(MSGID_SDKAGENT, 0, "Proc connector events lost, rescanning /proc");
+                nextReconcile = 0;
+            }
+        }
+
+        if (g_get_monotonic_time() >= nextReconcile)
+        {
+            self->reconcile();
+            nextReconcile = g_get_monotonic_time() + RECONCILE_INTERVAL_SEC * G_USEC_PER_SEC;
+        }
+    }
+
+    return NULL;
+}
+
+void ProcessTracker::getLiveProcesses(std::vector<Process> &out)
+{
+    out.clear();
+    std::lock_guard<std::mutex> lock(tableMutex);
+    out.reserve(live.size());
+    for (auto &it : live)
+        out.push_back(it.second);
+}
+
+void ProcessTracker::takeExited(std::vector<ExitedProcess> &out)
+{
+    out.clear();
+    std::lock_guard<std::mutex> lock(tableMutex);
+    out.swap(exited);
+    if (exitedDropped > 0)
+    {
+        SDK_LOG_WARNING(MSGID_SDKAGENT, 0, "%llu exited processes were not recorded", (unsigned long long)exitedDropped);
+        exitedDropped = 0;
+    }
+}
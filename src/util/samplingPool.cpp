@@ -0,0 +1,132 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "samplingPool.h"
+#include <sched.h>
+#include <string>
+
+SamplingPool::SamplingPool(size_t workers) : workerCount(CLAMP(workers, (size_t)1, MAX_WORKERS)),
+                                             ranges(new Range[workerCount]),
+                                             args(workerCount),
+                                             round(0),
+                                             running(0),
+                                             stopping(false),
+                                             task(NULL)
+{
+    for (size_t i = 0; i < workerCount; i++)
+    {
+        ranges[i].next.store(0);
+        ranges[i].end = 0;
+        args[i].pool = this;
+        args[i].worker = i;
+    }
+
+    for (size_t i = 1; i < workerCount; i++)
+    {
+        std::string name = "Sampling" + std::to_string(i);
+        threads.push_back(g_thread_new(name.c_str(), SamplingPool::worker_process, &args[i]));
+    }
+}
+
+SamplingPool::~SamplingPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    startCondition.notify_all();
+    for (auto thread : threads)
+        g_thread_join(thread);
+}
+
+size_t SamplingPool::availableCpus()
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0)
+        return MAX(CPU_COUNT(&set), 1);
+    return 1;
+}
+
+void SamplingPool::work(size_t worker)
+{
+    // own range first, then steal from the next workers in turn
+    for (size_t n = 0; n < workerCount; n++)
+    {
+        Range &range = ranges[(worker + n) % workerCount];
+        size_t index;
+        while ((index = range.next.fetch_add(1, std::memory_order_relaxed)) < range.end)
+            (*task)(index, worker);
+    }
+}
+
+gpointer SamplingPool::worker_process(gpointer data)
+{
+    WorkerArg *arg = (WorkerArg *)data;
+    SamplingPool *pool = arg->pool;
+    guint64 seenRound = 0;
+
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(pool->mutex);
+            pool->startCondition.wait(lock, [&] { return pool->stopping || (pool->round != seenRound); });
+            if (pool->stopping) break;
+            seenRound = pool->round;
+        }
+
+        pool->work(arg->worker);
+
+        std::lock_guard<std::mutex> lock(pool->mutex);
+        if (--pool->running == 0)
+            pool->doneCondition.notify_one();
+    }
+    return NULL;
+}
+
+void SamplingPool::run(size_t count, const Task &runTask)
+{
+    if (count == 0) return;
+
+    task = &runTask;
+    size_t chunk = count / workerCount;
+    size_t extra = count % workerCount;
+    size_t begin = 0;
+    for (size_t i = 0; i < workerCount; i++)
+    {
+        size_t length = chunk + ((i < extra) ? 1 : 0);
+        ranges[i].next.store(begin, std::memory_order_relaxed);
+        ranges[i].end = begin + length;
+        begin += length;
+    }
+
+    if (workerCount > 1)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        running = workerCount - 1;
+        round++;
+    }
+    startCondition.notify_all();
+
+    work(0);
+
+    if (workerCount > 1)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        doneCondition.wait(lock, [this] { return running == 0; });
+    }
+    task = NULL;
+}
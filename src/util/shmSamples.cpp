@@ -0,0 +1,143 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "shmSamples.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// a reader gives up on an entry after this many torn copies
+#define READ_RETRY_LIMIT 100
+
+size_t shmSegmentSize(uint32_t entryCapacity)
+{
+    return sizeof(ShmSegmentHeader) + (size_t)entryCapacity * sizeof(ShmEntry);
+}
+
+ShmSampleReader::ShmSampleReader() : segment(nullptr), mappedSize(0)
+{
+}
+
+ShmSampleReader::~ShmSampleReader()
+{
+    close();
+}
+
+bool ShmSampleReader::open(const char *name)
+{
+    close();
+
+    int fd = shm_open(name, O_RDONLY | O_CLOEXEC, 0);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if ((fstat(fd, &st) < 0) || ((size_t)st.st_size < sizeof(ShmSegmentHeader)))
+    {
+        ::close(fd);
+        return false;
+    }
+
+    void *addr = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED) return false;
+
+    const ShmSegmentHeader *header = (const ShmSegmentHeader *)addr;
+    if ((header->magic != SDKAGENT_SHM_MAGIC) || (header->version != SDKAGENT_SHM_VERSION) ||
+        (header->entrySize < sizeof(ShmEntry)) || (header->headerSize < sizeof(ShmSegmentHeader)))
+    {
+        munmap(addr, st.st_size);
+        return false;
+    }
+
+    segment = addr;
+    mappedSize = st.st_size;
+    return true;
+}
+
+void ShmSampleReader::close()
+{
+    if (segment)
+    {
+        munmap(segment, mappedSize);
+        segment = nullptr;
+        mappedSize = 0;
+    }
+}
+
+uint32_t ShmSampleReader::count() const
+{
+    if (!segment) return 0;
+
+    const ShmSegmentHeader *header = (const ShmSegmentHeader *)segment;
+    uint32_t entries = header->entryCount.load(std::memory_order_acquire);
+
+    // the writer may have grown the segment after we mapped it
+    size_t mappedEntries = (mappedSize - header->headerSize) / header->entrySize;
+    return (entries < mappedEntries) ? entries : (uint32_t)mappedEntries;
+}
+
+uint64_t ShmSampleReader::updateCount() const
+{
+    return segment ? ((const ShmSegmentHeader *)segment)->updateCount.load(std::memory_order_acquire) : 0;
+}
+
+uint64_t ShmSampleReader::truncatedCount() const
+{
+    return segment ? ((const ShmSegmentHeader *)segment)->truncatedCount.load(std::memory_order_relaxed) : 0;
+}
+
+uint32_t ShmSampleReader::generation() const
+{
+    return segment ? ((const ShmSegmentHeader *)segment)->generation : 0;
+}
+
+bool ShmSampleReader::read(uint32_t index, ShmEntryData &out) const
+{
+    if (index >= count()) return false;
+
+    const ShmEntry *entry = shmEntryAt(segment, index);
+    for (int attempt = 0; attempt < READ_RETRY_LIMIT; attempt++)
+    {
+        uint32_t before = entry->sequence.load(std::memory_order_acquire);
+        if (before & 1) continue;
+
+        memcpy(&out, (const void *)&entry->data, sizeof(out));
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        if (entry->sequence.load(std::memory_order_relaxed) == before)
+        {
+            out.series[SHM_SERIES_SIZE - 1] = '\0';
+            if (out.fieldCount > SHM_MAX_FIELDS) out.fieldCount = SHM_MAX_FIELDS;
+            return true;
+        }
+    }
+    return false;
+}
+
+int ShmSampleReader::find(const char *series) const
+{
+    ShmEntryData data;
+    uint32_t entries = count();
+    for (uint32_t i = 0; i < entries; i++)
+    {
+        if (read(i, data) && (strncmp(data.series, series, SHM_SERIES_SIZE) == 0))
+            return (int)i;
+    }
+    return -1;
+}
@@ -0,0 +1,164 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "unixDatagramSocket.h"
+#include "logging.h"
+
+#include <algorithm>
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define RECONNECT_BACKOFF_MIN_US (100 * 1000)
+#define RECONNECT_BACKOFF_MAX_US (5 * G_USEC_PER_SEC)
+#define SEND_MAX_RETRY 5
+#define SEND_POLL_TIMEOUT_MS 20
+
+UnixDatagramSocket::UnixDatagramSocket(const std::string &path) : sockPath(path),
+                                                                  backoffUs(RECONNECT_BACKOFF_MIN_US)
+{
+}
+
+UnixDatagramSocket::~UnixDatagramSocket()
+{
+    disconnect();
+}
+
+bool UnixDatagramSocket::connectDue() const
+{
+    return (sockFd < 0) && (g_get_monotonic_time() >= nextConnectTime);
+}
+
+bool UnixDatagramSocket::ensureConnected()
+{
+    if (sockFd >= 0) return true;
+    if (!connectDue()) return false;
+
+    if (tryConnect()) {
+        backoffUs = RECONNECT_BACKOFF_MIN_US;
+        nextConnectTime = 0;
+        return true;
+    }
+
+    nextConnectTime = g_get_monotonic_time() + backoffUs;
+    backoffUs = std::min<gint64>(backoffUs * 2, RECONNECT_BACKOFF_MAX_US);
+    return false;
+}
+
+bool UnixDatagramSocket::tryConnect()
+{
+    int fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+    {
+        SDK_LOG_ERROR(MSGID_SDKAGENT, 0, "Error opening datagram socket [%d:%s]", errno, strerror(errno));
+        return false;
+    }
+
+    if ((sendBufferSize > 0) && (setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &sendBufferSize, sizeof(sendBufferSize)) < 0))
+    {
+        SDK_LOG_WARNING(MSGID_SDKAGENT, 0, "Error setting SO_SNDBUF=%d on %s [%d:%s]", sendBufferSize, sockPath.c_str(), errno, strerror(errno));
+    }
+
+    struct sockaddr_un sock_name;
+    memset(&sock_name, 0, sizeof(sock_name));
+    sock_name.sun_family = AF_UNIX;
+    strncpy(sock_name.sun_path, sockPath.c_str(), sizeof(sock_name.sun_path));
+    sock_name.sun_path[sizeof(sock_name.sun_path) - 1] = '\0';
+
+    if (connect(fd, (struct sockaddr *)&sock_name, SUN_LEN(&sock_name)) < 0)
+    {
+        // ENOENT / ECONNREFUSED are expected while telegraf is (re)starting, only log on change
+        if (errno != lastErrno) {
+            SDK_LOG_WARNING(MSGID_SDKAGENT, 0, "Cannot connect to %s [%d:%s], retrying with backoff", sockPath.c_str(), errno, strerror(errno));
+        }
+        lastErrno = errno;
+        close(fd);
+        return false;
+    }
+
+    SDK_LOG_INFO(MSGID_SDKAGENT, 0, "Connected to %s", sockPath.c_str());
+    lastErrno = 0;
+    sockFd = fd;
+    return true;
+}
+
+void UnixDatagramSocket::disconnect()
+{
+    if (sockFd >= 0) {
+        close(sockFd);
+        sockFd = -1;
+    }
+}
+
+UnixDatagramSocket::SendResult UnixDatagramSocket::send(const char *data, size_t length)
+{
+    if (sockFd < 0) return SendResult::DISCONNECTED;
+
+    for (int attempt = 0; ; attempt++)
+    {
+        if (::send(sockFd, data, length, MSG_NOSIGNAL) >= 0) {
+            return SendResult::SENT;
+        }
+
+        switch (errno)
+        {
+            case EINTR:
+                continue;
+
+            case EAGAIN:
+#if EAGAIN != EWOULDBLOCK
+            case EWOULDBLOCK:
+#endif
+            {
+                // receive queue of the peer is full, wait until it drains
+                lastErrno = errno;
+                if (attempt >= SEND_MAX_RETRY) return SendResult::RETRY_LATER;
+                struct pollfd pfd = {sockFd, POLLOUT, 0};
+                poll(&pfd, 1, SEND_POLL_TIMEOUT_MS);
+                continue;
+            }
+
+            case ENOBUFS:
+            case ENOMEM:
+                // no kernel buffer memory right now, poll() does not help here
+                lastErrno = errno;
+                if (attempt >= SEND_MAX_RETRY) return SendResult::RETRY_LATER;
+                g_usleep(1000 << attempt);
+                continue;
+
+            case ECONNREFUSED:
+            case ECONNRESET:
+            case ENOTCONN:
+            case ENOENT:
+            case EPIPE:
+            case EDESTADDRREQ:
+                SDK_LOG_WARNING(MSGID_SDKAGENT, 0, "Lost connection to %s [%d:%s]", sockPath.c_str(), errno, strerror(errno));
+                lastErrno = errno;
+                disconnect();
+                // the peer is usually back already (restart), allow an immediate reconnect
+                nextConnectTime = 0;
+                return SendResult::DISCONNECTED;
+
+            default:
+                SDK_LOG_ERROR(MSGID_SDKAGENT, 0, "Error sending datagram message of %zu bytes [%d:%s]", length, errno, strerror(errno));
+                lastErrno = errno;
+                return SendResult::FAILED;
+        }
+    }
+}
@@ -0,0 +1,148 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "webOSConfig.h"
+#include "common.h"
+#include "logging.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#define WEBOS_CONFIG_DIR "/var/lib/com.webos.service.sdkagent"
+#define WEBOS_CONFIG_JSON WEBOS_CONFIG_DIR "/config.json"
+
+WebOSConfig *WebOSConfig::getInstance()
+{
+    static WebOSConfig instance;
+    return &instance;
+}
+
+WebOSConfig::WebOSConfig() : current(std::make_shared<const pbnjson::JValue>(pbnjson::Object())),
+                             currentGeneration(1),
+                             loaded(false),
+                             watcher(NULL)
+{
+    reload();
+
+    // the directory itself is reported when it appears
+    watcher = new FileWatcher("WebOSConfigWatch", {WEBOS_CONFIG_DIR}, [this](const std::set<std::string> &changedPaths) {
+        if (changedPaths.count(WEBOS_CONFIG_JSON) || changedPaths.count(WEBOS_CONFIG_DIR))
+            reload();
+    });
+}
+
+WebOSConfig::~WebOSConfig()
+{
+    delete watcher;
+}
+WebOSConfig::Snapshot WebOSConfig::snapshot()
+{
+    thread_local Snapshot cached;
+    thread_local guint64 cachedGeneration = 0;
+
+    guint64 generationNow = currentGeneration.load(std::memory_order_acquire);
+    if (generationNow != cachedGeneration)
+    {
+        cached = std::atomic_load(&current);
+        cachedGeneration = generationNow;
+    }
+    return cached;
+}
+
+void WebOSConfig::publish(const pbnjson::JValue &config)
+{
+    // the caller's value may still be modified, keep a private copy
+    std::atomic_store(&current, Snapshot(std::make_shared<const pbnjson::JValue>(config.duplicate())));
+    currentGeneration.fetch_add(1, std::memory_order_release);
+}
+
+void WebOSConfig::reload()
+{
+    {
+        std::lock_guard<std::mutex> lock(updateMutex);
+
+        std::string text;
+        if (fileExists(WEBOS_CONFIG_JSON))
+            text = readTextFile(WEBOS_CONFIG_JSON);
+
+        // our own write() or a touch without changes
+        if (loaded && (text == loadedText))
+            return;
+        loaded = true;
+
+        if (text.empty())
+        {
+            loadedText.clear();
+            publish(pbnjson::Object());
+        }
+        else
+        {
+            pbnjson::JValue config = stringToJValue(text.c_str());
+            if (!config.isObject())
+            {
+                // keep the previous snapshot until the file is valid again
+                SDK_LOG_WARNING(MSGID_SDKAGENT, 0, "Ignoring invalid %s", WEBOS_CONFIG_JSON);
+                return;
+            }
+            loadedText = std::move(text);
+            publish(config);
+        }
+    }
+    notifyListeners();
+}
+
+bool WebOSConfig::write(const pbnjson::JValue &config)
+{
+    {
+        std::lock_guard<std::mutex> lock(updateMutex);
+
+        // write a temporary file and rename it, readers never see a partial file
+        std::string text = config.stringify();
+        std::string tmpPath = std::string(WEBOS_CONFIG_JSON) + ".tmp";
+        writeTextFile(tmpPath.c_str(), text);
+        if (rename(tmpPath.c_str(), WEBOS_CONFIG_JSON) != 0)
+        {
+            SDK_LOG_ERROR(MSGID_SDKAGENT, 0, "Cannot write %s [%d:%s]", WEBOS_CONFIG_JSON, errno, strerror(errno));
+            unlink(tmpPath.c_str());
+            return false;
+        }
+
+        loaded = true;
+        loadedText = std::move(text);
+        publish(config);
+    }
+    notifyListeners();
+    return true;
+}
+
+void WebOSConfig::addListener(std::function<void()> listener)
+{
+    std::lock_guard<std::mutex> lock(listenersMutex);
+    listeners.push_back(std::move(listener));
+}
+
+void WebOSConfig::notifyListeners()
+{
+    std::vector<std::function<void()>> copy;
+    {
+        std::lock_guard<std::mutex> lock(listenersMutex);
+        copy = listeners;
+    }
+    for (auto &listener : copy)
+        listener();
+}
@@ -0,0 +1,475 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "influxHttpSink.h"
+#include "webOSConfig.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+static int failures = 0;
+
+#define CHECK(condition)                                                       \
+    do                                                                         \
+    {                                                                          \
+        if (!(condition))                                                      \
+        {                                                                      \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+            failures++;                                                        \
+        }                                                                      \
+    } while (0)
+
+typedef MetricSink::WriteResult WriteResult;
+
+//===================================================================
+// "webOS.influxdb" without the config file: the sink only reads its section
+
+static pbnjson::JValue influxConfig;
+
+WebOSConfig::WebOSConfig() : currentGeneration(0), loaded(false), watcher(NULL)
+{
+}
+
+WebOSConfig::~WebOSConfig()
+{
+}
+
+WebOSConfig *WebOSConfig::getInstance()
+{
+    static WebOSConfig instance;
+    return &instance;
+}
+
+WebOSConfig::Snapshot WebOSConfig::snapshot()
+{
+    pbnjson::JValue config = pbnjson::Object();
+    config.put("webOS.influxdb", influxConfig);
+    return std::make_shared<const pbnjson::JValue>(config);
+}
+
+bool WebOSConfig::write(const pbnjson::JValue &config)
+{
+    return false;
+}
+
+static void setInfluxConfig(int maxRetries, int retryBackoffMs)
+{
+    influxConfig = pbnjson::Object();
+    influxConfig.put("max_retries", maxRetries);
+    influxConfig.put("retry_backoff_ms", retryBackoffMs);
+    influxConfig.put("timeout_ms", 1000);
+}
+
+//===================================================================
+// InfluxDB stand-in on 127.0.0.1, one connection at a time like the sink
+
+struct Request
+{
+    int connection;         // 1 for the first accepted connection
+    std::string requestLine;
+    std::string headers;
+    std::string body;       // inflated when it was sent gzipped
+    bool gzipped;
+    bool framingOk;         // the gzip stream decoded to its end
+};
+
+class InfluxStandIn
+{
+public:
+    InfluxStandIn() : listenFd(-1), port(0), dropAfterResponse(false), connections(0)
+    {
+        stopPipe[0] = stopPipe[1] = -1;
+        listenFd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t length = sizeof(addr);
+        if ((listenFd < 0) || (bind(listenFd, (struct sockaddr *)&addr, sizeof(addr)) < 0) || (listen(listenFd, 8) < 0) ||
+            (getsockname(listenFd, (struct sockaddr *)&addr, &length) < 0) || (pipe(stopPipe) < 0))
+        {
+            fprintf(stderr, "cannot start the stand-in [%d:%s]\n", errno, strerror(errno));
+            exit(1);
+        }
+        port = ntohs(addr.sin_port);
+        thread = std::thread(&InfluxStandIn::run, this);
+    }
+
+    ~InfluxStandIn()
+    {
+        if (::write(stopPipe[1], "x", 1) < 0)
+            fprintf(stderr, "cannot stop the stand-in [%d:%s]\n", errno, strerror(errno));
+        thread.join();
+        close(listenFd);
+        close(stopPipe[0]);
+        close(stopPipe[1]);
+    }
+
+    std::string url() const { return "http://127.0.0.1:" + std::to_string(port); }
+
+    // statuses of the next responses, 204 once they are used up
+    void answer(std::initializer_list<int> statuses)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pendingStatuses.assign(statuses);
+    }
+
+    // closes the connection after each response without announcing it,
+    // like a server dropping an idle keep-alive connection
+    void setDropAfterResponse(bool drop)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        dropAfterResponse = drop;
+    }
+
+    std::vector<Request> requests()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return received;
+    }
+
+    int connectionCount()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return connections;
+    }
+
+private:
+    // false when the stand-in is stopping
+    bool waitReadable(int fd)
+    {
+        struct pollfd pfds[2] = {{fd, POLLIN, 0}, {stopPipe[0], POLLIN, 0}};
+        while (poll(pfds, 2, -1) < 0)
+        {
+            if (errno != EINTR) return false;
+        }
+        return pfds[1].revents == 0;
+    }
+
+    void run()
+    {
+        while (waitReadable(listenFd))
+        {
+            int fd = accept4(listenFd, NULL, NULL, SOCK_CLOEXEC);
+            if (fd < 0) continue;
+            int connection;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                connection = ++connections;
+            }
+            serve(fd, connection);
+            close(fd);
+        }
+    }
+
+    void serve(int fd, int connection)
+    {
+        std::string buffer;
+        char chunk[4096];
+        while (true)
+        {
+            size_t headerEnd;
+            while ((headerEnd = buffer.find("\r\n\r\n")) == std::string::npos)
+            {
+                if (!waitReadable(fd)) return;
+                ssize_t ret = recv(fd, chunk, sizeof(chunk), 0);
+                if (ret <= 0) return;
+                buffer.append(chunk, ret);
+            }
+
+            Request request;
+            request.connection = connection;
+            size_t lineEnd = buffer.find("\r\n");
+            request.requestLine = buffer.substr(0, lineEnd);
+            request.headers = buffer.substr(lineEnd + 2, headerEnd - lineEnd);
+            size_t lengthPos = request.headers.find("Content-Length: ");
+            size_t contentLength = (lengthPos == std::string::npos) ? 0 : strtoul(request.headers.c_str() + lengthPos + 16, NULL, 10);
+
+            while (buffer.length() < headerEnd + 4 + contentLength)
+            {
+                if (!waitReadable(fd)) return;
+                ssize_t ret = recv(fd, chunk, sizeof(chunk), 0);
+                if (ret <= 0) return;
+                buffer.append(chunk, ret);
+            }
+            std::string body = buffer.substr(headerEnd + 4, contentLength);
+            buffer.erase(0, headerEnd + 4 + contentLength);
+
+            request.gzipped = (request.headers.find("Content-Encoding: gzip\r\n") != std::string::npos);
+            request.framingOk = !request.gzipped || gunzip(body, request.body);
+            if (!request.gzipped)
+                request.body = body;
+
+            int status = 204;
+            bool drop;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                received.push_back(request);
+                if (!pendingStatuses.empty()) {
+                    status = pendingStatuses.front();
+                    pendingStatuses.pop_front();
+                }
+                drop = dropAfterResponse;
+            }
+
+            std::string message = (status == 204) ? "" : "{\"error\":\"status " + std::to_string(status) + "\"}";
+            std::string response = "HTTP/1.1 " + std::to_string(status) + " Stand-in\r\n"
+                                   "Content-Type: application/json\r\n"
+                                   "Content-Length: " + std::to_string(message.length()) + "\r\n\r\n" + message;
+            if ((send(fd, response.data(), response.length(), MSG_NOSIGNAL) != (ssize_t)response.length()) || drop)
+                return;
+        }
+    }
+
+    // the whole body must be exactly one gzip member
+    static bool gunzip(const std::string &in, std::string &out)
+    {
+        z_stream stream;
+        memset(&stream, 0, sizeof(stream));
+        if (inflateInit2(&stream, 15 + 16) != Z_OK) return false;
+
+        char chunk[16384];
+        stream.next_in = (Bytef *)in.data();
+        stream.avail_in = in.length();
+        int ret;
+        do
+        {
+            stream.next_out = (Bytef *)chunk;
+            stream.avail_out = sizeof(chunk);
+            ret = inflate(&stream, Z_NO_FLUSH);
+            out.append(chunk, sizeof(chunk) - stream.avail_out);
+        } while (ret == Z_OK);
+
+        bool ok = (ret == Z_STREAM_END) && (stream.avail_in == 0);
+        inflateEnd(&stream);
+        return ok;
+    }
+
+    int listenFd;
+    int stopPipe[2];
+    int port;
+    std::thread thread;
+
+    std::mutex mutex;
+    std::deque<int> pendingStatuses;
+    bool dropAfterResponse;
+    int connections;
+    std::vector<Request> received;
+};
+
+// a local port nothing listens on
+static std::string refusedUrl()
+{
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t length = sizeof(addr);
+    bind(fd, (struct sockaddr *)&addr, sizeof(addr));
+    getsockname(fd, (struct sockaddr *)&addr, &length);
+    close(fd);
+    return "http://127.0.0.1:" + std::to_string(ntohs(addr.sin_port));
+}
+
+static std::string batchOf(int records, int tag = 0)
+{
+    std::string batch;
+    for (int i = 0; i < records; i++)
+        batch += "processMonitoring,processName=sdkagent,pid=" + std::to_string(1000 + i) +
+                 " interval_cpu_usage=1.25,batch=" + std::to_string(tag) + "i 1700000000000000000\n";
+    return batch;
+}
+
+static WriteResult write(InfluxHttpSink &sink, const std::string &batch)
+{
+    return sink.write(batch.data(), batch.length());
+}
+
+//===================================================================
+
+static void testGzipFraming()
+{
+    setInfluxConfig(2, 10);
+    InfluxStandIn standIn;
+    InfluxHttpSink sink("influxdb", {standIn.url() + "/prefix/"}, "tele graf");
+    sink.configure(pbnjson::JValue());
+
+    // the deflate stream is reset between batches, each body is one gzip member
+    std::string first = batchOf(40, 1);
+    std::string second = batchOf(60, 2);
+    std::string small = batchOf(1, 3);
+    CHECK(write(sink, first) == WriteResult::WRITTEN);
+    CHECK(write(sink, second) == WriteResult::WRITTEN);
+    CHECK(write(sink, small) == WriteResult::WRITTEN);
+
+    std::vector<Request> requests = standIn.requests();
+    CHECK(requests.size() == 3);
+    if (requests.size() != 3) return;
+    for (const Request &request : requests)
+    {
+        CHECK(request.requestLine == "POST /prefix/write?db=tele%20graf&precision=ns HTTP/1.1");
+        CHECK(request.framingOk);
+    }
+    CHECK(requests[0].gzipped && (requests[0].body == first));
+    CHECK(requests[1].gzipped && (requests[1].body == second));
+    // under 1 KiB the body is sent as is
+    CHECK(!requests[2].gzipped && (requests[2].body == small));
+}
+
+static void testKeepAlive()
+{
+    setInfluxConfig(2, 10);
+    InfluxStandIn standIn;
+    InfluxHttpSink sink("influxdb", {standIn.url()}, "telegraf");
+    sink.configure(pbnjson::JValue());
+
+    for (int i = 0; i < 5; i++)
+        CHECK(write(sink, batchOf(3, i)) == WriteResult::WRITTEN);
+    CHECK(standIn.requests().size() == 5);
+    CHECK(standIn.connectionCount() == 1);
+}
+
+static void testStaleConnection()
+{
+    setInfluxConfig(0, 10);
+    InfluxStandIn standIn;
+    standIn.setDropAfterResponse(true);
+    InfluxHttpSink sink("influxdb", {standIn.url()}, "telegraf");
+    sink.configure(pbnjson::JValue());
+
+    // even without retries, a batch sent on a connection the server closed
+    // is posted once more on a new one
+    std::string first = batchOf(3, 1);
+    std::string second = batchOf(3, 2);
+    CHECK(write(sink, first) == WriteResult::WRITTEN);
+    usleep(50000);
+    CHECK(write(sink, second) == WriteResult::WRITTEN);
+
+    std::vector<Request> requests = standIn.requests();
+    CHECK(requests.size() == 2);
+    CHECK(standIn.connectionCount() == 2);
+    if (requests.size() != 2) return;
+    CHECK((requests[0].connection == 1) && (requests[0].body == first));
+    CHECK((requests[1].connection == 2) && (requests[1].body == second));
+}
+
+static void testUrlFailover()
+{
+    setInfluxConfig(2, 10);
+    InfluxStandIn standIn;
+    InfluxHttpSink sink("influxdb", {refusedUrl(), standIn.url()}, "telegraf");
+    sink.configure(pbnjson::JValue());
+
+    CHECK(write(sink, batchOf(3, 1)) == WriteResult::WRITTEN);
+    std::map<int, guint64> errors = sink.sendErrors().snapshot();
+    CHECK(errors[ECONNREFUSED] == 1);
+
+    // the url that answered is kept
+    CHECK(write(sink, batchOf(3, 2)) == WriteResult::WRITTEN);
+    CHECK(sink.sendErrors().snapshot()[ECONNREFUSED] == 1);
+    CHECK(standIn.requests().size() == 2);
+
+    InfluxHttpSink nowhere("influxdb", {refusedUrl(), refusedUrl()}, "telegraf");
+    nowhere.configure(pbnjson::JValue());
+    CHECK(write(nowhere, batchOf(3)) == WriteResult::UNREACHABLE);
+    CHECK(nowhere.sendErrors().snapshot()[ECONNREFUSED] == 3);
+}
+
+static void testStatusMapping()
+{
+    setInfluxConfig(2, 10);
+    InfluxStandIn standIn;
+    InfluxHttpSink sink("influxdb", {standIn.url()}, "telegraf");
+    sink.configure(pbnjson::JValue());
+
+    // 4xx: the batch is rejected and not posted again
+    standIn.answer({400});
+    CHECK(write(sink, batchOf(1)) == WriteResult::FAILED);
+    CHECK(standIn.requests().size() == 1);
+
+    standIn.answer({404});
+    CHECK(write(sink, batchOf(1)) == WriteResult::FAILED);
+    CHECK(standIn.requests().size() == 2);
+
+    // 5xx and 429 are retried, up to max_retries
+    standIn.answer({503, 429});
+    CHECK(write(sink, batchOf(1)) == WriteResult::WRITTEN);
+    CHECK(standIn.requests().size() == 5);
+
+    standIn.answer({500, 502, 503});
+    CHECK(write(sink, batchOf(1)) == WriteResult::RETRY_LATER);
+    CHECK(standIn.requests().size() == 8);
+
+    // an error response keeps the connection
+    CHECK(standIn.connectionCount() == 1);
+}
+
+static void testStopDuringBackoff()
+{
+    setInfluxConfig(10, 10000);
+    InfluxStandIn standIn;
+    InfluxHttpSink sink("influxdb", {standIn.url()}, "telegraf");
+    sink.configure(pbnjson::JValue());
+    standIn.answer({503, 503, 503});
+
+    WriteResult result = WriteResult::WRITTEN;
+    gint64 start = g_get_monotonic_time();
+    std::thread writer([&]() { result = write(sink, batchOf(1)); });
+    usleep(100000);
+    sink.requestStop();
+    writer.join();
+
+    CHECK(result == WriteResult::RETRY_LATER);
+    CHECK(g_get_monotonic_time() - start < G_USEC_PER_SEC);
+    CHECK(standIn.requests().size() == 1);
+    // nothing more is sent once stop is requested
+    CHECK(write(sink, batchOf(1)) == WriteResult::RETRY_LATER);
+    CHECK(standIn.requests().size() == 1);
+}
+
+int main()
+{
+    testGzipFraming();
+    testKeepAlive();
+    testStaleConnection();
+    testUrlFailover();
+    testStatusMapping();
+    testStopDuringBackoff();
+
+    if (failures > 0)
+    {
+        fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}
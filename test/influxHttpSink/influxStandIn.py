@@ -0,0 +1,188 @@
+#!/usr/bin/env python3
+# Copyright (c) 2024 LG Electronics, Inc.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+# SPDX-License-Identifier: Apache-2.0
+
+"""Local stand-in for the InfluxDB 1.x write endpoint, to check InfluxHttpSink.
+
+Accepts POST /write?db=<db>&precision=ns like InfluxDB, answers 204, and on
+exit prints what it saw and checks it:
+  - every request targets /write with the expected db and precision=ns
+  - bodies of 1 KiB and more are gzip encoded (unless --no-gzip), smaller
+    ones may be sent as they are, and every body parses as line protocol
+  - batching: at least --min-lines lines per request on average
+  - keep-alive: fewer connections than requests
+  - retries: with --fail-first N the first N requests get 503, and each of
+    those bodies must be posted again
+A body that does not parse gets 400, which the sink must not retry.
+The exit status is 0 when every check passed.
+"""
+
+import argparse
+import gzip
+import hashlib
+import http.server
+import re
+import sys
+import threading
+import urllib.parse
+
+# InfluxHttpSink sends smaller bodies uncompressed, see GZIP_MIN_SIZE
+GZIP_MIN_SIZE = 1024
+
+LINE = re.compile(r'^[^,\s#][^\s]*( [^\s]+=[^\s]+)+( -?\d+)?$')
+
+
+class State:
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.requests = 0
+        self.gzipped = 0
+        self.plainLarge = 0
+        self.lines = 0
+        self.maxLines = 0
+        self.connections = set()
+        self.failedBodies = set()
+        self.retriedBodies = set()
+        self.errors = []
+
+
+def makeHandler(args, state):
+    class Handler(http.server.BaseHTTPRequestHandler):
+        protocol_version = 'HTTP/1.1'
+
+        def reply(self, code, body=b''):
+            self.send_response(code)
+            self.send_header('Content-Length', str(len(body)))
+            if body:
+                self.send_header('Content-Type', 'application/json')
+            self.end_headers()
+            self.wfile.write(body)
+
+        def do_POST(self):
+            url = urllib.parse.urlsplit(self.path)
+            query = urllib.parse.parse_qs(url.query)
+            body = self.rfile.read(int(self.headers.get('Content-Length', 0)))
+
+            with state.lock:
+                state.requests += 1
+                number = state.requests
+                state.connections.add(self.client_address)
+
+                if not url.path.endswith('/write'):
+                    state.errors.append('request %d: path %s' % (number, url.path))
+                if query.get('db') != [args.db]:
+                    state.errors.append('request %d: db %s' % (number, query.get('db')))
+                if query.get('precision') != ['ns']:
+                    state.errors.append('request %d: precision %s' % (number, query.get('precision')))
+
+                if self.headers.get('Content-Encoding') == 'gzip':
+                    state.gzipped += 1
+                    try:
+                        body = gzip.decompress(body)
+                    except OSError:
+                        state.errors.append('request %d: broken gzip body' % number)
+                        self.reply(400, b'{"error":"broken gzip body"}')
+                        return
+
+                elif len(body) >= GZIP_MIN_SIZE:
+                    state.plainLarge += 1
+
+                digest = hashlib.sha1(body).hexdigest()
+                if digest in state.failedBodies:
+                    state.retriedBodies.add(digest)
+
+                lines = [line for line in body.decode('utf-8', 'replace').split('\n') if line]
+                state.lines += len(lines)
+                state.maxLines = max(state.maxLines, len(lines))
+                badLine = next((line for line in lines if not LINE.match(line)), None)
+
+                if args.verbose:
+                    print('POST %s %s %d bytes %d lines' % (self.path, self.headers.get('Content-Encoding', '-'),
+                                                            len(body), len(lines)), flush=True)
+
+                if badLine is not None:
+                    state.errors.append('request %d: not line protocol: %r' % (number, badLine[:80]))
+                    self.reply(400, b'{"error":"unable to parse"}')
+                    return
+                if number <= args.fail_first:
+                    state.failedBodies.add(digest)
+                    self.reply(503)
+                    return
+                self.reply(204)
+
+            if args.requests and number >= args.requests:
+                threading.Thread(target=self.server.shutdown).start()
+
+        def log_message(self, *unused):
+            pass
+
+    return Handler
+
+
+def summarize(args, state):
+    checks = []
+    requests = state.requests
+    checks.append(('requests received', requests > 0, '%d' % requests))
+    checks.append(('well-formed requests', not state.errors, '%d error(s)' % len(state.errors)))
+    if not args.no_gzip:
+        checks.append(('gzip bodies', state.plainLarge == 0,
+                       '%d gzipped, %d of 1 KiB or more sent plain' % (state.gzipped, state.plainLarge)))
+    average = float(state.lines) / requests if requests else 0
+    checks.append(('batching', average >= args.min_lines, '%.1f lines per request, max %d' % (average, state.maxLines)))
+    if requests > 1:
+        checks.append(('keep-alive', len(state.connections) < requests,
+                       '%d connection(s) for %d requests' % (len(state.connections), requests)))
+    if args.fail_first:
+        checks.append(('retries', state.failedBodies and state.failedBodies <= state.retriedBodies,
+                       '%d of %d rejected batches posted again' % (len(state.retriedBodies), len(state.failedBodies))))
+
+    for error in state.errors[:20]:
+        print('  ' + error)
+    passed = True
+    for name, ok, detail in checks:
+        print('%-22s %s  %s' % (name, 'ok  ' if ok else 'FAIL', detail))
+        passed = passed and bool(ok)
+    return passed
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--host', default='127.0.0.1')
+    parser.add_argument('--port', type=int, default=18086)
+    parser.add_argument('--db', default='telegraf', help='database the writes must name')
+    parser.add_argument('--fail-first', type=int, default=0, metavar='N', help='answer 503 to the first N requests')
+    parser.add_argument('--min-lines', type=float, default=1, help='lowest accepted average lines per request')
+    parser.add_argument('--no-gzip', action='store_true', help='the sink runs with "gzip": false')
+    parser.add_argument('--requests', type=int, default=0, metavar='N', help='stop after N requests')
+    parser.add_argument('--duration', type=float, default=0, metavar='SEC', help='stop after SEC seconds')
+    parser.add_argument('-v', '--verbose', action='store_true')
+    args = parser.parse_args()
+
+    state = State()
+    server = http.server.ThreadingHTTPServer((args.host, args.port), makeHandler(args, state))
+    if args.duration:
+        threading.Timer(args.duration, server.shutdown).start()
+    print('listening on http://%s:%d' % (args.host, args.port), flush=True)
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+    server.server_close()
+    sys.exit(0 if summarize(args, state) else 1)
+
+
+if __name__ == '__main__':
+    main()
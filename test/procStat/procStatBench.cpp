@@ -0,0 +1,88 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "procStat.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <string>
+
+// getProcessTime() before parseProcStat(): utime + stime from tokens 13 and 14
+// of the line split on spaces. Wrong as soon as comm contains a space.
+static float oldProcessTime(const char *buffer)
+{
+    gchar **tokens = g_strsplit(buffer, " ", 16);
+    float utime = (float)g_strtod(tokens[13], NULL);
+    float stime = (float)g_strtod(tokens[14], NULL);
+    g_strfreev(tokens);
+    return utime + stime;
+}
+
+static float newProcessTime(const char *buffer, size_t length)
+{
+    ProcStat stat;
+    if (!parseProcStat(buffer, length, stat)) return 0.0f;
+    return (float)(stat.utime + stat.stime);
+}
+
+static double nowNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// the result is accumulated so the calls are not optimized away
+template <typename Function>
+static double nsPerCall(long iterations, double &sink, Function function)
+{
+    double start = nowNs();
+    for (long i = 0; i < iterations; i++)
+        sink += function();
+    return (nowNs() - start) / iterations;
+}
+
+static void bench(const char *name, const std::string &line, long iterations)
+{
+    double oldSink = 0.0, newSink = 0.0;
+    double oldNs = nsPerCall(iterations, oldSink, [&]() { return oldProcessTime(line.c_str()); });
+    double newNs = nsPerCall(iterations, newSink, [&]() { return newProcessTime(line.data(), line.size()); });
+
+    printf("%-14s g_strsplit %7.1f ns  parseProcStat %7.1f ns  x%-5.1f utime+stime %g / %g%s\n",
+           name, oldNs, newNs, oldNs / newNs, oldSink / iterations, newSink / iterations,
+           (oldSink != newSink) ? "  (g_strsplit is wrong)" : "");
+}
+
+int main(int argc, char **argv)
+{
+    long iterations = (argc > 1) ? atol(argv[1]) : 1000000;
+
+    char self[1024];
+    FILE *fp = fopen("/proc/self/stat", "r");
+    size_t length = fp ? fread(self, 1, sizeof(self) - 1, fp) : 0;
+    if (fp) fclose(fp);
+    self[length] = '\0';
+
+    const std::string fields = " S 1 1234 1234 0 -1 4194304 120 0 3 0 500 300 0 0 20 0 9 0 987654 123456789 2048 "
+                               "18446744073709551615 1 1 0 0 0 0 0 4096 0 0 0 0 17 3 0 0 0 0 0 0 0 0 0 0 0 0 0\n";
+
+    if (length > 0) bench("/proc/self", std::string(self, length), iterations);
+    bench("sdkagent", "1234 (sdkagent)" + fields, iterations);
+    bench("Web Content", "1234 (Web Content)" + fields, iterations);
+    return 0;
+}
@@ -0,0 +1,129 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "procStat.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <random>
+#include <string>
+#include <vector>
+
+// The input is copied into a buffer of exactly its size, so the sanitizers
+// catch any read past 'length'. Whatever the input, the result must be
+// consistent with what parseProcStat() promises.
+static void checkOne(const uint8_t *data, size_t size)
+{
+    std::vector<char> buffer(data, data + size);
+    ProcStat stat;
+    bool parsed = parseProcStat(buffer.data(), buffer.size(), stat);
+
+    if (memchr(stat.comm, '\0', sizeof(stat.comm)) == NULL) abort();
+    if (parsed && ((stat.fieldCount < 15) || (stat.fieldCount > 52))) abort();
+    if (!parsed && (stat.fieldCount > 15)) abort();
+
+    // fields past fieldCount stay 0
+    if (parsed && (stat.fieldCount < 52) && (stat.exitCode != 0)) abort();
+    if (parsed && (stat.fieldCount < 22) && (stat.starttime != 0)) abort();
+
+    guint64 voluntary, involuntary;
+    parseContextSwitches(buffer.data(), buffer.size(), voluntary, involuntary);
+}
+
+#ifdef PROCSTAT_LIBFUZZER
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    checkOne(data, size);
+    return 0;
+}
+
+#else
+
+// Without libFuzzer: mutations of real stat lines, which reach much deeper
+// than random bytes would.
+static const char *seeds[] = {
+    "1 (systemd) S 0 1 1 0 -1 4194560 49157 2372651 97 1352 125 318 4823 1652 20 0 1 0 4 173998080 3061 "
+    "18446744073709551615 1 1 0 0 0 0 671173123 4096 1260 0 0 0 17 1 0 0 0 0 0 0 0 0 0 0 0 0 0\n",
+    "1234 (Web Content) R 1000 1234 1234 0 -1 4194304 12 0 0 0 5 3 0 0 20 0 9 0 987654 123456789 2048 "
+    "18446744073709551615 94000000000000 94000000100000 140000000000000 0 0 0 0 4096 0 0 0 0 17 3 0 0 0 0 0 "
+    "94000000200000 94000000300000 94000000400000 140000000001000 140000000002000 140000000002000 "
+    "140000000003000 0\n",
+    "42 (a) b (c)) S 1 42 42 0 -1 0 1 2 3 4 5 6 7 8 -2 -20 1 0 100 1000 10 0 0 0 0 0 0 0 0 0 0 0 0 0 17 0 0 0 0 0 0\n",
+    "7 (two\nlines) D 2 0 0 0 -1 2129984 0 0 0 0 0 0 0 0 20 0 1 0 5\n",
+    "Name:\tsdkagent\nvoluntary_ctxt_switches:\t1520\nnonvoluntary_ctxt_switches:\t33\n",
+};
+
+static std::string mutate(std::string input, std::mt19937 &random)
+{
+    static const char interesting[] = " ()\n-0123456789x";
+    int mutations = 1 + random() % 4;
+    for (int i = 0; i < mutations; i++)
+    {
+        size_t position = input.empty() ? 0 : random() % input.size();
+        switch (random() % 6)
+        {
+        case 0:     // truncate
+            input.resize(position);
+            break;
+        case 1:     // flip a character
+            if (!input.empty()) input[position] = (char)random();
+            break;
+        case 2:     // insert a separator or a digit
+            input.insert(position, 1, interesting[random() % (sizeof(interesting) - 1)]);
+            break;
+        case 3:     // erase a run
+            input.erase(position, random() % 8);
+            break;
+        case 4:     // duplicate a run, long numbers and repeated parentheses
+            input.insert(position, input.substr(position, random() % 24));
+            break;
+        default:    // a digit run that overflows 64 bits
+            input.insert(position, std::string(1 + random() % 30, '9'));
+            break;
+        }
+    }
+    return input;
+}
+
+int main(int argc, char **argv)
+{
+    long iterations = (argc > 1) ? atol(argv[1]) : 1000000;
+    unsigned seed = (argc > 2) ? (unsigned)atol(argv[2]) : std::random_device()();
+    std::mt19937 random(seed);
+
+    for (long i = 0; i < iterations; i++)
+    {
+        std::string input;
+        if (random() % 16 == 0)
+        {
+            // plain random bytes
+            input.resize(random() % 512);
+            for (char &c : input) c = (char)random();
+        }
+        else
+        {
+            input = mutate(seeds[random() % (sizeof(seeds) / sizeof(seeds[0]))], random);
+        }
+        checkOne((const uint8_t *)input.data(), input.size());
+    }
+    printf("%ld inputs, seed %u\n", iterations, seed);
+    return 0;
+}
+
+#endif
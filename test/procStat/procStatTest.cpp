@@ -0,0 +1,288 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "procStat.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+static int failures = 0;
+
+#define CHECK(condition)                                                       \
+    do                                                                         \
+    {                                                                          \
+        if (!(condition))                                                      \
+        {                                                                      \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+            failures++;                                                        \
+        }                                                                      \
+    } while (0)
+
+// fields 4 to 52 of a 5.x kernel, "ppid" is 1 and every other field is its own
+// position in proc(5), so a shifted field shows up as an off-by-one value
+static std::string numericFields(int last)
+{
+    std::string fields;
+    for (int i = 4; i <= last; i++)
+        fields += " " + std::to_string(i == 4 ? 1 : i);
+    return fields;
+}
+
+static std::string statLine(const std::string &comm, int lastField = 52)
+{
+    return "4242 (" + comm + ") S" + numericFields(lastField) + "\n";
+}
+
+static bool parse(const std::string &line, ProcStat &stat)
+{
+    return parseProcStat(line.data(), line.size(), stat);
+}
+
+static void testCurrentKernel()
+{
+    ProcStat stat;
+    CHECK(parse(statLine("sdkagent"), stat));
+    CHECK(stat.pid == 4242);
+    CHECK(strcmp(stat.comm, "sdkagent") == 0);
+    CHECK(stat.state == 'S');
+    CHECK(stat.ppid == 1);
+    CHECK(stat.pgrp == 5);
+    CHECK(stat.utime == 14);
+    CHECK(stat.stime == 15);
+    CHECK(stat.numThreads == 20);
+    CHECK(stat.starttime == 22);
+    CHECK(stat.rss == 24);
+    CHECK(stat.processor == 39);
+    CHECK(stat.cguestTime == 44);
+    CHECK(stat.exitCode == 52);
+    CHECK(stat.fieldCount == 52);
+}
+
+static void testCommWithSpaces()
+{
+    ProcStat stat;
+    CHECK(parse(statLine("Web Content"), stat));
+    CHECK(strcmp(stat.comm, "Web Content") == 0);
+    CHECK(stat.utime == 14);
+    CHECK(stat.stime == 15);
+
+    CHECK(parse(statLine(" "), stat));
+    CHECK(strcmp(stat.comm, " ") == 0);
+    CHECK(stat.fieldCount == 52);
+}
+
+static void testCommWithParentheses()
+{
+    ProcStat stat;
+    CHECK(parse(statLine("a) S 1 (b"), stat));
+    CHECK(strcmp(stat.comm, "a) S 1 (b") == 0);
+    CHECK(stat.state == 'S');
+    CHECK(stat.utime == 14);
+
+    CHECK(parse(statLine(")"), stat));
+    CHECK(strcmp(stat.comm, ")") == 0);
+    CHECK(stat.stime == 15);
+
+    CHECK(parse(statLine("(sd-pam)"), stat));
+    CHECK(strcmp(stat.comm, "(sd-pam)") == 0);
+
+    CHECK(parse(statLine(""), stat));
+    CHECK(stat.comm[0] == '\0');
+    CHECK(stat.fieldCount == 52);
+}
+
+static void testCommWithNewline()
+{
+    ProcStat stat;
+    CHECK(parse(statLine("two\nlines"), stat));
+    CHECK(strcmp(stat.comm, "two\nlines") == 0);
+    CHECK(stat.utime == 14);
+    CHECK(stat.fieldCount == 52);
+
+    CHECK(parse(statLine("\n) R 9 9 (\n"), stat));
+    CHECK(strcmp(stat.comm, "\n) R 9 9 (\n") == 0);
+    CHECK(stat.state == 'S');
+}
+
+static void testLongComm()
+{
+    ProcStat stat;
+    std::string comm(100, 'x');
+    CHECK(parse(statLine(comm), stat));
+    CHECK(strlen(stat.comm) == sizeof(stat.comm) - 1);
+    CHECK(stat.utime == 14);
+}
+
+static void testNegativeFields()
+{
+    std::string line = "7 (rt) R 1 7 7 0 -1 4194560 10 0 0 0 3 4 0 0 -51 -20 1 0 100 0 0\n";
+    ProcStat stat;
+    CHECK(parse(line, stat));
+    CHECK(stat.tpgid == -1);
+    CHECK(stat.priority == -51);
+    CHECK(stat.nice == -20);
+    CHECK(stat.fieldCount == 24);
+}
+
+// proc(5): 2.6.24 ends at cguest_time (44), 3.3 adds the data and brk
+// addresses (47), 3.5 the argument, environment and exit code fields (52)
+static void testOlderKernels()
+{
+    ProcStat stat;
+    CHECK(parse(statLine("init", 44), stat));
+    CHECK(stat.fieldCount == 44);
+    CHECK(stat.cguestTime == 44);
+    CHECK(stat.startData == 0);
+    CHECK(stat.exitCode == 0);
+
+    CHECK(parse(statLine("init", 47), stat));
+    CHECK(stat.fieldCount == 47);
+    CHECK(stat.startBrk == 47);
+    CHECK(stat.argStart == 0);
+
+    // 2.6.18 stops at rt_priority and policy, before delayacct_blkio_ticks
+    CHECK(parse(statLine("init", 41), stat));
+    CHECK(stat.fieldCount == 41);
+    CHECK(stat.policy == 41);
+    CHECK(stat.delayacctBlkioTicks == 0);
+}
+
+static void testTruncatedLines()
+{
+    std::string full = statLine("Web Content");
+    ProcStat stat;
+
+    // anything cut before the space that ends stime is rejected
+    size_t stimeEnd = full.find(" 15 ") + 4;
+    for (size_t length = 0; length < stimeEnd; length++)
+    {
+        if (parseProcStat(full.data(), length, stat))
+        {
+            fprintf(stderr, "accepted a line cut at %zu: '%.*s'\n", length, (int)length, full.data());
+            failures++;
+        }
+    }
+
+    // from there on the fields that made it are kept, the rest is 0
+    CHECK(parseProcStat(full.data(), stimeEnd, stat));
+    CHECK(stat.fieldCount == 15);
+    CHECK(stat.stime == 15);
+    CHECK(stat.cutime == 0);
+
+    // a field cut short is dropped with the ones after it
+    CHECK(parseProcStat(full.data(), full.find(" 23 ") + 2, stat));
+    CHECK(stat.fieldCount == 22);
+    CHECK(stat.starttime == 22);
+    CHECK(stat.vsize == 0);
+
+    CHECK(parseProcStat(full.data(), full.size() - 2, stat));
+    CHECK(stat.fieldCount == 51);
+    CHECK(stat.envEnd == 51);
+    CHECK(stat.exitCode == 0);
+
+    // a buffer that is not NUL terminated is not read past its length
+    char unterminated[64];
+    memset(unterminated, '7', sizeof(unterminated));
+    const char *head = "1 (x) R 1 1 1 1 1 1 1 1 1 1 1 ";
+    memcpy(unterminated, head, strlen(head));
+    unterminated[strlen(head) + 2] = ' ';
+    CHECK(parseProcStat(unterminated, strlen(head) + 3, stat));
+    CHECK(stat.stime == 77);
+    CHECK(stat.fieldCount == 15);
+    CHECK(!parseProcStat(unterminated, strlen(head) + 2, stat));
+}
+
+static void testMalformed()
+{
+    ProcStat stat;
+    CHECK(!parseProcStat(NULL, 10, stat));
+    CHECK(!parse("", stat));
+    CHECK(!parse("\n", stat));
+    CHECK(!parse("4242 sdkagent S" + numericFields(52), stat));
+    CHECK(!parse("4242 (sdkagent S" + numericFields(52), stat));
+    CHECK(!parse("4242 sdkagent) S" + numericFields(52), stat));
+    CHECK(!parse("(sdkagent) S" + numericFields(52), stat));
+    CHECK(!parse("4242 (sdkagent)", stat));
+    CHECK(!parse("4242 (sdkagent)S" + numericFields(52), stat));
+    CHECK(!parse("4242 (sdkagent) S 1 2 x 4 5 6 7 8 9 10 11 12\n", stat));
+    CHECK(stat.fieldCount == 5);
+}
+
+static void testRealProcess()
+{
+    char buffer[1024];
+    FILE *fp = fopen("/proc/self/stat", "r");
+    if (fp == NULL) return;
+    size_t length = fread(buffer, 1, sizeof(buffer), fp);
+    fclose(fp);
+
+    // whatever the binary is called, comm is what /proc/self/comm reports
+    char comm[64] = "";
+    fp = fopen("/proc/self/comm", "r");
+    if (fp == NULL) return;
+    if (fgets(comm, sizeof(comm), fp) == NULL) comm[0] = '\0';
+    fclose(fp);
+    comm[strcspn(comm, "\n")] = '\0';
+
+    ProcStat stat;
+    CHECK(parseProcStat(buffer, length, stat));
+    CHECK(stat.fieldCount >= 44);
+    CHECK(stat.state == 'R');
+    CHECK(stat.numThreads >= 1);
+    CHECK(strcmp(stat.comm, comm) == 0);
+}
+
+static void testContextSwitches()
+{
+    const char *status = "Name:\tsdkagent\nState:\tS (sleeping)\nThreads:\t9\n"
+                         "voluntary_ctxt_switches:\t1520\n"
+                         "nonvoluntary_ctxt_switches:\t  33\n";
+    guint64 voluntary = 1, involuntary = 1;
+    CHECK(parseContextSwitches(status, strlen(status), voluntary, involuntary));
+    CHECK(voluntary == 1520);
+    CHECK(involuntary == 33);
+
+    // a kernel without the counters, or a status cut before them
+    const char *old = "Name:\tsdkagent\nState:\tS (sleeping)\n";
+    CHECK(!parseContextSwitches(old, strlen(old), voluntary, involuntary));
+    CHECK(voluntary == 0);
+    CHECK(!parseContextSwitches(status, strlen(status) - 8, voluntary, involuntary));
+    CHECK(!parseContextSwitches(NULL, 0, voluntary, involuntary));
+}
+
+int main()
+{
+    testCurrentKernel();
+    testCommWithSpaces();
+    testCommWithParentheses();
+    testCommWithNewline();
+    testLongComm();
+    testNegativeFields();
+    testOlderKernels();
+    testTruncatedLines();
+    testMalformed();
+    testRealProcess();
+    testContextSwitches();
+
+    if (failures > 0)
+    {
+        fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}